@@ -0,0 +1,74 @@
+// GFLOP/s of matrix_multiply against the original i-j-k triple loop.
+// Usage: bench_gemm [max_size]   (default 2048)
+#include "matrix.h"
+#include <stdio.h>
+#include <time.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The pre-GEMM implementation, kept as the baseline
+static void naive_multiply(const Matrix *a, const Matrix *b, Matrix *result) {
+    matrix_fill(result, 0.0);
+    for (int i = 0; i < a->rows; i++) {
+        for (int j = 0; j < b->cols; j++) {
+            for (int k = 0; k < a->cols; k++) {
+                result->data[i * result->cols + j] +=
+                    a->data[i * a->cols + k] * b->data[k * b->cols + j];
+            }
+        }
+    }
+}
+
+// Repeat until at least 0.25s has elapsed and return the best GFLOP/s
+static double measure(void (*fn)(const Matrix *, const Matrix *, Matrix *),
+                      const Matrix *a, const Matrix *b, Matrix *c) {
+    double flops = 2.0 * a->rows * a->cols * b->cols;
+    double best = 0.0, total = 0.0;
+    do {
+        double start = now_seconds();
+        fn(a, b, c);
+        double elapsed = now_seconds() - start;
+        total += elapsed;
+        if (flops / elapsed > best) best = flops / elapsed;
+    } while (total < 0.25);
+    return best * 1e-9;
+}
+
+static void blocked_multiply(const Matrix *a, const Matrix *b, Matrix *result) {
+    matrix_multiply(a, b, result);
+}
+
+int main(int argc, char *argv[]) {
+    int sizes[] = {64, 256, 1024, 2048};
+    int max_size = argc > 1 ? atoi(argv[1]) : 2048;
+
+    printf("%6s %12s %12s %9s %12s\n", "n", "naive GF/s", "gemm GF/s", "speedup", "max |diff|");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        if (n > max_size) break;
+        Matrix *a = matrix_create_random(n, n, -1.0, 1.0);
+        Matrix *b = matrix_create_random(n, n, -1.0, 1.0);
+        Matrix *c_naive = matrix_create(n, n);
+        Matrix *c_gemm = matrix_create(n, n);
+
+        double naive = measure(naive_multiply, a, b, c_naive);
+        double gemm = measure(blocked_multiply, a, b, c_gemm);
+
+        double diff = 0.0;
+        for (int i = 0; i < n * n; i++) {
+            double d = fabs(c_naive->data[i] - c_gemm->data[i]);
+            if (d > diff) diff = d;
+        }
+        printf("%6d %12.2f %12.2f %8.1fx %12.2e\n", n, naive, gemm, gemm / naive, diff);
+
+        matrix_free(a);
+        matrix_free(b);
+        matrix_free(c_naive);
+        matrix_free(c_gemm);
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Iterations to convergence and final inertia for each k-means seeding.
+// Data is Gaussian blobs stored blob after blob, like examples/iris.csv.
+// Usage: bench_kmeans_init [n_samples] [n_features]   (default 30000 8)
+#include "kmeans.h"
+#include <stdio.h>
+#include <time.h>
+
+#define N_SEEDS 5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double gaussian(void) {
+    double u1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+    double u2 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+static Matrix* make_sorted_blobs(int n_samples, int n_features, int n_blobs) {
+    Matrix *data = matrix_create(n_samples, n_features);
+    double *centers = malloc((size_t)n_blobs * n_features * sizeof(double));
+    srand(7);
+    for (int i = 0; i < n_blobs * n_features; i++) centers[i] = (double)rand() / RAND_MAX * 20.0;
+    for (int i = 0; i < n_samples; i++) {
+        int blob = (int)((long long)i * n_blobs / n_samples);
+        for (int f = 0; f < n_features; f++) {
+            data->data[i * n_features + f] = centers[blob * n_features + f] + gaussian();
+        }
+    }
+    free(centers);
+    return data;
+}
+
+int main(int argc, char *argv[]) {
+    int n_samples = argc > 1 ? atoi(argv[1]) : 30000;
+    int n_features = argc > 2 ? atoi(argv[2]) : 8;
+    int ks[] = {3, 16, 64};
+    const char *names[] = {"first-k", "k-means++", "k-means||"};
+
+    printf("%4s %-10s %10s %14s %10s\n", "k", "init", "iters", "inertia", "fit ms");
+    for (size_t ki = 0; ki < sizeof(ks) / sizeof(ks[0]); ki++) {
+        int k = ks[ki];
+        Matrix *data = make_sorted_blobs(n_samples, n_features, k);
+        for (int init = KMEANS_INIT_FIRST_K; init <= KMEANS_INIT_PARALLEL; init++) {
+            double iters = 0.0, inertia = 0.0, elapsed = 0.0;
+            for (int s = 0; s < N_SEEDS; s++) {
+                KMeans *km = kmeans_create(k, n_features);
+                km->init = (kmeans_init_t)init;
+                km->seed = s;
+                double start = now_seconds();
+                kmeans_fit(km, data, 300);
+                elapsed += now_seconds() - start;
+                iters += km->n_iter;
+                inertia += km->inertia;
+                kmeans_free(km);
+            }
+            printf("%4d %-10s %10.1f %14.1f %10.2f\n", k, names[init],
+                   iters / N_SEEDS, inertia / N_SEEDS, elapsed / N_SEEDS * 1e3);
+        }
+        matrix_free(data);
+    }
+    return 0;
+}
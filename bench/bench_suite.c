@@ -0,0 +1,548 @@
+// Microbenchmarks for the matrix ops, CSV loading, k-means and linear
+// regression over a synthetic dataset, written as JSON so runs can be
+// diffed against a saved baseline.
+// Usage: ml_bench [--rows N] [--cols N] [--k N] [--gemm N] [--min-time S]
+//                 [--filter SUBSTR] [--out FILE]
+#include "matrix.h"
+#include "dataset.h"
+#include "kmeans.h"
+#include "linearreg.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// Heap allocations are counted by wrapping the allocator at link time
+// (-Wl,--wrap=malloc,...). Calls made inside libc itself, e.g. by strdup
+// or fopen, are not seen.
+#ifdef ML_BENCH_COUNT_ALLOCS
+static long long alloc_count = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+int __real_posix_memalign(void **ptr, size_t alignment, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+
+static void count_alloc(void) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+}
+
+void *__wrap_malloc(size_t size) {
+    count_alloc();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    count_alloc();
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    count_alloc();
+    return __real_realloc(ptr, size);
+}
+
+int __wrap_posix_memalign(void **ptr, size_t alignment, size_t size) {
+    count_alloc();
+    return __real_posix_memalign(ptr, alignment, size);
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+    count_alloc();
+    return __real_aligned_alloc(alignment, size);
+}
+
+static long long allocations(void) {
+    return __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+}
+#else
+static long long allocations(void) {
+    return -1;
+}
+#endif
+
+typedef struct {
+    int rows;
+    int cols;
+    int k;
+    int gemm;          // square GEMM size
+    double min_time;   // seconds per benchmark
+    const char *filter;
+    const char *out;
+} BenchConfig;
+
+// Inputs shared by all benchmarks, built once before timing starts
+typedef struct {
+    const BenchConfig *config;
+    Matrix *a, *b, *c;            // rows x cols
+    Matrix *row, *col;            // 1 x cols, rows x 1
+    Matrix *sq_a, *sq_b, *sq_c;   // gemm x gemm
+    Matrix *y;                    // rows x 1 regression targets
+    int *label_buf;
+    double *dist_buf;
+    KMeans *km;
+    LinearRegression *lr;
+    char csv_path[64];
+    size_t csv_bytes;
+    SparseMatrix *sparse;         // a with |x| <= 0.9 dropped, about 10% dense
+    char libsvm_path[64];
+    size_t libsvm_bytes;
+} BenchData;
+
+typedef struct {
+    const char *name;
+    void (*run)(BenchData *d);
+    double work;       // units of work per call, for the throughput column
+    const char *unit;  // "flop", "byte", "row", "element" or "call"
+} Bench;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Keeps results alive so the compiler cannot drop the calls
+static volatile double sink;
+
+static void bench_matrix_create(BenchData *d) {
+    matrix_free(matrix_create(d->config->rows, d->config->cols));
+}
+
+static void bench_matrix_create_zeros(BenchData *d) {
+    matrix_free(matrix_create_zeros(d->config->rows, d->config->cols));
+}
+
+static void bench_matrix_create_random(BenchData *d) {
+    matrix_free(matrix_create_random(d->config->rows, d->config->cols, -1.0, 1.0));
+}
+
+static void bench_matrix_create_identity(BenchData *d) {
+    matrix_free(matrix_create_identity(d->config->gemm));
+}
+
+static void bench_matrix_copy(BenchData *d) {
+    matrix_free(matrix_copy(d->a));
+}
+
+static void bench_matrix_view(BenchData *d) {
+    matrix_free(matrix_view(d->a, 1, 1, d->a->rows - 1, d->a->cols - 1));
+}
+
+static void bench_matrix_get_set(BenchData *d) {
+    for (int i = 0; i < d->c->rows; i++) {
+        for (int j = 0; j < d->c->cols; j++) {
+            matrix_set(d->c, i, j, matrix_get(d->a, i, j));
+        }
+    }
+}
+
+static void bench_matrix_add(BenchData *d) {
+    matrix_add(d->a, d->b, d->c);
+}
+
+static void bench_matrix_subtract(BenchData *d) {
+    matrix_subtract(d->a, d->b, d->c);
+}
+
+static void bench_matrix_hadamard(BenchData *d) {
+    matrix_hadamard(d->a, d->b, d->c);
+}
+
+static void bench_matrix_multiply_scalar(BenchData *d) {
+    matrix_multiply_scalar(d->a, 1.5, d->c);
+}
+
+static void bench_matrix_multiply(BenchData *d) {
+    matrix_multiply(d->sq_a, d->sq_b, d->sq_c);
+}
+
+static void bench_matrix_transpose(BenchData *d) {
+    matrix_transpose(d->sq_a, d->sq_c);
+}
+
+static void bench_matrix_transpose_inplace(BenchData *d) {
+    matrix_transpose_inplace(d->sq_c);
+}
+
+static void bench_matrix_gemv_t(BenchData *d) {
+    matrix_gemv_t(d->a, NULL, d->y->data, d->row->data, NULL);
+}
+
+static void bench_matrix_syrk(BenchData *d) {
+    matrix_syrk(d->sq_a, NULL, d->sq_c, NULL);
+}
+
+static void bench_matrix_dot_product(BenchData *d) {
+    sink = matrix_dot_product(d->a, d->b);
+}
+
+static void bench_matrix_norm(BenchData *d) {
+    sink = matrix_norm(d->a);
+}
+
+static void bench_matrix_norm_squared(BenchData *d) {
+    sink = matrix_norm_squared(d->a);
+}
+
+static void bench_matrix_normalize(BenchData *d) {
+    matrix_normalize(d->c);
+}
+
+static void bench_matrix_mean(BenchData *d) {
+    sink = matrix_mean(d->a);
+}
+
+static void bench_matrix_std(BenchData *d) {
+    sink = matrix_std(d->a);
+}
+
+static void bench_matrix_min(BenchData *d) {
+    sink = matrix_min(d->a);
+}
+
+static void bench_matrix_max(BenchData *d) {
+    sink = matrix_max(d->a);
+}
+
+static void bench_matrix_fill(BenchData *d) {
+    matrix_fill(d->c, 0.5);
+}
+
+static void bench_matrix_fill_random(BenchData *d) {
+    matrix_fill_random(d->c, -1.0, 1.0);
+}
+
+static void bench_matrix_get_row(BenchData *d) {
+    for (int i = 0; i < d->a->rows; i++) matrix_get_row(d->a, i, d->row);
+}
+
+static void bench_matrix_get_col(BenchData *d) {
+    for (int j = 0; j < d->a->cols; j++) matrix_get_col(d->a, j, d->col);
+}
+
+static void bench_normalize_matrix(BenchData *d) {
+    normalize_matrix(d->c);
+}
+
+static void bench_load_csv(BenchData *d) {
+    matrix_free(load_csv(d->csv_path));
+}
+
+static void bench_load_csv_parallel(BenchData *d) {
+    matrix_free(load_csv_parallel(d->csv_path, 0));
+}
+
+// Fixed iteration counts keep the work per call comparable between runs
+#define BENCH_KMEANS_ITERS 10
+#define BENCH_LINREG_ITERS 50
+
+static void bench_kmeans_fit(BenchData *d) {
+    kmeans_fit(d->km, d->a, BENCH_KMEANS_ITERS);
+}
+
+static void bench_kmeans_predict(BenchData *d) {
+    matrix_free(kmeans_predict(d->km, d->a));
+}
+
+static void bench_kmeans_predict_into(BenchData *d) {
+    kmeans_predict_into(d->km, d->a, d->label_buf, d->dist_buf);
+}
+
+static void bench_kmeans_predict_one(BenchData *d) {
+    for (int i = 0; i < d->a->rows; i++) {
+        d->label_buf[i] = kmeans_predict_one(d->km, matrix_row(d->a, i), NULL);
+    }
+}
+
+static void bench_load_libsvm(BenchData *d) {
+    sparse_free(load_libsvm(d->libsvm_path, NULL));
+}
+
+static void bench_kmeans_predict_sparse_into(BenchData *d) {
+    kmeans_predict_sparse_into(d->km, d->sparse, d->label_buf, d->dist_buf);
+}
+
+static void bench_linreg_predict_sparse_into(BenchData *d) {
+    linreg_predict_sparse_into(d->lr, d->sparse, d->dist_buf);
+}
+
+static void bench_linreg_fit(BenchData *d, linreg_solver_t solver) {
+    d->lr->solver = solver;
+    linreg_fit(d->lr, d->a, d->y, 0.01, BENCH_LINREG_ITERS);
+}
+
+static void bench_linreg_fit_gd(BenchData *d) {
+    bench_linreg_fit(d, LINREG_SOLVER_GD);
+}
+
+static void bench_linreg_fit_cholesky(BenchData *d) {
+    bench_linreg_fit(d, LINREG_SOLVER_CHOLESKY);
+}
+
+static void bench_linreg_fit_sgd(BenchData *d) {
+    bench_linreg_fit(d, LINREG_SOLVER_SGD);
+}
+
+static void bench_linreg_predict(BenchData *d) {
+    matrix_free(linreg_predict(d->lr, d->a));
+}
+
+static void bench_linreg_predict_into(BenchData *d) {
+    linreg_predict_into(d->lr, d->a, d->dist_buf);
+}
+
+static void bench_linreg_predict_one(BenchData *d) {
+    for (int i = 0; i < d->a->rows; i++) {
+        d->dist_buf[i] = linreg_predict_one(d->lr, matrix_row(d->a, i));
+    }
+}
+
+// Synthetic inputs: uniform features, a noisy linear target and a CSV copy
+// of the features on disk
+static bool bench_data_init(BenchData *d, const BenchConfig *config) {
+    memset(d, 0, sizeof(*d));
+    d->config = config;
+    int rows = config->rows, cols = config->cols;
+    srand(1);
+    d->a = matrix_create_random(rows, cols, -1.0, 1.0);
+    d->b = matrix_create_random(rows, cols, -1.0, 1.0);
+    d->c = matrix_create_random(rows, cols, -1.0, 1.0);
+    d->row = matrix_create(1, cols);
+    d->col = matrix_create(rows, 1);
+    d->sq_a = matrix_create_random(config->gemm, config->gemm, -1.0, 1.0);
+    d->sq_b = matrix_create_random(config->gemm, config->gemm, -1.0, 1.0);
+    d->sq_c = matrix_create(config->gemm, config->gemm);
+    d->y = matrix_create(rows, 1);
+    d->label_buf = malloc(rows * sizeof(int));
+    d->dist_buf = malloc(rows * sizeof(double));
+    d->km = kmeans_create(config->k, cols);
+    d->lr = linreg_create(cols);
+    if (!d->a || !d->b || !d->c || !d->row || !d->col || !d->sq_a || !d->sq_b || !d->sq_c ||
+        !d->y || !d->label_buf || !d->dist_buf || !d->km || !d->lr) {
+        return false;
+    }
+    for (int i = 0; i < rows; i++) {
+        double target = 0.5;
+        for (int j = 0; j < cols; j++) target += (j % 3 - 1) * matrix_row(d->a, i)[j];
+        d->y->data[i] = target + 0.01 * ((double)rand() / RAND_MAX - 0.5);
+    }
+    kmeans_fit(d->km, d->a, BENCH_KMEANS_ITERS);
+    d->lr->solver = LINREG_SOLVER_CHOLESKY;
+    linreg_fit(d->lr, d->a, d->y, 0.0, 0);
+
+    strcpy(d->csv_path, "/tmp/ml_bench_XXXXXX");
+    int fd = mkstemp(d->csv_path);
+    FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!f) return false;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            fprintf(f, j ? ",%.9g" : "%.9g", matrix_row(d->a, i)[j]);
+        }
+        fputc('\n', f);
+    }
+    d->csv_bytes = (size_t)ftell(f);
+    fclose(f);
+
+    Matrix *thresholded = matrix_copy(d->a);
+    if (!thresholded) return false;
+    for (int i = 0; i < rows * cols; i++) {
+        if (fabs(thresholded->data[i]) <= 0.9) thresholded->data[i] = 0.0;
+    }
+    d->sparse = sparse_from_dense(thresholded);
+    matrix_free(thresholded);
+    strcpy(d->libsvm_path, "/tmp/ml_bench_XXXXXX");
+    fd = mkstemp(d->libsvm_path);
+    if (fd < 0 || !d->sparse) return false;
+    close(fd);
+    if (save_libsvm(d->sparse, d->y, d->libsvm_path) != ML_SUCCESS) return false;
+    f = fopen(d->libsvm_path, "r");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    d->libsvm_bytes = (size_t)ftell(f);
+    fclose(f);
+    return true;
+}
+
+static void bench_data_free(BenchData *d) {
+    if (d->csv_path[0]) unlink(d->csv_path);
+    if (d->libsvm_path[0]) unlink(d->libsvm_path);
+    sparse_free(d->sparse);
+    matrix_free(d->a);
+    matrix_free(d->b);
+    matrix_free(d->c);
+    matrix_free(d->row);
+    matrix_free(d->col);
+    matrix_free(d->sq_a);
+    matrix_free(d->sq_b);
+    matrix_free(d->sq_c);
+    matrix_free(d->y);
+    free(d->label_buf);
+    free(d->dist_buf);
+    kmeans_free(d->km);
+    linreg_free(d->lr);
+}
+
+typedef struct {
+    long long iterations;
+    double ns_per_op;       // mean over the final timed batch
+    double allocs_per_op;   // negative when allocations are not counted
+} BenchResult;
+
+// One warm-up call, then batches doubling in size until a batch runs for
+// at least min_time; the last batch is the measurement
+static BenchResult bench_measure(const Bench *bench, BenchData *d, double min_time) {
+    bench->run(d);
+    long long iterations = 1;
+    for (;;) {
+        long long allocs = allocations();
+        double start = now_seconds();
+        for (long long i = 0; i < iterations; i++) bench->run(d);
+        double elapsed = now_seconds() - start;
+        allocs = allocations() - allocs;
+        if (elapsed >= min_time || iterations >= (1LL << 40)) {
+            BenchResult result = {
+                .iterations = iterations,
+                .ns_per_op = elapsed * 1e9 / iterations,
+                .allocs_per_op = allocations() < 0 ? -1.0 : (double)allocs / iterations,
+            };
+            return result;
+        }
+        // Aim straight for min_time once a batch takes measurable time
+        long long next = elapsed > 1e-3 ? (long long)(iterations * 1.2 * min_time / elapsed) : iterations * 10;
+        iterations = next > iterations ? next : iterations + 1;
+    }
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [--rows N] [--cols N] [--k N] [--gemm N] [--min-time S] "
+                    "[--filter SUBSTR] [--out FILE]\n", argv0);
+}
+
+static bool parse_args(int argc, char *argv[], BenchConfig *config) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return false;
+        const char *arg = argv[i], *value = argv[++i];
+        if (strcmp(arg, "--rows") == 0) config->rows = atoi(value);
+        else if (strcmp(arg, "--cols") == 0) config->cols = atoi(value);
+        else if (strcmp(arg, "--k") == 0) config->k = atoi(value);
+        else if (strcmp(arg, "--gemm") == 0) config->gemm = atoi(value);
+        else if (strcmp(arg, "--min-time") == 0) config->min_time = atof(value);
+        else if (strcmp(arg, "--filter") == 0) config->filter = value;
+        else if (strcmp(arg, "--out") == 0) config->out = value;
+        else return false;
+    }
+    return config->rows > 1 && config->cols > 1 && config->k > 0 &&
+           config->k <= config->rows && config->gemm > 0 && config->min_time > 0.0;
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config = { .rows = 10000, .cols = 32, .k = 16, .gemm = 256, .min_time = 0.2 };
+    if (!parse_args(argc, argv, &config)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    BenchData data;
+    if (!bench_data_init(&data, &config)) {
+        fprintf(stderr, "Failed to set up benchmark data\n");
+        bench_data_free(&data);
+        return 1;
+    }
+
+    double n = (double)config.rows * config.cols, g = config.gemm;
+    double elem = sizeof(double);
+    const Bench benches[] = {
+        { "matrix_create",          bench_matrix_create,          n * elem,         "byte" },
+        { "matrix_create_zeros",    bench_matrix_create_zeros,    n * elem,         "byte" },
+        { "matrix_create_random",   bench_matrix_create_random,   n,                "element" },
+        { "matrix_create_identity", bench_matrix_create_identity, g * g * elem,     "byte" },
+        { "matrix_copy",            bench_matrix_copy,            2 * n * elem,     "byte" },
+        { "matrix_view",            bench_matrix_view,            1,                "call" },
+        { "matrix_get_set",         bench_matrix_get_set,         n,                "element" },
+        { "matrix_add",             bench_matrix_add,             3 * n * elem,     "byte" },
+        { "matrix_subtract",        bench_matrix_subtract,        3 * n * elem,     "byte" },
+        { "matrix_hadamard",        bench_matrix_hadamard,        3 * n * elem,     "byte" },
+        { "matrix_multiply_scalar", bench_matrix_multiply_scalar, 2 * n * elem,     "byte" },
+        { "matrix_multiply",        bench_matrix_multiply,        2 * g * g * g,    "flop" },
+        { "matrix_transpose",       bench_matrix_transpose,       2 * g * g * elem, "byte" },
+        { "matrix_transpose_inplace", bench_matrix_transpose_inplace, 2 * g * g * elem, "byte" },
+        { "matrix_gemv_t",          bench_matrix_gemv_t,          2 * n,            "flop" },
+        { "matrix_syrk",            bench_matrix_syrk,            g * g * g,        "flop" },
+        { "matrix_dot_product",     bench_matrix_dot_product,     2 * n * elem,     "byte" },
+        { "matrix_norm",            bench_matrix_norm,            n * elem,         "byte" },
+        { "matrix_norm_squared",    bench_matrix_norm_squared,    n * elem,         "byte" },
+        { "matrix_normalize",       bench_matrix_normalize,       2 * n * elem,     "byte" },
+        { "matrix_mean",            bench_matrix_mean,            n * elem,         "byte" },
+        { "matrix_std",             bench_matrix_std,             n * elem,         "byte" },
+        { "matrix_min",             bench_matrix_min,             n * elem,         "byte" },
+        { "matrix_max",             bench_matrix_max,             n * elem,         "byte" },
+        { "matrix_fill",            bench_matrix_fill,            n * elem,         "byte" },
+        { "matrix_fill_random",     bench_matrix_fill_random,     n,                "element" },
+        { "matrix_get_row",         bench_matrix_get_row,         n * elem,         "byte" },
+        { "matrix_get_col",         bench_matrix_get_col,         n * elem,         "byte" },
+        { "normalize_matrix",       bench_normalize_matrix,       2 * n * elem,     "byte" },
+        { "load_csv",               bench_load_csv,               data.csv_bytes,   "byte" },
+        { "load_csv_parallel",      bench_load_csv_parallel,      data.csv_bytes,   "byte" },
+        { "load_libsvm",            bench_load_libsvm,            data.libsvm_bytes, "byte" },
+        { "kmeans_fit",             bench_kmeans_fit,             config.rows,      "row" },
+        { "kmeans_predict",         bench_kmeans_predict,         config.rows,      "row" },
+        { "kmeans_predict_into",    bench_kmeans_predict_into,    config.rows,      "row" },
+        { "kmeans_predict_one",     bench_kmeans_predict_one,     config.rows,      "row" },
+        { "kmeans_predict_sparse_into", bench_kmeans_predict_sparse_into, config.rows, "row" },
+        { "linreg_fit_gd",          bench_linreg_fit_gd,          config.rows,      "row" },
+        { "linreg_fit_cholesky",    bench_linreg_fit_cholesky,    config.rows,      "row" },
+        { "linreg_fit_sgd",         bench_linreg_fit_sgd,         config.rows,      "row" },
+        { "linreg_predict",         bench_linreg_predict,         config.rows,      "row" },
+        { "linreg_predict_into",    bench_linreg_predict_into,    config.rows,      "row" },
+        { "linreg_predict_one",     bench_linreg_predict_one,     config.rows,      "row" },
+        { "linreg_predict_sparse_into", bench_linreg_predict_sparse_into, config.rows, "row" },
+    };
+
+    FILE *out = config.out ? fopen(config.out, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Cannot open %s\n", config.out);
+        bench_data_free(&data);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"timestamp\": %lld,\n", (long long)time(NULL));
+#ifdef __VERSION__
+    fprintf(out, "    \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+    fprintf(out, "    \"simd\": \"%s\",\n", simd_level_name(simd_level()));
+    fprintf(out, "    \"num_cpus\": %d,\n", thread_num_cpus());
+    fprintf(out, "    \"rows\": %d,\n    \"cols\": %d,\n    \"k\": %d,\n    \"gemm\": %d,\n",
+            config.rows, config.cols, config.k, config.gemm);
+    fprintf(out, "    \"min_time\": %g,\n    \"counts_allocations\": %s\n  },\n",
+            config.min_time, allocations() >= 0 ? "true" : "false");
+    fprintf(out, "  \"benchmarks\": [");
+
+    bool first = true;
+    for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        const Bench *bench = &benches[b];
+        if (config.filter && !strstr(bench->name, config.filter)) continue;
+        BenchResult r = bench_measure(bench, &data, config.min_time);
+        double throughput = bench->work / (r.ns_per_op * 1e-9);
+
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.1f, "
+                     "\"throughput\": %.6g, \"unit\": \"%s/s\", \"allocs_per_op\": ",
+                first ? "" : ",", bench->name, r.iterations, r.ns_per_op, throughput, bench->unit);
+        if (r.allocs_per_op < 0) fprintf(out, "null}");
+        else fprintf(out, "%.2f}", r.allocs_per_op);
+        first = false;
+
+        fprintf(stderr, "%-24s %14.1f ns/op %12.4g %s/s", bench->name, r.ns_per_op, throughput, bench->unit);
+        if (r.allocs_per_op >= 0) fprintf(stderr, " %10.2f allocs/op", r.allocs_per_op);
+        fputc('\n', stderr);
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout) fclose(out);
+    bench_data_free(&data);
+    return 0;
+}
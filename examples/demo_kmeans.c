@@ -1,6 +1,6 @@
 #include "kmeans.h"
 #include "dataset.h"
-#include "visualize.h"
+#include "visualise.h"
 #include <stdio.h>
 
 int main() {
@@ -0,0 +1,38 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "ml_common.h"
+
+// Alignment of every arena allocation and of matrix_create buffers: one
+// cache line, and wide enough for aligned AVX-512 loads
+#define ML_ALIGNMENT 64
+
+// Bump allocator for temporaries. Allocations are never freed one by one:
+// the whole arena is reset (or rolled back to a mark) at once, typically
+// once per iteration of a training loop. When a chunk fills up a new one
+// is chained on; arena_reset then merges them so the next round fits in a
+// single chunk.
+typedef struct Arena Arena;
+
+// Position to roll back to with arena_release
+typedef struct {
+    void *chunk;
+    size_t used;
+} ArenaMark;
+
+Arena* arena_create(size_t capacity);  // initial bytes, grows on demand
+void arena_free(Arena *arena);
+void* arena_alloc(Arena *arena, size_t size);  // ML_ALIGNMENT-aligned, uninitialised
+void* arena_calloc(Arena *arena, size_t count, size_t size);  // zeroed
+void arena_reset(Arena *arena);  // invalidates everything allocated so far
+ArenaMark arena_mark(const Arena *arena);
+void arena_release(Arena *arena, ArenaMark mark);  // frees everything allocated after mark
+size_t arena_used(const Arena *arena);
+size_t arena_capacity(const Arena *arena);
+
+// Per-thread scratch arena for ops that need short-lived buffers (GEMM
+// packing, etc.). Callers bracket their use with arena_mark/arena_release.
+// Created on first use and freed when the thread exits.
+Arena* arena_thread_scratch(void);
+
+#endif
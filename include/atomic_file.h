@@ -0,0 +1,21 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include "ml_common.h"
+
+// Replace-on-commit output file for the binary savers. Data is written to
+// a temporary file next to the target, synced, then renamed over it, so a
+// process that has the old file mapped keeps seeing the old contents and
+// a failed save leaves the old file intact.
+typedef struct {
+    FILE *file;
+    char *path;      // final name
+    char *tmp_path;  // name written to until commit
+} AtomicFile;
+
+ml_error_t atomic_file_open(AtomicFile *af, const char *filename);
+// Renames over the target when ok, otherwise removes the temporary file.
+// Always releases af; returns ML_ERROR_FILE_IO if anything failed.
+ml_error_t atomic_file_commit(AtomicFile *af, bool ok);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "ml_common.h"
 #include "matrix.h"
+#include "matrix_sparse.h"
 
 typedef struct {
     Matrix *features;      
@@ -12,6 +13,8 @@ typedef struct {
     int n_samples;         
     int n_features;       
     int n_targets;         
+    void *mapping;         // file mapping backing the matrices (binary format), or NULL
+    size_t mapping_size;   
 } Dataset;
 
 typedef struct {
@@ -21,6 +24,8 @@ typedef struct {
     double *maxs;          
     int n_features;        
     normalize_t type;      
+    double range_min;      // output range for NORMALIZE_MINMAX, [0, 1] by default
+    double range_max;
 } NormalizationParams;
 
 // Dataset creation and destruction
@@ -32,14 +37,20 @@ Dataset* dataset_copy(const Dataset *src);
 // Data loading and saving
 Dataset* dataset_load_csv(const char *filename, bool has_header, int target_col);
 ml_error_t dataset_save_csv(const Dataset *dataset, const char *filename, bool save_header);
-Dataset* dataset_load_libsvm(const char *filename);
+Dataset* dataset_load_libsvm(const char *filename);  // densified; see load_libsvm for wide data
 ml_error_t dataset_save_libsvm(const Dataset *dataset, const char *filename);
+ml_error_t dataset_save_binary(const Dataset *dataset, const char *filename);
+Dataset* dataset_load_binary(const char *filename, bool verify_checksum);  // zero-copy mmap views
 
-// Data preprocessing
+// Data preprocessing. Statistics come from one row-order pass over the
+// features (population std); params may be NULL when not needed. Fit on
+// training data and apply the same params to test data.
 ml_error_t dataset_normalize(Dataset *dataset, normalize_t type, NormalizationParams **params);
+ml_error_t dataset_fit_normalization(const Dataset *dataset, normalize_t type, NormalizationParams **params);
 ml_error_t dataset_apply_normalization(Dataset *dataset, const NormalizationParams *params);
 ml_error_t dataset_standardize(Dataset *dataset, NormalizationParams **params);
 ml_error_t dataset_minmax_scale(Dataset *dataset, double min_val, double max_val, NormalizationParams **params);
+void normalization_params_free(NormalizationParams *params);
 
 // Data splitting
 ml_error_t dataset_train_test_split(const Dataset *dataset, double test_ratio, 
@@ -66,5 +77,15 @@ bool dataset_is_valid(const Dataset *dataset);
 ml_error_t dataset_check_missing_values(const Dataset *dataset, bool **missing_mask);
 ml_error_t dataset_handle_missing_values(Dataset *dataset, const char *strategy);
 
-// Feature engineering
-ml_error_t dataset
\ No newline at end of file
+// Raw matrix loading and scaling
+Matrix* load_csv(const char *filename);  // numeric CSV without header, any line length
+Matrix* load_csv_parallel(const char *filename, int n_threads);  // chunked across threads (<= 0: global pool), same result
+void normalize_matrix(Matrix *m);        // in-place min-max scaling per column
+
+// libsvm text format straight to and from CSR. Column indices in the file
+// are 1-based; the matrix gets as many columns as the highest index.
+// labels (rows x 1) is optional on both sides, 0 is written without it.
+SparseMatrix* load_libsvm(const char *filename, Matrix **labels);
+ml_error_t save_libsvm(const SparseMatrix *X, const Matrix *labels, const char *filename);
+
+#endif
\ No newline at end of file
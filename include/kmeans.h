@@ -1,16 +1,80 @@
 #ifndef KMEANS_H
 #define KMEANS_H
 #include "matrix.h"
+#include "matrix_f32.h"
+#include "matrix_sparse.h"
+#include "thread_pool.h"
+
+// Assignment strategy for kmeans_fit. Hamerly and Elkan keep triangle
+// inequality bounds per point to skip most distance computations and
+// produce the same clustering as Lloyd.
+typedef enum {
+    KMEANS_LLOYD = 0,   // brute force n x k distances per iteration, via GEMM for large k and d
+    KMEANS_HAMERLY,     // one lower bound per point, O(n) extra memory
+    KMEANS_ELKAN,       // k lower bounds per point, O(n*k) extra memory
+    KMEANS_AUTO         // Hamerly for low-dimensional data, Elkan otherwise
+} kmeans_algorithm_t;
+
+// Centroid seeding used by kmeans_fit
+typedef enum {
+    KMEANS_INIT_FIRST_K = 0,   // copy the first k rows
+    KMEANS_INIT_PLUSPLUS,      // k-means++ D^2 sampling
+    KMEANS_INIT_PARALLEL       // k-means|| oversampling, reclustered with k-means++
+} kmeans_init_t;
 
 typedef struct {
     Matrix *centroids;  // k x n matrix (k clusters, n features)
     int *assignments;   // Cluster assignment for each data point
     int k;              // Number of clusters
+    int n_threads;      // Worker threads for fit (<= 0 uses the global pool)
+    ThreadPool *pool;   // Runs fit instead when set (not owned)
+    kmeans_algorithm_t algorithm;  // Defaults to KMEANS_LLOYD
+    double *centroid_counts;  // Samples absorbed per centroid (mini-batch learning rates)
+    kmeans_init_t init;       // Defaults to KMEANS_INIT_PLUSPLUS
+    unsigned int seed;        // RNG seed for seeding, fixed seeds reproduce runs
+    int n_iter;               // Lloyd iterations run by the last fit
+    double inertia;           // Sum of squared distances to assigned centroids
+    void *mapping;            // model file backing centroids (kmeans_load), or NULL
+    size_t mapping_size;
 } KMeans;
 
+// Inference-only copy of a fitted model whose centroids are stored only as
+// float32 or int8 (per-centroid scale). Built once by kmeans_compact;
+// refitting the source model does not update it.
+typedef struct {
+    ml_precision_t precision;
+    int k;
+    int n_features;
+    MatrixF32 *centroids;     // ML_PRECISION_F32
+    MatrixQ8 *centroids_q8;   // ML_PRECISION_Q8
+    float *offsets;           // ML_PRECISION_Q8: s_j^2 |q_j|^2 per centroid
+} KMeansCompact;
+
 KMeans* kmeans_create(int k, int n_features);
 void kmeans_free(KMeans *km);
+// Model files (see model_io.h). kmeans_load maps the file and the
+// centroids point into it; NULL if the file is missing or malformed.
+ml_error_t kmeans_save(const KMeans *km, const char *filename);
+KMeans* kmeans_load(const char *filename, bool verify_checksum);
 void kmeans_fit(KMeans *km, const Matrix *data, int max_iters);
-Matrix* kmeans_predict(const KMeans *km, const Matrix *data);
+void kmeans_partial_fit(KMeans *km, const Matrix *batch);  // One mini-batch update
+Matrix* kmeans_predict(const KMeans *km, const Matrix *data);  // labels as a column of doubles
+// Allocation-free prediction for latency-sensitive callers. labels has
+// data->rows entries; distances, if not NULL, receives each row's squared
+// distance to its centroid. kmeans_predict_one returns the label of x.
+ml_error_t kmeans_predict_into(const KMeans *km, const Matrix *data, int *labels, double *distances);
+int kmeans_predict_one(const KMeans *km, const double *x, double *sq_dist);
+// Inference on single-precision data with a compact copy of the model.
+// Labels (data->rows entries) match kmeans_predict except for points
+// almost equidistant from two centroids.
+KMeansCompact* kmeans_compact(const KMeans *km, ml_precision_t precision);
+void kmeans_compact_free(KMeansCompact *model);
+ml_error_t kmeans_compact_predict_into(const KMeansCompact *model, const MatrixF32 *data, int *labels);
+// Sparse data: distances come from |x|^2 - 2 x.c + |c|^2, so each row
+// costs O(nnz * k). data may have fewer columns than the centroids (the
+// rest are zero). The fit always runs Lloyd; KMEANS_INIT_PARALLEL seeds
+// with k-means++.
+void kmeans_fit_sparse(KMeans *km, const SparseMatrix *data, int max_iters);
+ml_error_t kmeans_predict_sparse_into(const KMeans *km, const SparseMatrix *data, int *labels, double *distances);
 
 #endif
\ No newline at end of file
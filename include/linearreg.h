@@ -1,15 +1,81 @@
 #ifndef LINREG_H
 #define LINREG_H
 #include "matrix.h"
+#include "matrix_f32.h"
+#include "matrix_sparse.h"
+#include "thread_pool.h"
+
+// How linreg_fit finds the weights. The direct and CG solvers ignore the
+// learning rate; CG and GD stop early once the norm of the mean squared
+// error's gradient, X^T (Xw - y) / n, drops below tol.
+// SGD and Adam treat max_iters as a number of epochs over X.
+typedef enum {
+    LINREG_SOLVER_GD = 0,     // full-batch gradient descent
+    LINREG_SOLVER_CHOLESKY,   // normal equations, X^T X formed once
+    LINREG_SOLVER_QR,         // Householder QR of X, for ill-conditioned problems
+    LINREG_SOLVER_CG,         // conjugate gradient on the normal equations, X^T X never formed
+    LINREG_SOLVER_SGD,        // mini-batch SGD with momentum
+    LINREG_SOLVER_ADAM        // mini-batch Adam
+} linreg_solver_t;
 
 typedef struct {
     Matrix *weights;  // Weight vector (n_features x 1)
     double bias;      // Bias term
+    linreg_solver_t solver;  // Defaults to LINREG_SOLVER_GD
+    double tol;       // Convergence tolerance on the gradient norm
+    int n_iter;       // Iterations run by the last fit
+    int n_threads;    // Threads for the full passes over X (<= 0: global pool, the default)
+    ThreadPool *pool; // Used instead when set (not owned). Fits are identical on any thread count.
+
+    // Mini-batch settings for SGD, Adam and linreg_partial_fit
+    int batch_size;       // Rows per update (default 256)
+    double momentum;      // SGD momentum (default 0.9, 0 for plain SGD)
+    double beta1;         // Adam first moment decay (default 0.9)
+    double beta2;         // Adam second moment decay (default 0.999)
+    bool shuffle;         // Reshuffle rows every epoch (default true)
+    unsigned int seed;    // Shuffle seed, fixed seeds reproduce runs
+
+    // Optimizer state, kept across linreg_partial_fit calls. n_features + 1
+    // entries each, bias last; allocated on first use.
+    double *velocity;     // SGD velocity / Adam first moment
+    double *second_moment;  // Adam only
+    long long n_steps;    // Updates applied so far
+
+    void *mapping;        // model file backing weights (linreg_load), or NULL
+    size_t mapping_size;
 } LinearRegression;
 
+// Inference-only copy of a fitted model whose weights are stored only as
+// float32 or int8 (one scale for the whole vector). Built once by
+// linreg_compact; refitting the source model does not update it.
+typedef struct {
+    ml_precision_t precision;
+    int n_features;
+    MatrixF32 *weights;     // ML_PRECISION_F32, 1 x n_features
+    MatrixQ8 *weights_q8;   // ML_PRECISION_Q8, 1 x n_features
+    double bias;
+} LinregCompact;
+
 LinearRegression* linreg_create(int n_features);
 void linreg_free(LinearRegression *lr);
+// Model files (see model_io.h); the loaded weights point into the mapped file
+ml_error_t linreg_save(const LinearRegression *lr, const char *filename);
+LinearRegression* linreg_load(const char *filename, bool verify_checksum);
 void linreg_fit(LinearRegression *lr, const Matrix *X, const Matrix *y, double learning_rate, int max_iters);
+// One pass of mini-batch updates over X in row order, continuing from the
+// optimizer state of earlier calls. Uses Adam if solver is LINREG_SOLVER_ADAM,
+// SGD with momentum otherwise.
+void linreg_partial_fit(LinearRegression *lr, const Matrix *X, const Matrix *y, double learning_rate);
 Matrix* linreg_predict(const LinearRegression *lr, const Matrix *X);
+// Allocation-free variants: out has X->rows entries, x has n_features
+ml_error_t linreg_predict_into(const LinearRegression *lr, const Matrix *X, double *out);
+double linreg_predict_one(const LinearRegression *lr, const double *x);
+// Sparse features; X may have fewer columns than the model (the rest are zero)
+ml_error_t linreg_predict_sparse_into(const LinearRegression *lr, const SparseMatrix *X, double *out);
+// Inference on single-precision features with a compact copy of the
+// model; out has X->rows entries
+LinregCompact* linreg_compact(const LinearRegression *lr, ml_precision_t precision);
+void linreg_compact_free(LinregCompact *model);
+ml_error_t linreg_compact_predict_into(const LinregCompact *model, const MatrixF32 *X, double *out);
 
 #endif
\ No newline at end of file
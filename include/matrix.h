@@ -1,19 +1,93 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
+#include "ml_common.h"
+#include "arena.h"
+#include "thread_pool.h"
+
 typedef struct {
-    double *data;  
+    double *data;
     int rows;
     int cols;
+    int stride;     // elements between the starts of consecutive rows (cols unless a view)
+    bool is_view;   // data borrowed from another matrix, not freed
+    bool in_arena;  // header and data owned by an Arena, matrix_free does nothing
+    bool owns_data; // data is a separate malloc'd buffer freed with the header
 } Matrix;
 
+// Start of row i. Always index through the stride: a view's rows are not
+// cols apart.
+static inline double* matrix_row(const Matrix *m, int i) {
+    return m->data + (size_t)i * m->stride;
+}
+
+// True when the elements form one dense run of rows * cols doubles
+static inline bool matrix_is_contiguous(const Matrix *m) {
+    return m->stride == m->cols || m->rows == 1;
+}
+
+// Matrix creation and destruction. matrix_create makes one allocation
+// holding the header and ML_ALIGNMENT-aligned data.
 Matrix* matrix_create(int rows, int cols);
+Matrix* matrix_create_in(Arena *arena, int rows, int cols);  // zeroed, lives until the arena is reset
+Matrix* matrix_create_from_array(const double *data, int rows, int cols);
+Matrix* matrix_create_from_buffer(double *data, int rows, int cols);  // takes ownership of malloc'd data
+Matrix* matrix_create_zeros(int rows, int cols);
+Matrix* matrix_create_ones(int rows, int cols);
+Matrix* matrix_create_identity(int size);
+Matrix* matrix_create_random(int rows, int cols, double min_val, double max_val);
+Matrix* matrix_copy(const Matrix *src);  // contiguous copy, also of views
+Matrix* matrix_view(Matrix *src, int start_row, int start_col, int rows, int cols);  // zero-copy sub-block
+Matrix* matrix_view_buffer(double *data, int rows, int cols);  // borrows data, e.g. from a file mapping
+Matrix* matrix_view_strided(double *data, int rows, int cols, int stride);  // borrowed, rows stride apart
 void matrix_free(Matrix *m);
 
-void matrix_add(const Matrix *a, const Matrix *b, Matrix *result);
-void matrix_multiply(const Matrix *a, const Matrix *b, Matrix *result);
-void matrix_transpose(const Matrix *m, Matrix *result);
-double matrix_dot(const Matrix *a, const Matrix *b);  // For vectors
+// Matrix properties
+bool matrix_is_valid(const Matrix *m);
+bool matrix_same_size(const Matrix *a, const Matrix *b);
+bool matrix_can_multiply(const Matrix *a, const Matrix *b);
+double matrix_get(const Matrix *m, int row, int col);
+ml_error_t matrix_set(Matrix *m, int row, int col, double value);
+
+// Basic operations
+ml_error_t matrix_add(const Matrix *a, const Matrix *b, Matrix *result);
+ml_error_t matrix_subtract(const Matrix *a, const Matrix *b, Matrix *result);
+ml_error_t matrix_multiply(const Matrix *a, const Matrix *b, Matrix *result);  // blocked GEMM
+ml_error_t matrix_multiply_scalar(const Matrix *m, double scalar, Matrix *result);
+ml_error_t matrix_transpose(const Matrix *m, Matrix *result);  // cache-oblivious, result may alias a square m
+ml_error_t matrix_transpose_inplace(Matrix *m);  // square only
+ml_error_t matrix_hadamard(const Matrix *a, const Matrix *b, Matrix *result);
+
+// Transpose-free products, reading A row by row and reducing blocks of
+// rows in a fixed order across pool (NULL runs serially); results do not
+// depend on the thread count.
+// y = (A - 1 center^T)^T x, with x of A->rows entries and y of A->cols.
+// center (A->cols entries) may be NULL.
+ml_error_t matrix_gemv_t(const Matrix *a, const double *center, const double *x, double *y, ThreadPool *pool);
+// result = (A - 1 center^T)^T (A - 1 center^T), symmetric cols x cols. Only
+// the upper triangle is computed. center (A->cols entries) may be NULL.
+ml_error_t matrix_syrk(const Matrix *a, const double *center, Matrix *result, ThreadPool *pool);
+
+// Vector operations
+double matrix_dot_product(const Matrix *a, const Matrix *b);
+double matrix_norm(const Matrix *m);
+double matrix_norm_squared(const Matrix *m);
+ml_error_t matrix_normalize(Matrix *m);
+
+// Statistical operations
+double matrix_mean(const Matrix *m);
+double matrix_std(const Matrix *m);
+double matrix_min(const Matrix *m);
+double matrix_max(const Matrix *m);
+
+// Utility functions
 void matrix_print(const Matrix *m);  // Debugging
+void matrix_print_shape(const Matrix *m);
+ml_error_t matrix_fill(Matrix *m, double value);
+ml_error_t matrix_fill_random(Matrix *m, double min_val, double max_val);
+
+// Row and column operations
+ml_error_t matrix_get_row(const Matrix *m, int row, Matrix *result);
+ml_error_t matrix_get_col(const Matrix *m, int col, Matrix *result);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef MATRIX_F32_H
+#define MATRIX_F32_H
+
+#include "matrix.h"
+#include <stdint.h>
+
+// Single-precision matrix for inference: half the memory and bandwidth of
+// Matrix. Same row-major layout with a row stride; training stays in
+// double precision.
+typedef struct {
+    float *data;
+    int rows;
+    int cols;
+    int stride;    // elements between the starts of consecutive rows
+    bool is_view;  // data borrowed, not freed
+} MatrixF32;
+
+// Symmetric per-row int8 quantization: row i is approximately
+// scales[i] * data[i * cols .. i * cols + cols), with values in [-127, 127].
+// Used for compact model parameters (centroids, weights).
+typedef struct {
+    int8_t *data;
+    float *scales;
+    int rows;
+    int cols;
+} MatrixQ8;
+
+// Parameter precision of the inference-only model copies (kmeans_compact,
+// linreg_compact)
+typedef enum {
+    ML_PRECISION_F32 = 0,  // float32: half the memory of the double model
+    ML_PRECISION_Q8        // int8 with float scales: an eighth
+} ml_precision_t;
+
+static inline float* matrix_f32_row(const MatrixF32 *m, int i) {
+    return m->data + (size_t)i * m->stride;
+}
+
+MatrixF32* matrix_f32_create(int rows, int cols);  // zeroed, one aligned allocation
+MatrixF32* matrix_f32_from_matrix(const Matrix *m);  // rounds each value to float
+MatrixF32* matrix_f32_view(MatrixF32 *src, int start_row, int start_col, int rows, int cols);
+Matrix* matrix_f32_to_matrix(const MatrixF32 *m);
+void matrix_f32_free(MatrixF32 *m);
+ml_error_t matrix_f32_multiply(const MatrixF32 *a, const MatrixF32 *b, MatrixF32 *result);
+
+MatrixQ8* matrix_q8_quantize(const Matrix *m);
+Matrix* matrix_q8_dequantize(const MatrixQ8 *q);
+void matrix_q8_free(MatrixQ8 *q);
+
+#endif
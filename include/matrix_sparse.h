@@ -0,0 +1,42 @@
+#ifndef MATRIX_SPARSE_H
+#define MATRIX_SPARSE_H
+
+#include "matrix.h"
+
+// Compressed sparse row matrix for wide, mostly-zero features (bag of
+// words, hashed one-hots). Row i's nonzeros are values[row_ptr[i] ..
+// row_ptr[i + 1]) in columns col_idx[...], ascending within the row.
+// Memory is proportional to the nonzeros, not rows * cols.
+typedef struct {
+    double *values;
+    int *col_idx;
+    size_t *row_ptr;  // rows + 1 offsets into values and col_idx
+    int rows;
+    int cols;
+    size_t nnz;
+} SparseMatrix;
+
+// x . row i for a dense vector x with at least cols entries
+static inline double sparse_row_dot(const SparseMatrix *s, int i, const double *x) {
+    double sum = 0.0;
+    for (size_t p = s->row_ptr[i]; p < s->row_ptr[i + 1]; p++) sum += s->values[p] * x[s->col_idx[p]];
+    return sum;
+}
+
+// Creation and destruction. sparse_create_from_arrays takes ownership of
+// malloc'd arrays laid out as above.
+SparseMatrix* sparse_create(int rows, int cols, size_t nnz);  // row_ptr zeroed, nnz slots to fill
+SparseMatrix* sparse_create_from_arrays(double *values, int *col_idx, size_t *row_ptr, int rows, int cols);
+SparseMatrix* sparse_from_dense(const Matrix *m);  // keeps entries != 0
+Matrix* sparse_to_dense(const SparseMatrix *s);
+void sparse_free(SparseMatrix *s);
+
+bool sparse_is_valid(const SparseMatrix *s);  // shape, offsets and column order
+double sparse_density(const SparseMatrix *s);  // nnz / (rows * cols)
+
+// result = a * b with b and result dense. Each nonzero a_ik adds a_ik
+// times row k of b to row i of result, so only the touched rows of b are read.
+ml_error_t sparse_multiply_dense(const SparseMatrix *a, const Matrix *b, Matrix *result);
+ml_error_t sparse_row_sq_norms(const SparseMatrix *s, double *norms);  // |row i|^2, rows entries
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef ML_COMMON_H
+#define ML_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+// Error codes returned by library functions
+typedef enum {
+    ML_SUCCESS = 0,
+    ML_ERROR_NULL_POINTER,
+    ML_ERROR_MEMORY_ALLOCATION,
+    ML_ERROR_INVALID_PARAMETER,
+    ML_ERROR_DIMENSION_MISMATCH,
+    ML_ERROR_INVALID_DATA,
+    ML_ERROR_FILE_IO,
+    ML_ERROR_CONVERGENCE,
+    ML_ERROR_NOT_IMPLEMENTED
+} ml_error_t;
+
+// Feature normalization strategies
+typedef enum {
+    NORMALIZE_NONE = 0,
+    NORMALIZE_MINMAX,
+    NORMALIZE_ZSCORE
+} normalize_t;
+
+#define ML_EPSILON 1e-10
+
+#define ML_CHECK_NULL(ptr) do { if (!(ptr)) return ML_ERROR_NULL_POINTER; } while (0)
+#define ML_SAFE_FREE(ptr) do { free(ptr); (ptr) = NULL; } while (0)
+
+#ifdef ML_DEBUG
+#define ML_DEBUG_PRINT(fmt, ...) fprintf(stderr, "[DEBUG] %s:%d: " fmt "\n", __FILE__, __LINE__, ##__VA_ARGS__)
+#else
+#define ML_DEBUG_PRINT(fmt, ...) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef ML_RANDOM_H
+#define ML_RANDOM_H
+
+#include <stdint.h>
+
+// Counter-based RNG shared by the models (splitmix64 finaliser): a draw
+// depends only on the values hashed into it, never on call order or on how
+// work is split across threads, so seeded runs are reproducible.
+static inline uint64_t ml_hash64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Fisher-Yates shuffle of index[0..n) with its own stream per (seed, round),
+// e.g. one per training epoch
+static inline void ml_shuffle(int *index, int n, uint64_t seed, uint64_t round) {
+    uint64_t stream = ml_hash64(ml_hash64(seed) ^ round);
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)(ml_hash64(stream ^ (uint64_t)i) % (uint64_t)(i + 1));
+        int tmp = index[i];
+        index[i] = index[j];
+        index[j] = tmp;
+    }
+}
+
+#endif
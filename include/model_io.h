@@ -0,0 +1,49 @@
+#ifndef MODEL_IO_H
+#define MODEL_IO_H
+
+#include "matrix.h"
+#include <stdint.h>
+
+// Versioned binary model files, shared by kmeans_save/kmeans_load,
+// linreg_save/linreg_load and svm_save/svm_load. A fixed 384-byte header
+// (type, shapes, scalar parameters, checksums) is followed by up to
+// MODEL_FILE_MAX_SECTIONS row-major float64 matrices, each 64-byte
+// aligned. Loading maps the file and hands out matrix views into it, so
+// scorer processes share one page-cached copy of the parameters.
+
+#define MODEL_FILE_MAX_SECTIONS 4
+#define MODEL_FILE_MAX_PARAMS 12
+
+typedef enum {
+    MODEL_FILE_KMEANS = 1,
+    MODEL_FILE_LINREG,
+    MODEL_FILE_SVM
+} model_file_type_t;
+
+// Scalar fields of a model; each model fixes its own slot layout
+typedef struct {
+    int64_t ints[MODEL_FILE_MAX_PARAMS];
+    double reals[MODEL_FILE_MAX_PARAMS];
+} ModelParams;
+
+// A mapped model file. sections[i] is a view into the mapping, or NULL
+// for a section saved empty. Models take ownership of the views and the
+// mapping by clearing them here; model_file_close releases the rest.
+typedef struct {
+    void *mapping;
+    size_t mapping_size;
+    ModelParams params;
+    Matrix *sections[MODEL_FILE_MAX_SECTIONS];
+    int n_sections;
+} ModelFile;
+
+// sections may contain NULL entries (saved empty); strided views are fine
+ml_error_t model_file_save(const char *filename, model_file_type_t type, const ModelParams *params,
+                           const Matrix *const *sections, int n_sections);
+// The header is always validated; verify_checksum also hashes the payload,
+// which touches every page
+ml_error_t model_file_open(const char *filename, model_file_type_t type, bool verify_checksum, ModelFile *file);
+void model_file_close(ModelFile *file);
+void model_file_unmap(void *mapping, size_t size);  // for models freeing a mapping they took
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "ml_common.h"
+#include <stdint.h>
+
+// Hot-path instrumentation. Building with ML_PROFILE defined turns the
+// ML_PROFILE_* macros below into phase timers and counters; without it
+// they expand to nothing and the query functions report zeros.
+
+// Timed phases. Parallel phases are timed on the calling thread, so the
+// totals are wall time.
+typedef enum {
+    ML_PHASE_KMEANS_INIT = 0,   // centroid seeding
+    ML_PHASE_KMEANS_ASSIGN,     // nearest-centroid pass, bound upkeep included
+    ML_PHASE_KMEANS_UPDATE,     // reduce partial sums into new centroids
+    ML_PHASE_KMEANS_CONVERGE,   // centroid shifts, stopping test, final inertia
+    ML_PHASE_KMEANS_PREDICT,
+    ML_PHASE_LINREG_GRADIENT,   // fused predict/error/gradient pass
+    ML_PHASE_LINREG_UPDATE,     // weight step
+    ML_PHASE_LINREG_SOLVE,      // Cholesky, QR or CG solve
+    ML_PHASE_LINREG_PREDICT,
+    ML_PHASE_CSV_SCAN,          // map the file, find the columns and split points
+    ML_PHASE_CSV_PARSE,         // parse fields into rows
+    ML_PHASE_CSV_STITCH,        // join per-thread rows into one matrix
+    ML_PHASE_COUNT
+} ml_phase_t;
+
+typedef enum {
+    ML_COUNTER_DISTANCES = 0,   // point-centroid distance evaluations
+    ML_COUNTER_BYTES_PARSED,    // CSV bytes handed to the parser
+    ML_COUNTER_ALLOCATIONS,     // matrix and arena chunk allocations
+    ML_COUNTER_COUNT
+} ml_counter_t;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} ProfilePhaseStats;
+
+bool profile_enabled(void);
+void profile_reset(void);  // zero every phase and counter
+ProfilePhaseStats profile_phase(ml_phase_t phase);
+uint64_t profile_counter(ml_counter_t counter);
+const char* profile_phase_name(ml_phase_t phase);
+const char* profile_counter_name(ml_counter_t counter);
+void profile_print(FILE *out);  // table of phases and counters
+
+// Record every phase as a Chrome trace event (chrome://tracing, Perfetto)
+// until profile_trace_stop, which writes the JSON file
+ml_error_t profile_trace_start(const char *path);
+ml_error_t profile_trace_stop(void);
+
+// Used by the macros
+uint64_t profile_now_ns(void);
+void profile_end(ml_phase_t phase, uint64_t start_ns);
+void profile_flush(void);  // publish this thread's buffered counts
+
+#ifdef ML_PROFILE
+// Counts are buffered per thread and published when a phase ends, a pool
+// task returns or a query runs, so counting in inner loops stays cheap
+extern _Thread_local uint64_t profile_local_counts[ML_COUNTER_COUNT];
+
+#define ML_PROFILE_BEGIN(phase) uint64_t ml_profile_start_##phase = profile_now_ns()
+#define ML_PROFILE_END(phase) profile_end(phase, ml_profile_start_##phase)
+#define ML_PROFILE_COUNT(counter, n) (profile_local_counts[counter] += (uint64_t)(n))
+#define ML_PROFILE_FLUSH() profile_flush()
+#else
+#define ML_PROFILE_BEGIN(phase) ((void)0)
+#define ML_PROFILE_END(phase) ((void)0)
+#define ML_PROFILE_COUNT(counter, n) ((void)0)
+#define ML_PROFILE_FLUSH() ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "ml_common.h"
+#include <stdint.h>
+
+// Instruction set paths, ordered from least to most capable
+typedef enum {
+    SIMD_SCALAR = 0,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_AVX512
+} simd_level_t;
+
+// Element-wise kernels over contiguous double arrays of length n
+typedef struct {
+    void (*add)(const double *a, const double *b, double *out, int n);
+    void (*sub)(const double *a, const double *b, double *out, int n);
+    void (*mul)(const double *a, const double *b, double *out, int n);
+    void (*scale)(const double *a, double scalar, double *out, int n);
+    void (*fill)(double *out, double value, int n);
+    double (*dot)(const double *a, const double *b, int n);
+    double (*sum_sq)(const double *a, int n);
+    double (*sq_dist)(const double *a, const double *b, int n);  // ||a - b||^2
+    double (*min)(const double *a, int n);  // n must be > 0
+    double (*max)(const double *a, int n);  // n must be > 0
+
+    // Single-precision and int8 kernels for the inference paths
+    float (*dot_f32)(const float *a, const float *b, int n);
+    float (*sq_dist_f32)(const float *a, const float *b, int n);
+    void (*axpy_f32)(float alpha, const float *x, float *y, int n);  // y += alpha * x
+    float (*dot_s8_f32)(const int8_t *q, const float *x, int n);    // int8 . float
+} simd_kernels_t;
+
+// Kernels for the active path. The path is chosen on first use from cpuid,
+// and can be pinned lower with ML_SIMD=scalar|sse2|avx2|avx512.
+const simd_kernels_t* simd_kernels(void);
+simd_level_t simd_level(void);
+simd_level_t simd_detect_level(void);  // best path this CPU supports
+const simd_kernels_t* simd_kernels_for(simd_level_t level);
+const char* simd_level_name(simd_level_t level);
+
+#endif
\ No newline at end of file
@@ -1,16 +1,65 @@
 #ifndef SVM_H
 #define SVM_H
 #include "matrix.h"
+#include "matrix_sparse.h"
+
+// Training method for svm_fit with the linear kernel. Labels are +1 / -1
+// (any y > 0 counts as +1).
+typedef enum {
+    SVM_SOLVER_DUAL_CD = 0,  // dual coordinate descent with shrinking (L1-loss, LIBLINEAR-style)
+    SVM_SOLVER_PEGASOS       // mini-batch primal sub-gradient, lambda = 1 / (C * n_samples)
+} svm_solver_t;
+
+// Kernel for svm_fit. Nonlinear kernels train with SMO and predict from the
+// support vectors; the linear kernel keeps an explicit weight vector.
+typedef enum {
+    SVM_KERNEL_LINEAR = 0,  // x . z, trained with the solver below
+    SVM_KERNEL_RBF,         // exp(-gamma * |x - z|^2)
+    SVM_KERNEL_POLY         // (gamma * x . z + coef0)^degree
+} svm_kernel_t;
 
 typedef struct {
-    Matrix *support_vectors;
-    Matrix *weights;
+    Matrix *support_vectors;  // Rows with nonzero dual weight, NULL after a Pegasos fit
+    Matrix *weights;          // Weight vector (n_features x 1), linear kernel only
     double bias;
+    svm_solver_t solver;      // Defaults to SVM_SOLVER_DUAL_CD
+    double tol;               // Dual CD / SMO stopping tolerance on the KKT violation gap (default 0.1)
+    int batch_size;           // Rows per Pegasos step (default 1)
+    unsigned int seed;        // Shuffle seed, fixed seeds reproduce runs
+    int n_iter;               // Epochs (linear) or SMO pair updates run by the last fit
+    long long n_steps;        // Pegasos steps taken so far, drives the step size
+
+    // Kernel SVM (SMO)
+    svm_kernel_t kernel;      // Defaults to SVM_KERNEL_LINEAR
+    double gamma;             // RBF/poly scale, <= 0 uses 1 / n_features
+    int degree;               // Poly degree (default 3)
+    double coef0;             // Poly offset (default 0)
+    Matrix *dual_coef;        // alpha_i * y_i per support vector (n_support x 1)
+    double cache_mb;          // Kernel row cache budget in MB (default 100)
+    long long cache_hits;     // Kernel row lookups served from the cache by the last fit
+    long long cache_misses;   // Kernel rows computed by the last fit
+
+    void *mapping;            // model file backing the matrices (svm_load), or NULL
+    size_t mapping_size;
 } SVM;
 
 SVM* svm_create(int n_features);
 void svm_free(SVM *svm);
+// Model files (see model_io.h); the loaded weights, support vectors and
+// dual coefficients point into the mapped file
+ml_error_t svm_save(const SVM *svm, const char *filename);
+SVM* svm_load(const char *filename, bool verify_checksum);
 void svm_fit(SVM *svm, const Matrix *X, const Matrix *y, double C, int max_iters);
-Matrix* svm_predict(const SVM *svm, const Matrix *X);
+// One in-order Pegasos pass over a chunk of a stream, continuing the step
+// schedule of earlier calls
+void svm_partial_fit(SVM *svm, const Matrix *X, const Matrix *y, double lambda);
+Matrix* svm_decision_function(const SVM *svm, const Matrix *X);  // Signed margin per row
+Matrix* svm_predict(const SVM *svm, const Matrix *X);  // +1 / -1 per row
+// Linear-kernel scoring of sparse rows into caller buffers (X->rows
+// entries). X may have fewer columns than the model; kernel models return
+// ML_ERROR_NOT_IMPLEMENTED.
+ml_error_t svm_decision_function_sparse(const SVM *svm, const SparseMatrix *X, double *scores);
+ml_error_t svm_predict_sparse(const SVM *svm, const SparseMatrix *X, double *labels);
+double svm_cache_hit_rate(const SVM *svm);  // Fraction of kernel row lookups served from the cache
 
-#endif
\ No newline at end of file
+#endif
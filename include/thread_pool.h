@@ -0,0 +1,77 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "ml_common.h"
+
+// One runtime for all library parallelism. Routines take their pool from
+// thread_pool_select: an explicit per-context pool, the shared global pool,
+// or a dedicated one. A pool runs one job at a time; a call made from
+// inside a pool task, or one that finds the pool busy, runs on the calling
+// thread instead of waiting, so nested and concurrent calls never deadlock
+// or oversubscribe the cores. Work run on the calling thread (serial, busy
+// pool or a single chunk) counts as a pool task too: a one-thread fit
+// stays on one thread even when its body reaches the global pool.
+
+typedef struct ThreadPool ThreadPool;
+
+// Work function run once on every pool thread. thread_id is in
+// [0, n_threads); the calling thread always runs thread_id 0.
+typedef void (*thread_task_fn)(void *ctx, int thread_id, int n_threads);
+
+typedef struct {
+    int n_threads;      // <= 0 uses all CPUs
+    bool pin_threads;   // pin thread i to CPU i, or to cpus[i % n_cpus]; best effort
+    const int *cpus;    // optional CPU list, read only during creation
+    int n_cpus;
+} ThreadPoolOptions;
+
+ThreadPool* thread_pool_create(int n_threads);  // n_threads <= 0 uses all CPUs
+// The calling thread (thread 0) is never pinned
+ThreadPool* thread_pool_create_with(const ThreadPoolOptions *options);
+void thread_pool_free(ThreadPool *pool);
+int thread_pool_size(const ThreadPool *pool);
+void thread_pool_run(ThreadPool *pool, thread_task_fn fn, void *ctx);  // blocks until every thread returns
+
+// Library-wide pool, created on first use with ML_NUM_THREADS threads
+// (all CPUs when unset). NULL if it could not be created.
+ThreadPool* thread_pool_global(void);
+// Recreate the global pool with options, or free it with NULL (the next
+// thread_pool_global starts a default one). Pointers to the old pool must
+// no longer be in use.
+ml_error_t thread_pool_configure(const ThreadPoolOptions *options);
+// pool if set; otherwise none (serial) for n_threads == 1, the global
+// pool for n_threads <= 0, or a new pool of n_threads that is also
+// returned through *owned for the caller to free
+ThreadPool* thread_pool_select(ThreadPool *pool, int n_threads, ThreadPool **owned);
+
+int thread_num_cpus(void);
+
+// Contiguous block [*begin, *end) of n items owned by thread_id
+static inline void thread_partition(int n, int thread_id, int n_threads, int *begin, int *end) {
+    *begin = (int)((long long)n * thread_id / n_threads);
+    *end = (int)((long long)n * (thread_id + 1) / n_threads);
+}
+
+// Loop body for items [begin, end), run on pool thread thread_id
+typedef void (*parallel_for_fn)(void *ctx, int begin, int end, int thread_id);
+
+// Run fn over [0, n) in chunks of grain items (grain <= 0 picks one).
+// Each thread starts on a contiguous share of the chunks and, when its
+// share runs out, steals chunks from the far end of the other threads'.
+void parallel_for(ThreadPool *pool, int n, int grain, parallel_for_fn fn, void *ctx);
+
+// Reduce items [begin, end) into partial, which starts zeroed
+typedef void (*parallel_map_fn)(void *ctx, int begin, int end, void *partial);
+// Fold partial into acc
+typedef void (*parallel_combine_fn)(void *ctx, void *acc, const void *partial);
+
+#define PARALLEL_REDUCE_MAX_CHUNKS 256
+
+// Deterministic reduction of [0, n) into result (value_size bytes). The
+// chunks depend only on n and grain (grain grows to stay within
+// PARALLEL_REDUCE_MAX_CHUNKS) and are combined in chunk order on the
+// calling thread, so the result is bitwise identical for any pool size.
+ml_error_t parallel_reduce(ThreadPool *pool, int n, int grain, size_t value_size,
+                           parallel_map_fn map, parallel_combine_fn combine, void *ctx, void *result);
+
+#endif
@@ -0,0 +1,170 @@
+#include "arena.h"
+#include "profile.h"
+#include <pthread.h>
+#include <stdint.h>
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t capacity;
+    size_t used;
+} ArenaChunk;
+
+// Chunk payload starts one alignment unit after the header
+#define ARENA_HEADER_SIZE ((sizeof(ArenaChunk) + ML_ALIGNMENT - 1) / ML_ALIGNMENT * ML_ALIGNMENT)
+#define ARENA_MIN_CHUNK (64 * 1024)
+
+struct Arena {
+    ArenaChunk *first;
+    ArenaChunk *current;  // chunk being bumped; chunks after it are spare
+};
+
+static size_t arena_round_up(size_t size) {
+    return (size + ML_ALIGNMENT - 1) / ML_ALIGNMENT * ML_ALIGNMENT;
+}
+
+static ArenaChunk* arena_chunk_create(size_t capacity) {
+    capacity = arena_round_up(capacity < ARENA_MIN_CHUNK ? ARENA_MIN_CHUNK : capacity);
+    void *mem = NULL;
+    if (posix_memalign(&mem, ML_ALIGNMENT, ARENA_HEADER_SIZE + capacity) != 0) return NULL;
+    ML_PROFILE_COUNT(ML_COUNTER_ALLOCATIONS, 1);
+    ArenaChunk *chunk = mem;
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    return chunk;
+}
+
+static char* arena_chunk_data(ArenaChunk *chunk) {
+    return (char*)chunk + ARENA_HEADER_SIZE;
+}
+
+Arena* arena_create(size_t capacity) {
+    Arena *arena = malloc(sizeof(Arena));
+    if (!arena) return NULL;
+    arena->first = arena_chunk_create(capacity);
+    if (!arena->first) {
+        free(arena);
+        return NULL;
+    }
+    arena->current = arena->first;
+    return arena;
+}
+
+void arena_free(Arena *arena) {
+    if (!arena) return;
+    ArenaChunk *chunk = arena->first;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
+void* arena_alloc(Arena *arena, size_t size) {
+    if (!arena) return NULL;
+    size = arena_round_up(size ? size : 1);
+
+    ArenaChunk *chunk = arena->current;
+    while (chunk->capacity - chunk->used < size) {
+        // Reuse a spare chunk left over from an earlier round if it fits,
+        // otherwise splice in a new one at least twice the current size
+        ArenaChunk *next = chunk->next;
+        if (!next || next->capacity < size) {
+            size_t capacity = chunk->capacity * 2;
+            ArenaChunk *fresh = arena_chunk_create(capacity > size ? capacity : size);
+            if (!fresh) return NULL;
+            fresh->next = next;
+            chunk->next = fresh;
+            next = fresh;
+        }
+        next->used = 0;
+        chunk = next;
+    }
+    arena->current = chunk;
+    void *ptr = arena_chunk_data(chunk) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void* arena_calloc(Arena *arena, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) return NULL;
+    void *ptr = arena_alloc(arena, count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void arena_reset(Arena *arena) {
+    if (!arena) return;
+    if (arena->first->next) {
+        // The last round needed several chunks: replace them with one chunk
+        // of the combined size so steady-state rounds never chain
+        size_t total = 0;
+        for (ArenaChunk *c = arena->first; c; c = c->next) total += c->capacity;
+        ArenaChunk *merged = arena_chunk_create(total);
+        if (merged) {
+            ArenaChunk *chunk = arena->first;
+            while (chunk) {
+                ArenaChunk *next = chunk->next;
+                free(chunk);
+                chunk = next;
+            }
+            arena->first = merged;
+        }
+    }
+    arena->first->used = 0;
+    arena->current = arena->first;
+}
+
+ArenaMark arena_mark(const Arena *arena) {
+    ArenaMark mark = {NULL, 0};
+    if (arena) {
+        mark.chunk = arena->current;
+        mark.used = arena->current->used;
+    }
+    return mark;
+}
+
+void arena_release(Arena *arena, ArenaMark mark) {
+    if (!arena || !mark.chunk) return;
+    arena->current = mark.chunk;
+    arena->current->used = mark.used;
+}
+
+size_t arena_used(const Arena *arena) {
+    if (!arena) return 0;
+    size_t used = 0;
+    for (ArenaChunk *c = arena->first; c; c = c->next) {
+        used += c->used;
+        if (c == arena->current) break;
+    }
+    return used;
+}
+
+size_t arena_capacity(const Arena *arena) {
+    if (!arena) return 0;
+    size_t capacity = 0;
+    for (ArenaChunk *c = arena->first; c; c = c->next) capacity += c->capacity;
+    return capacity;
+}
+
+static pthread_key_t arena_scratch_key;
+static pthread_once_t arena_scratch_once = PTHREAD_ONCE_INIT;
+
+static void arena_scratch_destroy(void *arena) {
+    arena_free(arena);
+}
+
+static void arena_scratch_init(void) {
+    pthread_key_create(&arena_scratch_key, arena_scratch_destroy);
+}
+
+Arena* arena_thread_scratch(void) {
+    pthread_once(&arena_scratch_once, arena_scratch_init);
+    Arena *arena = pthread_getspecific(arena_scratch_key);
+    if (!arena) {
+        arena = arena_create(0);
+        if (arena) pthread_setspecific(arena_scratch_key, arena);
+    }
+    return arena;
+}
@@ -0,0 +1,59 @@
+#include "atomic_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define ATOMIC_FILE_MAX_TRIES 16
+
+ml_error_t atomic_file_open(AtomicFile *af, const char *filename) {
+    ML_CHECK_NULL(af);
+    ML_CHECK_NULL(filename);
+    memset(af, 0, sizeof(*af));
+
+    size_t len = strlen(filename) + 48;
+    af->path = malloc(strlen(filename) + 1);
+    af->tmp_path = malloc(len);
+    if (!af->path || !af->tmp_path) {
+        ML_SAFE_FREE(af->path);
+        ML_SAFE_FREE(af->tmp_path);
+        return ML_ERROR_MEMORY_ALLOCATION;
+    }
+    strcpy(af->path, filename);
+
+    // O_EXCL with a per-process counter rather than mkstemp, so the file
+    // gets the usual 0666 & ~umask permissions
+    static unsigned counter;
+    int fd = -1;
+    for (int tries = 0; fd < 0 && tries < ATOMIC_FILE_MAX_TRIES; tries++) {
+        unsigned n = __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+        snprintf(af->tmp_path, len, "%s.tmp.%ld.%u", filename, (long)getpid(), n);
+        fd = open(af->tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd < 0 && errno != EEXIST) break;
+    }
+    if (fd >= 0) af->file = fdopen(fd, "wb");
+    if (!af->file) {
+        if (fd >= 0) {
+            close(fd);
+            unlink(af->tmp_path);
+        }
+        ML_SAFE_FREE(af->path);
+        ML_SAFE_FREE(af->tmp_path);
+        return ML_ERROR_FILE_IO;
+    }
+    return ML_SUCCESS;
+}
+
+ml_error_t atomic_file_commit(AtomicFile *af, bool ok) {
+    ML_CHECK_NULL(af);
+    if (!af->file) return ML_ERROR_FILE_IO;
+
+    if (ok) ok = fflush(af->file) == 0 && fsync(fileno(af->file)) == 0;
+    if (fclose(af->file) != 0) ok = false;
+    if (ok) ok = rename(af->tmp_path, af->path) == 0;
+    if (!ok) unlink(af->tmp_path);
+
+    af->file = NULL;
+    ML_SAFE_FREE(af->path);
+    ML_SAFE_FREE(af->tmp_path);
+    return ok ? ML_SUCCESS : ML_ERROR_FILE_IO;
+}
@@ -1,55 +1,1193 @@
 #include "dataset.h"
+#include "atomic_file.h"
+#include "thread_pool.h"
+#include "profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-Matrix* load_csv(const char *filename) {
-    // simplified CSV parser 
-    FILE *file = fopen(filename, "r");
-    if (!file) return NULL;
-
-    // count rows and cols
-    int rows = 0, cols = 0;
-    char line[1024];
-    if (fgets(line, 1024, file)) {
-        cols = 1;
-        for (char *p = line; *p; p++) if (*p == ',') cols++;
-    }
-    while (fgets(line, 1024, file)) rows++;
-    rows++;  
-    fseek(file, 0, SEEK_SET);
-
-    // load data
-    Matrix *m = matrix_create(rows, cols);
-    int r = 0;
-    while (fgets(line, 1024, file) && r < rows) {
-        char *token = strtok(line, ",");
-        int c = 0;
-        while (token && c < cols) {
-            m->data[r * cols + c] = atof(token);
-            token = strtok(NULL, ",");
-            c++;
-        }
-        r++;
-    }
-    fclose(file);
+// Dataset creation and destruction
+Dataset* dataset_create(int n_samples, int n_features, int n_targets) {
+    if (n_samples <= 0 || n_features <= 0 || n_targets < 0) return NULL;
+    Matrix *features = matrix_create(n_samples, n_features);
+    Matrix *targets = n_targets > 0 ? matrix_create(n_samples, n_targets) : NULL;
+    if (!features || (n_targets > 0 && !targets)) {
+        matrix_free(features);
+        matrix_free(targets);
+        return NULL;
+    }
+    Dataset *dataset = dataset_create_from_matrices(features, targets);
+    if (!dataset) {
+        matrix_free(features);
+        matrix_free(targets);
+    }
+    return dataset;
+}
+
+// Takes ownership of both matrices; targets may be NULL
+Dataset* dataset_create_from_matrices(Matrix *features, Matrix *targets) {
+    if (!matrix_is_valid(features)) return NULL;
+    if (targets && (!matrix_is_valid(targets) || targets->rows != features->rows)) return NULL;
+
+    Dataset *dataset = calloc(1, sizeof(Dataset));
+    if (!dataset) return NULL;
+    dataset->features = features;
+    dataset->targets = targets;
+    dataset->n_samples = features->rows;
+    dataset->n_features = features->cols;
+    dataset->n_targets = targets ? targets->cols : 0;
+    return dataset;
+}
+
+void dataset_free(Dataset *dataset) {
+    if (!dataset) return;
+    matrix_free(dataset->features);
+    matrix_free(dataset->targets);
+    // Names of a mapped dataset point into the mapping; only the arrays are ours
+    if (!dataset->mapping) {
+        for (int i = 0; dataset->feature_names && i < dataset->n_features; i++) free(dataset->feature_names[i]);
+        for (int i = 0; dataset->target_names && i < dataset->n_targets; i++) free(dataset->target_names[i]);
+    }
+    free(dataset->feature_names);
+    free(dataset->target_names);
+    if (dataset->mapping) munmap(dataset->mapping, dataset->mapping_size);
+    free(dataset);
+}
+
+static char** dataset_copy_names(char **names, const int *indices, int n) {
+    if (!names) return NULL;
+    char **out = calloc(n, sizeof(char*));
+    if (!out) return NULL;
+    for (int i = 0; i < n; i++) {
+        const char *name = names[indices ? indices[i] : i];
+        if (!name) continue;
+        out[i] = malloc(strlen(name) + 1);
+        if (out[i]) strcpy(out[i], name);
+    }
+    return out;
+}
+
+// A contiguous ascending run of columns becomes a strided view of the
+// source features (no copy; the result must be freed before the source).
+// Any other selection gathers the columns into a new matrix.
+ml_error_t dataset_select_features(const Dataset *dataset, const int *feature_indices,
+                                  int n_selected, Dataset **result) {
+    ML_CHECK_NULL(dataset);
+    ML_CHECK_NULL(feature_indices);
+    ML_CHECK_NULL(result);
+    *result = NULL;
+    if (!matrix_is_valid(dataset->features) || n_selected <= 0) return ML_ERROR_INVALID_PARAMETER;
+
+    bool run = true;
+    for (int i = 0; i < n_selected; i++) {
+        if (feature_indices[i] < 0 || feature_indices[i] >= dataset->features->cols) {
+            return ML_ERROR_INVALID_PARAMETER;
+        }
+        if (i > 0 && feature_indices[i] != feature_indices[i - 1] + 1) run = false;
+    }
+
+    Matrix *src = dataset->features;
+    Matrix *features;
+    if (run) {
+        features = matrix_view(src, 0, feature_indices[0], src->rows, n_selected);
+    } else {
+        features = matrix_create(src->rows, n_selected);
+        for (int i = 0; features && i < src->rows; i++) {
+            const double *in = matrix_row(src, i);
+            double *out = matrix_row(features, i);
+            for (int j = 0; j < n_selected; j++) out[j] = in[feature_indices[j]];
+        }
+    }
+    Matrix *targets = dataset->targets ? matrix_view(dataset->targets, 0, 0, dataset->targets->rows,
+                                                     dataset->targets->cols) : NULL;
+    Dataset *selected = features && (targets || !dataset->targets)
+                            ? dataset_create_from_matrices(features, targets) : NULL;
+    if (!selected) {
+        matrix_free(features);
+        matrix_free(targets);
+        return ML_ERROR_MEMORY_ALLOCATION;
+    }
+    selected->feature_names = dataset_copy_names(dataset->feature_names, feature_indices, n_selected);
+    if (dataset->target_names && dataset->n_targets > 0) {
+        selected->target_names = dataset_copy_names(dataset->target_names, NULL, dataset->n_targets);
+    }
+    *result = selected;
+    return ML_SUCCESS;
+}
+
+// Powers of ten that are exact in a double, for the fast float path
+static const double csv_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static bool csv_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// strtod on a NUL-terminated copy of [p, end), for inputs the fast path rejects
+static double csv_parse_double_slow(const char *p, const char *end) {
+    char small[128];
+    size_t len = end - p;
+    char *buf = len < sizeof(small) ? small : malloc(len + 1);
+    if (!buf) return 0.0;
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    double value = strtod(buf, NULL);
+    if (buf != small) free(buf);
+    return value;
+}
+
+// Parse one field. Plain decimals with at most 19 significant digits and a
+// small exponent are converted exactly with one multiply or divide
+// (Clinger's fast path); everything else falls back to strtod. Like atof,
+// an empty or malformed field reads as 0.
+static double csv_parse_double(const char *p, const char *end) {
+    const char *s = p;
+    while (s < end && csv_is_space(*s)) s++;
+
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0, exp10 = 0;
+    bool any_digit = false;
+    for (; s < end && *s >= '0' && *s <= '9'; s++) {
+        any_digit = true;
+        if (mantissa == 0 && *s == '0') continue;
+        if (++digits > 19) return csv_parse_double_slow(p, end);
+        mantissa = mantissa * 10 + (*s - '0');
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && *s >= '0' && *s <= '9'; s++) {
+            any_digit = true;
+            exp10--;
+            if (mantissa == 0 && *s == '0') continue;
+            if (++digits > 19) return csv_parse_double_slow(p, end);
+            mantissa = mantissa * 10 + (*s - '0');
+        }
+    }
+    if (!any_digit) return csv_parse_double_slow(p, end);  // inf, nan or junk
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char *e = s + 1;
+        bool exp_negative = false;
+        if (e < end && (*e == '-' || *e == '+')) exp_negative = *e++ == '-';
+        if (e == end || *e < '0' || *e > '9') return csv_parse_double_slow(p, end);
+        int exp_value = 0;
+        for (; e < end && *e >= '0' && *e <= '9'; e++) {
+            if (exp_value < 10000) exp_value = exp_value * 10 + (*e - '0');
+        }
+        exp10 += exp_negative ? -exp_value : exp_value;
+        s = e;
+    }
+    while (s < end && csv_is_space(*s)) s++;
+    if (s != end || mantissa > (1ULL << 53) || exp10 < -22 || exp10 > 22) {
+        return csv_parse_double_slow(p, end);
+    }
+
+    double value = (double)mantissa;
+    value = exp10 < 0 ? value / csv_pow10[-exp10] : value * csv_pow10[exp10];
+    return negative ? -value : value;
+}
+
+// Growable row-major buffer of parsed rows
+typedef struct {
+    double *data;
+    size_t rows;
+    size_t capacity;  // in rows
+    int cols;
+} CsvRows;
+
+static bool csv_rows_reserve(CsvRows *out, size_t rows) {
+    if (rows <= out->capacity) return true;
+    size_t capacity = out->capacity + out->capacity / 2 + 16;
+    if (capacity < rows) capacity = rows;
+    double *data = realloc(out->data, capacity * out->cols * sizeof(double));
+    if (!data) return false;
+    out->data = data;
+    out->capacity = capacity;
+    return true;
+}
+
+static bool csv_line_is_blank(const char *p, const char *end) {
+    while (p < end && csv_is_space(*p)) p++;
+    return p == end;
+}
+
+// Parse every line in [p, end) into out. Short rows are zero-filled, extra
+// fields are ignored and blank lines are skipped.
+static bool csv_parse_lines(const char *p, const char *end, CsvRows *out) {
+    while (p < end) {
+        const char *line_end = memchr(p, '\n', end - p);
+        if (!line_end) line_end = end;
+        if (!csv_line_is_blank(p, line_end)) {
+            if (!csv_rows_reserve(out, out->rows + 1)) return false;
+            double *row = out->data + out->rows * out->cols;
+            const char *field = p;
+            int c = 0;
+            for (; c < out->cols && field <= line_end; c++) {
+                const char *field_end = memchr(field, ',', line_end - field);
+                if (!field_end) field_end = line_end;
+                row[c] = csv_parse_double(field, field_end);
+                field = field_end + 1;
+            }
+            for (; c < out->cols; c++) row[c] = 0.0;
+            out->rows++;
+        }
+        p = line_end + 1;
+    }
+    return true;
+}
+
+// Map the whole file read-only; falls back to reading it into memory for
+// files that cannot be mapped (pipes, some special filesystems)
+static const char* csv_map_file(const char *filename, size_t *size, bool *mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+
+    void *map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+        madvise(map, *size, MADV_SEQUENTIAL);
+        close(fd);
+        *mapped = true;
+        return map;
+    }
+
+    char *buf = malloc(*size);
+    size_t got = 0;
+    while (buf && got < *size) {
+        ssize_t n = read(fd, buf + got, *size - got);
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+    if (!buf || got != *size) {
+        free(buf);
+        return NULL;
+    }
+    *mapped = false;
+    return buf;
+}
+
+static void csv_unmap_file(const char *buf, size_t size, bool mapped) {
+    if (mapped) {
+        munmap((void*)buf, size);
+    } else {
+        free((void*)buf);
+    }
+}
+
+// Below this many bytes per chunk, splitting costs more than it saves
+// (applied when the chunk count is picked automatically)
+#define CSV_MIN_CHUNK_BYTES (1 << 20)
+
+// The file is cut into n_chunks byte ranges, parsed in parallel. Raw split
+// points are moved forward to the next line start, so chunk c parses
+// exactly the lines that begin in its range and the stitched rows keep
+// file order.
+typedef struct {
+    const char *first;      // first data line
+    const char *end;
+    size_t line_hint;       // bytes in the first line, for buffer sizing
+    int cols;
+    int n_chunks;
+    CsvRows *chunks;
+    size_t *row_offsets;    // per chunk, filled before the copy pass
+    double *out;
+    bool *ok;               // per chunk
+} CsvParallelTask;
+
+static const char* csv_chunk_start(const CsvParallelTask *task, int chunk) {
+    if (chunk == 0) return task->first;
+    if (chunk == task->n_chunks) return task->end;
+    size_t len = task->end - task->first;
+    const char *raw = task->first + (size_t)((double)len * chunk / task->n_chunks);
+    if (raw <= task->first) return task->first;
+    const char *newline = memchr(raw - 1, '\n', task->end - (raw - 1));
+    return newline ? newline + 1 : task->end;
+}
+
+static void csv_parse_chunks(void *ctx, int first_chunk, int last_chunk, int thread_id) {
+    CsvParallelTask *task = ctx;
+    (void)thread_id;
+    for (int c = first_chunk; c < last_chunk; c++) {
+        const char *begin = csv_chunk_start(task, c);
+        const char *end = csv_chunk_start(task, c + 1);
+        CsvRows *rows = &task->chunks[c];
+        rows->cols = task->cols;
+        if (begin < end) csv_rows_reserve(rows, (size_t)(end - begin) / task->line_hint + 1);
+        task->ok[c] = csv_parse_lines(begin, end, rows);
+        ML_PROFILE_COUNT(ML_COUNTER_BYTES_PARSED, end - begin);
+    }
+}
+
+static void csv_copy_chunks(void *ctx, int first_chunk, int last_chunk, int thread_id) {
+    CsvParallelTask *task = ctx;
+    (void)thread_id;
+    for (int c = first_chunk; c < last_chunk; c++) {
+        const CsvRows *rows = &task->chunks[c];
+        if (rows->rows > 0) {
+            memcpy(task->out + task->row_offsets[c] * task->cols, rows->data,
+                   rows->rows * task->cols * sizeof(double));
+        }
+    }
+}
+
+static Matrix* csv_load(const char *filename, int n_threads) {
+    // Single pass over a memory-mapped file: the column count comes from the
+    // first non-blank line and rows are appended to buffers that grow
+    // geometrically. With one chunk the buffer becomes the matrix data
+    // without a copy; otherwise the per-chunk buffers are stitched in order.
+    if (!filename) return NULL;
+    ML_PROFILE_BEGIN(ML_PHASE_CSV_SCAN);
+    size_t size;
+    bool mapped;
+    const char *buf = csv_map_file(filename, &size, &mapped);
+    if (!buf) return NULL;
+    const char *end = buf + size;
+
+    const char *first = buf;
+    const char *first_end = memchr(first, '\n', end - first);
+    while (first_end && csv_line_is_blank(first, first_end)) {
+        first = first_end + 1;
+        first_end = memchr(first, '\n', end - first);
+    }
+    if (!first_end) first_end = end;
+    if (csv_line_is_blank(first, first_end)) {
+        csv_unmap_file(buf, size, mapped);
+        ML_PROFILE_END(ML_PHASE_CSV_SCAN);
+        return NULL;
+    }
+
+    int cols = 1;
+    for (const char *p = first; p < first_end; p++) if (*p == ',') cols++;
+    size_t line_hint = (size_t)(first_end - first + 1);
+
+    // One chunk per thread of the pool, fewer for small files
+    ThreadPool *owned_pool;
+    ThreadPool *pool = thread_pool_select(NULL, n_threads, &owned_pool);
+    int n_chunks = thread_pool_size(pool);
+    if (n_threads <= 0) {
+        size_t max_chunks = (size_t)(end - first) / CSV_MIN_CHUNK_BYTES + 1;
+        if ((size_t)n_chunks > max_chunks) n_chunks = (int)max_chunks;
+    }
+
+    CsvParallelTask task = {
+        .first = first,
+        .end = end,
+        .line_hint = line_hint,
+        .cols = cols,
+        .n_chunks = n_chunks,
+        .chunks = calloc(n_chunks, sizeof(CsvRows)),
+        .row_offsets = calloc(n_chunks, sizeof(size_t)),
+        .ok = calloc(n_chunks, sizeof(bool)),
+    };
+    Matrix *m = NULL;
+    ML_PROFILE_END(ML_PHASE_CSV_SCAN);
+    if (!task.chunks || !task.row_offsets || !task.ok) goto done;
+
+    ML_PROFILE_BEGIN(ML_PHASE_CSV_PARSE);
+    parallel_for(pool, n_chunks, 1, csv_parse_chunks, &task);
+    ML_PROFILE_END(ML_PHASE_CSV_PARSE);
+    size_t total_rows = 0;
+    for (int c = 0; c < n_chunks; c++) {
+        if (!task.ok[c]) goto done;
+        task.row_offsets[c] = total_rows;
+        total_rows += task.chunks[c].rows;
+    }
+    if (total_rows == 0) goto done;
+
+    if (n_chunks == 1) {
+        // Hand the single buffer over directly, trimmed to size
+        task.out = realloc(task.chunks[0].data, total_rows * cols * sizeof(double));
+        if (task.out) task.chunks[0].data = task.out;
+        m = matrix_create_from_buffer(task.chunks[0].data, (int)total_rows, cols);
+        if (m) task.chunks[0].data = NULL;
+        goto done;
+    }
+
+    // Stitch the per-chunk rows together in file order
+    task.out = malloc(total_rows * cols * sizeof(double));
+    if (!task.out) goto done;
+    ML_PROFILE_BEGIN(ML_PHASE_CSV_STITCH);
+    parallel_for(pool, n_chunks, 1, csv_copy_chunks, &task);
+    ML_PROFILE_END(ML_PHASE_CSV_STITCH);
+    m = matrix_create_from_buffer(task.out, (int)total_rows, cols);
+    if (!m) free(task.out);
+
+done:
+    if (task.chunks) {
+        for (int c = 0; c < n_chunks; c++) free(task.chunks[c].data);
+    }
+    free(task.chunks);
+    free(task.row_offsets);
+    free(task.ok);
+    thread_pool_free(owned_pool);
+    csv_unmap_file(buf, size, mapped);
     return m;
 }
 
+Matrix* load_csv(const char *filename) {
+    return csv_load(filename, 1);
+}
+
+Matrix* load_csv_parallel(const char *filename, int n_threads) {
+    return csv_load(filename, n_threads);
+}
+
+// libsvm / svmlight text format: one "label index:value ..." line per row,
+// 1-based column indices, anything after '#' a comment. Rows are parsed
+// straight into growing CSR arrays in one pass over the mapped file, so
+// nothing proportional to rows * cols is ever allocated.
+typedef struct {
+    double *values;
+    int *col_idx;
+    size_t nnz;
+    size_t nnz_capacity;
+    size_t *row_ptr;
+    double *labels;
+    size_t rows;
+    size_t row_capacity;
+    int cols;  // highest column index seen
+} LibsvmRows;
+
+static bool libsvm_reserve(LibsvmRows *out, size_t nnz) {
+    if (out->rows + 1 >= out->row_capacity) {
+        size_t capacity = out->row_capacity + out->row_capacity / 2 + 16;
+        size_t *row_ptr = realloc(out->row_ptr, (capacity + 1) * sizeof(size_t));
+        if (row_ptr) out->row_ptr = row_ptr;
+        double *labels = realloc(out->labels, capacity * sizeof(double));
+        if (labels) out->labels = labels;
+        if (!row_ptr || !labels) return false;
+        out->row_capacity = capacity;
+    }
+    if (nnz > out->nnz_capacity) {
+        size_t capacity = out->nnz_capacity + out->nnz_capacity / 2 + 64;
+        if (capacity < nnz) capacity = nnz;
+        double *values = realloc(out->values, capacity * sizeof(double));
+        if (values) out->values = values;
+        int *col_idx = realloc(out->col_idx, capacity * sizeof(int));
+        if (col_idx) out->col_idx = col_idx;
+        if (!values || !col_idx) return false;
+        out->nnz_capacity = capacity;
+    }
+    return true;
+}
+
+static const char* libsvm_token_end(const char *p, const char *end) {
+    while (p < end && !csv_is_space(*p)) p++;
+    return p;
+}
+
+// Insertion sort of one row's entries by column; rows are nearly always
+// already in order, so this is a single check in practice
+static void libsvm_sort_row(double *values, int *col_idx, size_t n) {
+    for (size_t a = 1; a < n; a++) {
+        double v = values[a];
+        int c = col_idx[a];
+        size_t b = a;
+        for (; b > 0 && col_idx[b - 1] > c; b--) {
+            values[b] = values[b - 1];
+            col_idx[b] = col_idx[b - 1];
+        }
+        values[b] = v;
+        col_idx[b] = c;
+    }
+}
+
+// Parse one non-blank line. False on a malformed entry or out of memory.
+static bool libsvm_parse_line(const char *p, const char *end, LibsvmRows *out) {
+    const char *comment = memchr(p, '#', end - p);
+    if (comment) end = comment;
+    while (p < end && csv_is_space(*p)) p++;
+    if (p == end) return true;  // comment-only line
+
+    if (!libsvm_reserve(out, out->nnz)) return false;
+    const char *token_end = libsvm_token_end(p, end);
+    out->labels[out->rows] = csv_parse_double(p, token_end);
+    size_t row_start = out->nnz;
+    bool sorted = true;
+
+    for (p = token_end; ; p = token_end) {
+        while (p < end && csv_is_space(*p)) p++;
+        if (p == end) break;
+        token_end = libsvm_token_end(p, end);
+        if (token_end - p > 4 && memcmp(p, "qid:", 4) == 0) continue;  // ranking data
+
+        long long index = 0;
+        const char *q = p;
+        for (; q < token_end && *q >= '0' && *q <= '9'; q++) {
+            index = index * 10 + (*q - '0');
+            if (index > INT32_MAX) return false;
+        }
+        if (q == p || q == token_end || *q != ':' || index < 1) return false;
+
+        if (!libsvm_reserve(out, out->nnz + 1)) return false;
+        int col = (int)(index - 1);
+        if (out->nnz > row_start && col < out->col_idx[out->nnz - 1]) sorted = false;
+        out->values[out->nnz] = csv_parse_double(q + 1, token_end);
+        out->col_idx[out->nnz++] = col;
+        if (col + 1 > out->cols) out->cols = col + 1;
+    }
+
+    if (!sorted) libsvm_sort_row(out->values + row_start, out->col_idx + row_start, out->nnz - row_start);
+    out->rows++;
+    out->row_ptr[out->rows] = out->nnz;
+    return true;
+}
+
+SparseMatrix* load_libsvm(const char *filename, Matrix **labels) {
+    if (labels) *labels = NULL;
+    if (!filename) return NULL;
+    size_t size;
+    bool mapped;
+    const char *buf = csv_map_file(filename, &size, &mapped);
+    if (!buf) return NULL;
+
+    LibsvmRows rows = {0};
+    bool ok = libsvm_reserve(&rows, size / 16);  // a guess of one nonzero per 16 bytes
+    if (ok) rows.row_ptr[0] = 0;
+    for (const char *p = buf, *end = buf + size; ok && p < end; ) {
+        const char *line_end = memchr(p, '\n', end - p);
+        if (!line_end) line_end = end;
+        if (!csv_line_is_blank(p, line_end)) ok = libsvm_parse_line(p, line_end, &rows);
+        p = line_end + 1;
+    }
+    ML_PROFILE_COUNT(ML_COUNTER_BYTES_PARSED, size);
+    csv_unmap_file(buf, size, mapped);
+
+    SparseMatrix *X = NULL;
+    Matrix *y = NULL;
+    if (ok && rows.rows > 0 && rows.rows <= INT32_MAX) {
+        // An all-empty file still has one column so the matrix is valid
+        X = sparse_create_from_arrays(rows.values, rows.col_idx, rows.row_ptr, (int)rows.rows,
+                                      rows.cols > 0 ? rows.cols : 1);
+        y = labels ? matrix_create_from_array(rows.labels, (int)rows.rows, 1) : NULL;
+    }
+    if (!X || (labels && !y)) {
+        if (X) {
+            sparse_free(X);
+        } else {
+            free(rows.values);
+            free(rows.col_idx);
+            free(rows.row_ptr);
+        }
+        free(rows.labels);
+        matrix_free(y);
+        return NULL;
+    }
+
+    // Trim the arrays to what was used
+    size_t used = X->nnz ? X->nnz : 1;
+    double *values = realloc(X->values, used * sizeof(double));
+    if (values) X->values = values;
+    int *col_idx = realloc(X->col_idx, used * sizeof(int));
+    if (col_idx) X->col_idx = col_idx;
+    free(rows.labels);
+    if (labels) *labels = y;
+    return X;
+}
+
+static bool libsvm_write_row(FILE *file, double label, const double *values, const int *col_idx, size_t n) {
+    fprintf(file, "%.17g", label);
+    for (size_t p = 0; p < n; p++) fprintf(file, " %d:%.17g", col_idx[p] + 1, values[p]);
+    return fputc('\n', file) != EOF;
+}
+
+ml_error_t save_libsvm(const SparseMatrix *X, const Matrix *labels, const char *filename) {
+    ML_CHECK_NULL(X);
+    ML_CHECK_NULL(filename);
+    if (labels && labels->rows != X->rows) return ML_ERROR_DIMENSION_MISMATCH;
+    FILE *file = fopen(filename, "w");
+    if (!file) return ML_ERROR_FILE_IO;
+
+    bool ok = true;
+    for (int i = 0; ok && i < X->rows; i++) {
+        size_t begin = X->row_ptr[i];
+        ok = libsvm_write_row(file, labels ? matrix_row(labels, i)[0] : 0.0, X->values + begin,
+                              X->col_idx + begin, X->row_ptr[i + 1] - begin);
+    }
+    if (fclose(file) != 0) ok = false;
+    return ok ? ML_SUCCESS : ML_ERROR_FILE_IO;
+}
+
+// Densified for the Dataset API; use load_libsvm for data too wide for that
+Dataset* dataset_load_libsvm(const char *filename) {
+    Matrix *labels = NULL;
+    SparseMatrix *X = load_libsvm(filename, &labels);
+    Matrix *features = sparse_to_dense(X);
+    sparse_free(X);
+    Dataset *dataset = features ? dataset_create_from_matrices(features, labels) : NULL;
+    if (!dataset) {
+        matrix_free(features);
+        matrix_free(labels);
+    }
+    return dataset;
+}
+
+// The label is the first target column, or 0 without targets; zero
+// features are left out
+ml_error_t dataset_save_libsvm(const Dataset *dataset, const char *filename) {
+    ML_CHECK_NULL(dataset);
+    ML_CHECK_NULL(filename);
+    if (!matrix_is_valid(dataset->features)) return ML_ERROR_INVALID_PARAMETER;
+    const Matrix *X = dataset->features;
+    double *values = malloc(X->cols * sizeof(double));
+    int *col_idx = malloc(X->cols * sizeof(int));
+    FILE *file = values && col_idx ? fopen(filename, "w") : NULL;
+    if (!file) {
+        free(values);
+        free(col_idx);
+        return values && col_idx ? ML_ERROR_FILE_IO : ML_ERROR_MEMORY_ALLOCATION;
+    }
+
+    bool ok = true;
+    for (int i = 0; ok && i < X->rows; i++) {
+        const double *row = matrix_row(X, i);
+        size_t n = 0;
+        for (int j = 0; j < X->cols; j++) {
+            if (row[j] != 0.0) {
+                values[n] = row[j];
+                col_idx[n++] = j;
+            }
+        }
+        double label = dataset->targets ? matrix_row(dataset->targets, i)[0] : 0.0;
+        ok = libsvm_write_row(file, label, values, col_idx, n);
+    }
+    if (fclose(file) != 0) ok = false;
+    free(values);
+    free(col_idx);
+    return ok ? ML_SUCCESS : ML_ERROR_FILE_IO;
+}
+
+// Binary dataset format. A fixed 128-byte header is followed by 64-byte
+// aligned row-major float64 features and targets, then the feature and
+// target names as consecutive NUL-terminated strings. Loading maps the
+// file and hands out views into it, so it costs O(1) regardless of size.
+#define DATASET_BINARY_MAGIC "MLDSBIN1"
+#define DATASET_BINARY_VERSION 1
+#define DATASET_BINARY_ENDIAN_TAG 0x01020304u
+#define DATASET_BINARY_DTYPE_FLOAT64 1
+#define DATASET_BINARY_ALIGN 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;        // reads back differently on a foreign byte order
+    uint32_t dtype;
+    uint32_t reserved;
+    uint64_t n_samples;
+    uint64_t n_features;
+    uint64_t n_targets;
+    uint64_t features_offset;
+    uint64_t targets_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t file_size;
+    uint64_t payload_checksum;  // features, targets and names
+    uint64_t reserved2[3];
+    uint64_t header_checksum;   // every byte before this field
+} DatasetBinaryHeader;
+
+_Static_assert(sizeof(DatasetBinaryHeader) == 128, "binary dataset header must stay 128 bytes");
+
+// FNV-1a over 64-bit words (bytes for the tail), fast enough to verify
+// multi-gigabyte payloads at memory bandwidth. Chained calls must split
+// the data at the same section boundaries when writing and verifying.
+static uint64_t binary_checksum(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *p = data;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ULL;
+    }
+    for (; i < len; i++) hash = (hash ^ p[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+#define BINARY_CHECKSUM_SEED 0xCBF29CE484222325ULL
+
+static uint64_t binary_align(uint64_t offset) {
+    return (offset + DATASET_BINARY_ALIGN - 1) / DATASET_BINARY_ALIGN * DATASET_BINARY_ALIGN;
+}
+
+static size_t binary_names_size(char **names, int n) {
+    size_t size = 0;
+    for (int i = 0; i < n; i++) size += (names && names[i] ? strlen(names[i]) : 0) + 1;
+    return size;
+}
+
+// Concatenate n names as NUL-terminated strings into buf
+static char* binary_pack_names(char *buf, char **names, int n) {
+    for (int i = 0; i < n; i++) {
+        const char *name = names && names[i] ? names[i] : "";
+        size_t len = strlen(name) + 1;
+        memcpy(buf, name, len);
+        buf += len;
+    }
+    return buf;
+}
+
+static bool binary_write_padding(FILE *file, uint64_t from, uint64_t to) {
+    static const char zeros[DATASET_BINARY_ALIGN] = {0};
+    return to - from <= sizeof(zeros) && fwrite(zeros, 1, to - from, file) == to - from;
+}
+
+// Write features and targets (both dense) with the names and metadata of dataset
+static ml_error_t binary_save(const Dataset *dataset, const Matrix *features, const Matrix *targets,
+                              const char *filename) {
+    int n_targets = matrix_is_valid(targets) ? targets->cols : 0;
+    size_t features_bytes = (size_t)features->rows * features->cols * sizeof(double);
+    size_t targets_bytes = n_targets ? (size_t)targets->rows * n_targets * sizeof(double) : 0;
+
+    DatasetBinaryHeader header = {0};
+    memcpy(header.magic, DATASET_BINARY_MAGIC, sizeof(header.magic));
+    header.version = DATASET_BINARY_VERSION;
+    header.endian_tag = DATASET_BINARY_ENDIAN_TAG;
+    header.dtype = DATASET_BINARY_DTYPE_FLOAT64;
+    header.n_samples = features->rows;
+    header.n_features = features->cols;
+    header.n_targets = n_targets;
+    header.features_offset = binary_align(sizeof(header));
+    header.targets_offset = binary_align(header.features_offset + features_bytes);
+    header.names_offset = header.targets_offset + targets_bytes;
+    header.names_size = binary_names_size(dataset->feature_names, features->cols) +
+                        binary_names_size(dataset->target_names, n_targets);
+    header.file_size = header.names_offset + header.names_size;
+
+    char *names = malloc(header.names_size);
+    if (!names) return ML_ERROR_MEMORY_ALLOCATION;
+    binary_pack_names(binary_pack_names(names, dataset->feature_names, features->cols),
+                      dataset->target_names, n_targets);
+
+    uint64_t checksum = binary_checksum(BINARY_CHECKSUM_SEED, features->data, features_bytes);
+    if (n_targets) checksum = binary_checksum(checksum, targets->data, targets_bytes);
+    header.payload_checksum = binary_checksum(checksum, names, header.names_size);
+    header.header_checksum = binary_checksum(BINARY_CHECKSUM_SEED, &header,
+                                             offsetof(DatasetBinaryHeader, header_checksum));
+
+    AtomicFile out;
+    ml_error_t err = atomic_file_open(&out, filename);
+    if (err != ML_SUCCESS) {
+        free(names);
+        return err;
+    }
+    FILE *file = out.file;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              binary_write_padding(file, sizeof(header), header.features_offset) &&
+              fwrite(features->data, 1, features_bytes, file) == features_bytes &&
+              binary_write_padding(file, header.features_offset + features_bytes, header.targets_offset) &&
+              (!n_targets || fwrite(targets->data, 1, targets_bytes, file) == targets_bytes) &&
+              fwrite(names, 1, header.names_size, file) == header.names_size;
+    free(names);
+    return atomic_file_commit(&out, ok);
+}
+
+ml_error_t dataset_save_binary(const Dataset *dataset, const char *filename) {
+    ML_CHECK_NULL(dataset);
+    ML_CHECK_NULL(filename);
+    if (!matrix_is_valid(dataset->features)) return ML_ERROR_INVALID_DATA;
+
+    // The file stores dense row-major sections; compact strided views first
+    Matrix *features = matrix_is_contiguous(dataset->features) ? NULL : matrix_copy(dataset->features);
+    Matrix *targets = !dataset->targets || matrix_is_contiguous(dataset->targets) ? NULL : matrix_copy(dataset->targets);
+    ml_error_t err = ML_ERROR_MEMORY_ALLOCATION;
+    if ((features || matrix_is_contiguous(dataset->features)) &&
+        (targets || !dataset->targets || matrix_is_contiguous(dataset->targets))) {
+        err = binary_save(dataset, features ? features : dataset->features,
+                          targets ? targets : dataset->targets, filename);
+    }
+    matrix_free(features);
+    matrix_free(targets);
+    return err;
+}
+
+// Split a run of NUL-terminated strings into n pointers into the mapping
+static char** binary_read_names(char **cursor, const char *end, int n) {
+    char **names = calloc(n > 0 ? n : 1, sizeof(char*));
+    if (!names) return NULL;
+    for (int i = 0; i < n; i++) {
+        char *nul = memchr(*cursor, '\0', end - *cursor);
+        if (!nul) {
+            free(names);
+            return NULL;
+        }
+        names[i] = *cursor;
+        *cursor = nul + 1;
+    }
+    return names;
+}
+
+static bool binary_header_is_valid(const DatasetBinaryHeader *h, size_t file_size) {
+    if (memcmp(h->magic, DATASET_BINARY_MAGIC, sizeof(h->magic)) != 0) return false;
+    if (h->version != DATASET_BINARY_VERSION || h->endian_tag != DATASET_BINARY_ENDIAN_TAG) return false;
+    if (h->dtype != DATASET_BINARY_DTYPE_FLOAT64) return false;
+    if (h->header_checksum != binary_checksum(BINARY_CHECKSUM_SEED, h,
+                                              offsetof(DatasetBinaryHeader, header_checksum))) return false;
+    if (h->file_size != file_size) return false;
+    if (h->n_samples == 0 || h->n_samples > INT32_MAX || h->n_features == 0 ||
+        h->n_features > INT32_MAX || h->n_targets > INT32_MAX) return false;
+    if (h->features_offset % DATASET_BINARY_ALIGN || h->targets_offset % DATASET_BINARY_ALIGN) return false;
+
+    // Sections must lie inside the file in order, without overflow
+    uint64_t row_bytes = h->n_samples * sizeof(double);
+    if (h->n_features > (UINT64_MAX - h->features_offset) / row_bytes) return false;
+    if (h->features_offset < sizeof(*h) ||
+        h->features_offset + h->n_features * row_bytes > h->targets_offset) return false;
+    if (h->n_targets > (UINT64_MAX - h->targets_offset) / row_bytes) return false;
+    if (h->targets_offset + h->n_targets * row_bytes > h->names_offset) return false;
+    return h->names_offset <= file_size && h->names_size == file_size - h->names_offset;
+}
+
+Dataset* dataset_load_binary(const char *filename, bool verify_checksum) {
+    if (!filename) return NULL;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DatasetBinaryHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+
+    // Private writable mapping: pages stay shared in the page cache until a
+    // caller modifies them (e.g. in-place normalization), which copies on write
+    char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    const DatasetBinaryHeader *h = (const DatasetBinaryHeader*)map;
+    if (!binary_header_is_valid(h, size)) {
+        munmap(map, size);
+        return NULL;
+    }
+    // The header is always checked; scanning the payload is opt-in since it
+    // touches every page and gives up the O(1) load
+    if (verify_checksum) {
+        uint64_t checksum = binary_checksum(BINARY_CHECKSUM_SEED, map + h->features_offset,
+                                            h->n_samples * h->n_features * sizeof(double));
+        checksum = binary_checksum(checksum, map + h->targets_offset,
+                                   h->n_samples * h->n_targets * sizeof(double));
+        checksum = binary_checksum(checksum, map + h->names_offset, h->names_size);
+        if (checksum != h->payload_checksum) {
+            munmap(map, size);
+            return NULL;
+        }
+    }
+
+    int n_samples = (int)h->n_samples, n_features = (int)h->n_features, n_targets = (int)h->n_targets;
+    Matrix *features = matrix_view_buffer((double*)(map + h->features_offset), n_samples, n_features);
+    Matrix *targets = n_targets ? matrix_view_buffer((double*)(map + h->targets_offset), n_samples, n_targets) : NULL;
+    Dataset *dataset = features && (targets || !n_targets) ? dataset_create_from_matrices(features, targets) : NULL;
+    if (!dataset) {
+        matrix_free(features);
+        matrix_free(targets);
+        munmap(map, size);
+        return NULL;
+    }
+    dataset->mapping = map;
+    dataset->mapping_size = size;
+
+    char *cursor = map + h->names_offset;
+    dataset->feature_names = binary_read_names(&cursor, map + size, n_features);
+    dataset->target_names = binary_read_names(&cursor, map + size, n_targets);
+    if (!dataset->feature_names || !dataset->target_names) {
+        dataset_free(dataset);
+        return NULL;
+    }
+    return dataset;
+}
+
+// Column statistics engine. Rows are read in storage order and every
+// column's running min/max/mean/M2 is updated per row (Welford), so one
+// pass over contiguous memory yields all four statistics and the inner
+// loop vectorizes across columns. Rows are split into fixed blocks whose
+// partial statistics are merged in block order (Chan et al.), making the
+// result independent of the thread count.
+#define STATS_BLOCK_ROWS 8192
+
+// Below this many elements per chunk, threading costs more than it saves
+#define NORMALIZE_MIN_CHUNK_ELEMS (1 << 18)
+
+// Through the dataset API a column counts as constant when its spread is
+// rounding noise next to its magnitude (a constant 1e8 column can pick up a
+// few ulps of standard deviation). Relative, so small-scale features are
+// still rescaled.
+#define NORMALIZE_CONSTANT_RTOL 1e-12
+
+typedef struct {
+    double count;
+    double *mean;
+    double *m2;   // sum of squared deviations from the mean
+    double *min;
+    double *max;
+} ColumnStats;
+
+typedef struct {
+    const Matrix *m;
+    ColumnStats *blocks;
+    int n_blocks;
+} StatsTask;
+
+typedef struct {
+    Matrix *m;
+    const double *shift;
+    const double *divisor;
+    const double *scale;
+    const double *base;
+} NormalizeTask;
+
+static void stats_block(const Matrix *m, int begin, int end, ColumnStats *s) {
+    int cols = m->cols;
+    double *restrict mean = s->mean, *restrict m2 = s->m2;
+    double *restrict lo = s->min, *restrict hi = s->max;
+    const double *first = matrix_row(m, begin);
+    memcpy(mean, first, cols * sizeof(double));
+    memcpy(lo, first, cols * sizeof(double));
+    memcpy(hi, first, cols * sizeof(double));
+    memset(m2, 0, cols * sizeof(double));
+
+    for (int i = begin + 1; i < end; i++) {
+        const double *restrict x = matrix_row(m, i);
+        double inv_n = 1.0 / (i - begin + 1);
+        for (int j = 0; j < cols; j++) {
+            double delta = x[j] - mean[j];
+            mean[j] += delta * inv_n;
+            m2[j] += delta * (x[j] - mean[j]);
+            lo[j] = x[j] < lo[j] ? x[j] : lo[j];
+            hi[j] = x[j] > hi[j] ? x[j] : hi[j];
+        }
+    }
+    s->count = end - begin;
+}
+
+static void stats_merge(ColumnStats *into, const ColumnStats *other, int cols) {
+    double n = into->count + other->count;
+    double weight = other->count / n;
+    double cross = into->count * other->count / n;
+    for (int j = 0; j < cols; j++) {
+        double delta = other->mean[j] - into->mean[j];
+        into->mean[j] += delta * weight;
+        into->m2[j] += other->m2[j] + delta * delta * cross;
+        if (other->min[j] < into->min[j]) into->min[j] = other->min[j];
+        if (other->max[j] > into->max[j]) into->max[j] = other->max[j];
+    }
+    into->count = n;
+}
+
+static void stats_blocks(void *ctx, int begin, int end, int thread_id) {
+    StatsTask *task = ctx;
+    (void)thread_id;
+    for (int b = begin; b < end; b++) {
+        int row_end = (b + 1) * STATS_BLOCK_ROWS;
+        if (row_end > task->m->rows) row_end = task->m->rows;
+        stats_block(task->m, b * STATS_BLOCK_ROWS, row_end, &task->blocks[b]);
+    }
+}
+
+// x' = (x - shift) / divisor * scale + base for every element of rows
+// [begin, end). Subtracting first keeps precision on columns with a large
+// mean, and dividing by the range rather than multiplying by its
+// reciprocal sends a column's max to exactly 1 under min-max scaling.
+static void normalize_rows(void *ctx, int begin, int end, int thread_id) {
+    NormalizeTask *task = ctx;
+    int cols = task->m->cols;
+    const double *restrict shift = task->shift, *restrict divisor = task->divisor;
+    const double *restrict scale = task->scale, *restrict base = task->base;
+    (void)thread_id;
+    for (int i = begin; i < end; i++) {
+        double *restrict x = matrix_row(task->m, i);
+        for (int j = 0; j < cols; j++) x[j] = (x[j] - shift[j]) / divisor[j] * scale[j] + base[j];
+    }
+}
+
+static NormalizationParams* normalization_params_create(int n_features, normalize_t type) {
+    NormalizationParams *params = calloc(1, sizeof(NormalizationParams));
+    double *arrays = calloc(4 * (size_t)n_features, sizeof(double));
+    if (!params || !arrays) {
+        free(params);
+        free(arrays);
+        return NULL;
+    }
+    params->means = arrays;
+    params->stds = arrays + n_features;
+    params->mins = arrays + 2 * (size_t)n_features;
+    params->maxs = arrays + 3 * (size_t)n_features;
+    params->n_features = n_features;
+    params->type = type;
+    params->range_min = 0.0;
+    params->range_max = 1.0;
+    return params;
+}
+
+void normalization_params_free(NormalizationParams *params) {
+    if (params) {
+        free(params->means);  // one allocation holds all four arrays
+        free(params);
+    }
+}
+
+static ml_error_t stats_compute(const Matrix *m, ThreadPool *pool, NormalizationParams *params) {
+    int cols = m->cols;
+    int n_blocks = (m->rows + STATS_BLOCK_ROWS - 1) / STATS_BLOCK_ROWS;
+    ColumnStats *blocks = calloc(n_blocks, sizeof(ColumnStats));
+    double *arrays = malloc((size_t)n_blocks * 4 * cols * sizeof(double));
+    if (!blocks || !arrays) {
+        free(blocks);
+        free(arrays);
+        return ML_ERROR_MEMORY_ALLOCATION;
+    }
+    for (int b = 0; b < n_blocks; b++) {
+        double *base = arrays + (size_t)b * 4 * cols;
+        blocks[b] = (ColumnStats){ 0.0, base, base + cols, base + 2 * cols, base + 3 * cols };
+    }
+
+    StatsTask task = { m, blocks, n_blocks };
+    parallel_for(pool, n_blocks, 1, stats_blocks, &task);
+    for (int b = 1; b < n_blocks; b++) stats_merge(&blocks[0], &blocks[b], cols);
+
+    memcpy(params->means, blocks[0].mean, cols * sizeof(double));
+    memcpy(params->mins, blocks[0].min, cols * sizeof(double));
+    memcpy(params->maxs, blocks[0].max, cols * sizeof(double));
+    for (int j = 0; j < cols; j++) {
+        params->stds[j] = sqrt(fmax(0.0, blocks[0].m2[j] / blocks[0].count));
+    }
+    free(arrays);
+    free(blocks);
+    return ML_SUCCESS;
+}
+
+// Fold params into per-column shift/divisor/scale/base. Columns whose
+// spread is at most rtol times their magnitude count as constant and keep
+// divisor and scale 1, so z-scoring centres them and min-max sends them to
+// range_min.
+static ml_error_t normalize_apply(Matrix *m, const NormalizationParams *params, double rtol, ThreadPool *pool) {
+    if (params->type == NORMALIZE_NONE) return ML_SUCCESS;
+    int cols = m->cols;
+    double *shift = malloc(4 * (size_t)cols * sizeof(double));
+    if (!shift) return ML_ERROR_MEMORY_ALLOCATION;
+    double *divisor = shift + cols, *scale = shift + 2 * (size_t)cols, *base = shift + 3 * (size_t)cols;
+
+    for (int j = 0; j < cols; j++) {
+        if (params->type == NORMALIZE_ZSCORE) {
+            double std = params->stds[j];
+            shift[j] = params->means[j];
+            divisor[j] = std > rtol * fabs(params->means[j]) ? std : 1.0;
+            scale[j] = 1.0;
+            base[j] = 0.0;
+        } else {
+            double range = params->maxs[j] - params->mins[j];
+            double magnitude = fmax(fabs(params->mins[j]), fabs(params->maxs[j]));
+            bool spread = range > rtol * magnitude;
+            shift[j] = params->mins[j];
+            divisor[j] = spread ? range : 1.0;
+            scale[j] = spread ? params->range_max - params->range_min : 1.0;
+            base[j] = params->range_min;
+        }
+    }
+
+    NormalizeTask task = { m, shift, divisor, scale, base };
+    int grain = NORMALIZE_MIN_CHUNK_ELEMS / cols + 1;
+    parallel_for(pool, m->rows, grain, normalize_rows, &task);
+    free(shift);
+    return ML_SUCCESS;
+}
+
+ml_error_t dataset_fit_normalization(const Dataset *dataset, normalize_t type, NormalizationParams **params) {
+    ML_CHECK_NULL(dataset);
+    ML_CHECK_NULL(params);
+    *params = NULL;
+    if (!matrix_is_valid(dataset->features)) return ML_ERROR_INVALID_PARAMETER;
+
+    NormalizationParams *fitted = normalization_params_create(dataset->features->cols, type);
+    if (!fitted) return ML_ERROR_MEMORY_ALLOCATION;
+    ml_error_t err = stats_compute(dataset->features, thread_pool_global(), fitted);
+    if (err != ML_SUCCESS) {
+        normalization_params_free(fitted);
+        return err;
+    }
+    *params = fitted;
+    return ML_SUCCESS;
+}
+
+ml_error_t dataset_apply_normalization(Dataset *dataset, const NormalizationParams *params) {
+    ML_CHECK_NULL(dataset);
+    ML_CHECK_NULL(params);
+    if (!matrix_is_valid(dataset->features)) return ML_ERROR_INVALID_PARAMETER;
+    if (params->n_features != dataset->features->cols) return ML_ERROR_DIMENSION_MISMATCH;
+
+    return normalize_apply(dataset->features, params, NORMALIZE_CONSTANT_RTOL, thread_pool_global());
+}
+
+static ml_error_t dataset_fit_apply(Dataset *dataset, NormalizationParams *fitted, NormalizationParams **params) {
+    ThreadPool *pool = thread_pool_global();
+    ml_error_t err = stats_compute(dataset->features, pool, fitted);
+    if (err == ML_SUCCESS) err = normalize_apply(dataset->features, fitted, NORMALIZE_CONSTANT_RTOL, pool);
+
+    if (err == ML_SUCCESS && params) {
+        *params = fitted;
+    } else {
+        normalization_params_free(fitted);
+    }
+    return err;
+}
+
+ml_error_t dataset_normalize(Dataset *dataset, normalize_t type, NormalizationParams **params) {
+    ML_CHECK_NULL(dataset);
+    if (params) *params = NULL;
+    if (!matrix_is_valid(dataset->features)) return ML_ERROR_INVALID_PARAMETER;
+
+    NormalizationParams *fitted = normalization_params_create(dataset->features->cols, type);
+    if (!fitted) return ML_ERROR_MEMORY_ALLOCATION;
+    return dataset_fit_apply(dataset, fitted, params);
+}
+
+ml_error_t dataset_standardize(Dataset *dataset, NormalizationParams **params) {
+    return dataset_normalize(dataset, NORMALIZE_ZSCORE, params);
+}
+
+ml_error_t dataset_minmax_scale(Dataset *dataset, double min_val, double max_val, NormalizationParams **params) {
+    ML_CHECK_NULL(dataset);
+    if (params) *params = NULL;
+    if (!matrix_is_valid(dataset->features) || !(min_val < max_val)) return ML_ERROR_INVALID_PARAMETER;
+
+    NormalizationParams *fitted = normalization_params_create(dataset->features->cols, NORMALIZE_MINMAX);
+    if (!fitted) return ML_ERROR_MEMORY_ALLOCATION;
+    fitted->range_min = min_val;
+    fitted->range_max = max_val;
+    return dataset_fit_apply(dataset, fitted, params);
+}
+
 void normalize_matrix(Matrix *m) {
-    // min max normalization 
-    for (int j = 0; j < m->cols; j++) {
-        double min_val = m->data[j], max_val = m->data[j];
-        for (int i = 0; i < m->rows; i++) {
-            double val = m->data[i * m->cols + j];
-            if (val < min_val) min_val = val;
-            if (val > max_val) max_val = val;
-        }
-        double range = max_val - min_val;
-        if (range > 0) {
-            for (int i = 0; i < m->rows; i++) {
-                m->data[i * m->cols + j] = (m->data[i * m->cols + j] - min_val) / range;
+    if (!matrix_is_valid(m)) return;
+    NormalizationParams *params = normalization_params_create(m->cols, NORMALIZE_MINMAX);
+    if (!params) return;
+    ThreadPool *pool = thread_pool_global();
+    if (stats_compute(m, pool, params) == ML_SUCCESS) {
+        // As before, any column with range > 0 is rescaled and constant
+        // ones are left as they are; an identity range gives them scale 1
+        // and offset 0
+        for (int j = 0; j < m->cols; j++) {
+            if (!(params->maxs[j] - params->mins[j] > 0)) {
+                params->mins[j] = 0.0;
+                params->maxs[j] = 1.0;
             }
         }
+        normalize_apply(m, params, 0.0, pool);
     }
-}
\ No newline at end of file
+    normalization_params_free(params);
+}
@@ -1,12 +1,28 @@
 #include "kmeans.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "profile.h"
+#include "model_io.h"
+#include "ml_random.h"
 #include <stdlib.h>
+#include <stdint.h>
 #include <math.h>
 
 KMeans* kmeans_create(int k, int n_features) {
     KMeans *km = (KMeans*)malloc(sizeof(KMeans));
     km->k = k;
+    km->n_threads = 1;
+    km->pool = NULL;
+    km->algorithm = KMEANS_LLOYD;
+    km->init = KMEANS_INIT_PLUSPLUS;
+    km->seed = 0;
+    km->n_iter = 0;
+    km->inertia = 0.0;
     km->centroids = matrix_create(k, n_features);
     km->assignments = (int*)calloc(1, sizeof(int));  // Dynamically resized in fit
+    km->centroid_counts = (double*)calloc(k, sizeof(double));
+    km->mapping = NULL;
+    km->mapping_size = 0;
     return km;
 }
 
@@ -14,91 +30,1191 @@ void kmeans_free(KMeans *km) {
     if (km) {
         matrix_free(km->centroids);
         free(km->assignments);
+        free(km->centroid_counts);
+        model_file_unmap(km->mapping, km->mapping_size);
         free(km);
     }
 }
 
+// Model file layout: centroids, then the per-centroid sample counts as a
+// 1 x k row so mini-batch updates can resume after a load. n_threads is
+// a setting of the process using the model, so it is not saved.
+enum { KMEANS_FILE_K, KMEANS_FILE_ALGORITHM, KMEANS_FILE_INIT, KMEANS_FILE_SEED,
+       KMEANS_FILE_N_ITER };
+enum { KMEANS_FILE_INERTIA };
+
+ml_error_t kmeans_save(const KMeans *km, const char *filename) {
+    ML_CHECK_NULL(km);
+    ML_CHECK_NULL(filename);
+    ModelParams params = {0};
+    params.ints[KMEANS_FILE_K] = km->k;
+    params.ints[KMEANS_FILE_ALGORITHM] = km->algorithm;
+    params.ints[KMEANS_FILE_INIT] = km->init;
+    params.ints[KMEANS_FILE_SEED] = km->seed;
+    params.ints[KMEANS_FILE_N_ITER] = km->n_iter;
+    params.reals[KMEANS_FILE_INERTIA] = km->inertia;
+    Matrix counts = { .data = km->centroid_counts, .rows = 1, .cols = km->k, .stride = km->k, .is_view = true };
+    const Matrix *sections[] = { km->centroids, &counts };
+    return model_file_save(filename, MODEL_FILE_KMEANS, &params, sections, 2);
+}
+
+KMeans* kmeans_load(const char *filename, bool verify_checksum) {
+    ModelFile file;
+    if (model_file_open(filename, MODEL_FILE_KMEANS, verify_checksum, &file) != ML_SUCCESS) return NULL;
+    const int64_t *ints = file.params.ints;
+    Matrix *centroids = file.sections[0], *counts = file.sections[1];
+    int64_t k = ints[KMEANS_FILE_K];
+    if (file.n_sections != 2 || !centroids || !counts || centroids->rows != k ||
+        counts->rows != 1 || counts->cols != k) {
+        model_file_close(&file);
+        return NULL;
+    }
+
+    KMeans *km = kmeans_create((int)k, centroids->cols);
+    if (!km || !km->assignments || !km->centroid_counts) {
+        kmeans_free(km);
+        model_file_close(&file);
+        return NULL;
+    }
+    km->algorithm = (kmeans_algorithm_t)ints[KMEANS_FILE_ALGORITHM];
+    km->init = (kmeans_init_t)ints[KMEANS_FILE_INIT];
+    km->seed = (unsigned int)ints[KMEANS_FILE_SEED];
+    km->n_iter = (int)ints[KMEANS_FILE_N_ITER];
+    km->inertia = file.params.reals[KMEANS_FILE_INERTIA];
+    memcpy(km->centroid_counts, counts->data, k * sizeof(double));
+
+    // The centroids stay in the mapping, which the model now owns
+    matrix_free(km->centroids);
+    km->centroids = centroids;
+    file.sections[0] = NULL;
+    km->mapping = file.mapping;
+    km->mapping_size = file.mapping_size;
+    file.mapping = NULL;
+    model_file_close(&file);
+    return km;
+}
+
+// Elkan's k bounds per point only pay for their O(k) upkeep when distance
+// evaluations are expensive; below this dimensionality Hamerly is faster
+#define KMEANS_ELKAN_MIN_FEATURES 128
+
+// Brute-force assignment with many centroids in high dimension runs on GEMM:
+// |x - c|^2 = |x|^2 - 2 x.c + |c|^2, and |x|^2 is the same for every c, so
+// the argmin needs only |c|^2 and one product of a row block with C^T.
+// Below these sizes the per-pair sq_dist kernel is as fast and exact.
+#define KMEANS_GEMM_MIN_CLUSTERS 16
+#define KMEANS_GEMM_MIN_FEATURES 16
+#define KMEANS_GEMM_ROWS 256
+
+static bool kmeans_use_gemm(int k, int n_features) {
+    return k >= KMEANS_GEMM_MIN_CLUSTERS && n_features >= KMEANS_GEMM_MIN_FEATURES;
+}
+
+// Header for rows [begin, begin + rows) of data, to hand a block to GEMM
+static Matrix kmeans_row_block(const Matrix *data, int begin, int rows) {
+    return (Matrix){ .data = matrix_row(data, begin), .rows = rows, .cols = data->cols,
+                     .stride = data->stride, .is_view = true };
+}
+
+// C^T (n_features x k) and |c_j|^2, refreshed whenever the centroids move
+static void kmeans_gemm_operands(const Matrix *centroids, Matrix *centroids_t, double *centroid_norms) {
+    const simd_kernels_t *simd = simd_kernels();
+    matrix_transpose(centroids, centroids_t);
+    for (int j = 0; j < centroids->rows; j++) {
+        centroid_norms[j] = simd->sum_sq(matrix_row(centroids, j), centroids->cols);
+    }
+}
+
+// Nearest centroid for each row of block. dots is block->rows x k scratch.
+// score receives |c|^2 - 2 x.c for the winner; add |x|^2 for the distance.
+static void kmeans_gemm_nearest(const Matrix *block, const Matrix *centroids_t, const double *centroid_norms,
+                                double *dots, int *best, double *score) {
+    int k = centroids_t->cols;
+    Matrix product = { .data = dots, .rows = block->rows, .cols = k, .stride = k, .is_view = true };
+    matrix_multiply(block, centroids_t, &product);
+    ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, (uint64_t)block->rows * k);
+    for (int r = 0; r < block->rows; r++) {
+        const double *row = dots + (size_t)r * k;
+        double min_score = INFINITY;
+        int best_cluster = 0;
+        for (int j = 0; j < k; j++) {
+            double s = centroid_norms[j] - 2.0 * row[j];
+            if (s < min_score) {
+                min_score = s;
+                best_cluster = j;
+            }
+        }
+        best[r] = best_cluster;
+        score[r] = min_score;
+    }
+}
+
+// Shared state for one parallel assign + accumulate pass. Each thread owns a
+// contiguous block of samples and its own slice of partial_sums/counts, so
+// the pass needs no locks and the reduction order is fixed.
+typedef struct {
+    const Matrix *data;
+    const Matrix *centroids;
+    int *assignments;
+    double *partial_sums;  // n_threads x k x n_features
+    double *partial_counts;  // n_threads x k
+    int *changed;          // per thread
+    int k;
+    kmeans_algorithm_t algorithm;
+    bool first_pass;
+    const Matrix *centroids_t;     // Lloyd on GEMM only: C^T and |c|^2
+    const double *centroid_norms;
+
+    // Triangle inequality state (Hamerly/Elkan only)
+    double *upper;             // n: upper bound on distance to own centroid
+    double *lower;             // n (Hamerly) or n x k (Elkan) lower bounds
+    double *centroid_dist;     // k x k distances between centroids
+    double *half_min_dist;     // k: half distance to the nearest other centroid
+    double *shift;             // k: distance each centroid moved last update
+    double max_shift;          // largest shift, and the index it belongs to
+    double second_shift;
+    int max_shift_idx;
+} KMeansAssignTask;
+
+// Full scan over all centroids, returning the nearest and second-nearest
+// Euclidean distances for the bound initialisation
+static int kmeans_nearest(const simd_kernels_t *simd, const double *x, const double *centroids,
+                          int k, int n_features, double *best_dist, double *second_dist) {
+    double d1 = INFINITY, d2 = INFINITY;
+    int best = 0;
+    ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, k);
+    for (int j = 0; j < k; j++) {
+        double dist = simd->sq_dist(x, centroids + j * n_features, n_features);
+        if (dist < d1) {
+            d2 = d1;
+            d1 = dist;
+            best = j;
+        } else if (dist < d2) {
+            d2 = dist;
+        }
+    }
+    *best_dist = sqrt(d1);
+    *second_dist = sqrt(d2);
+    return best;
+}
+
+static int kmeans_assign_lloyd(KMeansAssignTask *task, const simd_kernels_t *simd, int i, const double *x) {
+    int n_features = task->data->cols;
+    double min_dist = INFINITY;
+    int best_cluster = 0;
+    (void)i;
+    ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, task->k);
+    for (int j = 0; j < task->k; j++) {
+        double dist = simd->sq_dist(x, task->centroids->data + j * n_features, n_features);
+        if (dist < min_dist) {
+            min_dist = dist;
+            best_cluster = j;
+        }
+    }
+    return best_cluster;
+}
+
+static int kmeans_assign_hamerly(KMeansAssignTask *task, const simd_kernels_t *simd, int i, const double *x) {
+    int n_features = task->data->cols;
+    const double *centroids = task->centroids->data;
+    double *u = &task->upper[i], *l = &task->lower[i];
+
+    if (task->first_pass) {
+        return kmeans_nearest(simd, x, centroids, task->k, n_features, u, l);
+    }
+
+    // Loosen the bounds by how far the centroids moved
+    int a = task->assignments[i];
+    *u += task->shift[a];
+    *l -= a == task->max_shift_idx ? task->second_shift : task->max_shift;
+
+    double bound = fmax(task->half_min_dist[a], *l);
+    if (*u <= bound) return a;
+    *u = sqrt(simd->sq_dist(x, centroids + a * n_features, n_features));
+    ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, 1);
+    if (*u <= bound) return a;
+    return kmeans_nearest(simd, x, centroids, task->k, n_features, u, l);
+}
+
+static int kmeans_assign_elkan(KMeansAssignTask *task, const simd_kernels_t *simd, int i, const double *x) {
+    int k = task->k, n_features = task->data->cols;
+    const double *centroids = task->centroids->data;
+    double *l = task->lower + (size_t)i * k;
+    double *u = &task->upper[i];
+
+    if (task->first_pass) {
+        int best = 0;
+        ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, k);
+        for (int j = 0; j < k; j++) {
+            l[j] = sqrt(simd->sq_dist(x, centroids + j * n_features, n_features));
+            if (l[j] < l[best]) best = j;
+        }
+        *u = l[best];
+        return best;
+    }
+
+    int a = task->assignments[i];
+    *u += task->shift[a];
+    for (int j = 0; j < k; j++) {
+        l[j] = fmax(0.0, l[j] - task->shift[j]);
+    }
+    if (*u <= task->half_min_dist[a]) return a;
+
+    bool tight = false;
+    for (int j = 0; j < k; j++) {
+        if (j == a) continue;
+        double bound = fmax(l[j], 0.5 * task->centroid_dist[a * k + j]);
+        if (*u <= bound) continue;
+        if (!tight) {
+            *u = sqrt(simd->sq_dist(x, centroids + a * n_features, n_features));
+            l[a] = *u;
+            ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, 1);
+            tight = true;
+            if (*u <= bound) continue;
+        }
+        double dist = sqrt(simd->sq_dist(x, centroids + j * n_features, n_features));
+        l[j] = dist;
+        ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, 1);
+        if (dist < *u) {
+            a = j;
+            *u = dist;
+        }
+    }
+    return a;
+}
+
+// Record x's assignment and add it to this thread's partial sums; returns
+// whether the assignment changed
+static int kmeans_absorb(KMeansAssignTask *task, const simd_kernels_t *simd, int i, const double *x,
+                         int best_cluster, double *sums, double *counts) {
+    int n_features = task->data->cols;
+    int changed = task->assignments[i] != best_cluster;
+    task->assignments[i] = best_cluster;
+    counts[best_cluster] += 1.0;
+    simd->add(sums + best_cluster * n_features, x, sums + best_cluster * n_features, n_features);
+    return changed;
+}
+
+static void kmeans_assign_block(void *ctx, int thread_id, int n_threads) {
+    KMeansAssignTask *task = ctx;
+    int n_features = task->data->cols;
+    double *sums = task->partial_sums + (size_t)thread_id * task->k * n_features;
+    double *counts = task->partial_counts + (size_t)thread_id * task->k;
+    const simd_kernels_t *simd = simd_kernels();
+    int changed = 0;
+
+    memset(sums, 0, (size_t)task->k * n_features * sizeof(double));
+    memset(counts, 0, (size_t)task->k * sizeof(double));
+
+    int begin, end;
+    thread_partition(task->data->rows, thread_id, n_threads, &begin, &end);
+    int i = begin;
+
+    // GEMM path: score a block of rows at once, dot products in thread scratch
+    Arena *scratch = task->centroids_t ? arena_thread_scratch() : NULL;
+    ArenaMark mark = scratch ? arena_mark(scratch) : (ArenaMark){0};
+    double *dots = scratch ? arena_alloc(scratch, (size_t)KMEANS_GEMM_ROWS * task->k * sizeof(double)) : NULL;
+    if (dots) {
+        int best[KMEANS_GEMM_ROWS];
+        double score[KMEANS_GEMM_ROWS];
+        for (; i < end; i += KMEANS_GEMM_ROWS) {
+            int rows = end - i < KMEANS_GEMM_ROWS ? end - i : KMEANS_GEMM_ROWS;
+            Matrix block = kmeans_row_block(task->data, i, rows);
+            kmeans_gemm_nearest(&block, task->centroids_t, task->centroid_norms, dots, best, score);
+            for (int r = 0; r < rows; r++) {
+                changed |= kmeans_absorb(task, simd, i + r, matrix_row(task->data, i + r), best[r], sums, counts);
+            }
+        }
+    }
+    if (scratch) arena_release(scratch, mark);
+
+    for (; i < end; i++) {
+        const double *x = matrix_row(task->data, i);
+
+        // Assign point to nearest centroid
+        int best_cluster;
+        switch (task->algorithm) {
+        case KMEANS_HAMERLY: best_cluster = kmeans_assign_hamerly(task, simd, i, x); break;
+        case KMEANS_ELKAN:   best_cluster = kmeans_assign_elkan(task, simd, i, x); break;
+        default:             best_cluster = kmeans_assign_lloyd(task, simd, i, x); break;
+        }
+        changed |= kmeans_absorb(task, simd, i, x, best_cluster, sums, counts);
+    }
+    task->changed[thread_id] = changed;
+}
+
+// Inter-centroid distances and, for each centroid, half the distance to its
+// nearest neighbour. A point closer to its centroid than that cannot be
+// closer to any other centroid.
+static void kmeans_centroid_distances(const Matrix *centroids, double *centroid_dist, double *half_min_dist) {
+    const simd_kernels_t *simd = simd_kernels();
+    int k = centroids->rows, n_features = centroids->cols;
+    for (int j = 0; j < k; j++) {
+        centroid_dist[j * k + j] = 0.0;
+        half_min_dist[j] = INFINITY;
+    }
+    for (int j = 0; j < k; j++) {
+        for (int j2 = j + 1; j2 < k; j2++) {
+            double dist = sqrt(simd->sq_dist(centroids->data + j * n_features,
+                                             centroids->data + j2 * n_features, n_features));
+            centroid_dist[j * k + j2] = centroid_dist[j2 * k + j] = dist;
+            if (0.5 * dist < half_min_dist[j]) half_min_dist[j] = 0.5 * dist;
+            if (0.5 * dist < half_min_dist[j2]) half_min_dist[j2] = 0.5 * dist;
+        }
+    }
+}
+
+// k-means|| oversampling: rounds of sampling and candidates drawn per
+// round as a multiple of k (Bahmani et al. 2012 use 5 rounds and l = 2k)
+#define KMEANS_PARALLEL_ROUNDS 5
+#define KMEANS_PARALLEL_OVERSAMPLING 2
+
+// The draw for a given (seed, stream, index) does not depend on how
+// samples are split across threads, so seeding is reproducible
+static double kmeans_uniform(unsigned int seed, uint64_t stream, uint64_t index) {
+    uint64_t h = ml_hash64(ml_hash64(ml_hash64(seed) ^ stream) ^ index);
+    return (h >> 11) * (1.0 / 9007199254740992.0);  // [0, 1)
+}
+
+// Parallel pass folding newly chosen centers [center_begin, center_end) into
+// each point's squared distance to its closest center
+typedef struct {
+    const Matrix *data;
+    const double *centers;   // candidate rows, n_features each
+    int center_begin;
+    int center_end;
+    double *min_dist;        // n: squared distance to the closest center
+    int *closest;            // n: index of the closest center
+    double *partial_cost;    // per thread sum of min_dist
+} KMeansSeedTask;
+
+static void kmeans_seed_update_block(void *ctx, int thread_id, int n_threads) {
+    KMeansSeedTask *task = ctx;
+    int n_features = task->data->cols;
+    const simd_kernels_t *simd = simd_kernels();
+    double cost = 0.0;
+
+    int begin, end;
+    thread_partition(task->data->rows, thread_id, n_threads, &begin, &end);
+    for (int i = begin; i < end; i++) {
+        const double *x = matrix_row(task->data, i);
+        for (int c = task->center_begin; c < task->center_end; c++) {
+            double dist = simd->sq_dist(x, task->centers + (size_t)c * n_features, n_features);
+            if (dist < task->min_dist[i]) {
+                task->min_dist[i] = dist;
+                task->closest[i] = c;
+            }
+        }
+        cost += task->min_dist[i];
+    }
+    task->partial_cost[thread_id] = cost;
+}
+
+static double kmeans_seed_update(ThreadPool *pool, KMeansSeedTask *task, int center_begin, int center_end) {
+    task->center_begin = center_begin;
+    task->center_end = center_end;
+    thread_pool_run(pool, kmeans_seed_update_block, task);
+    double cost = 0.0;
+    for (int t = 0; t < thread_pool_size(pool); t++) cost += task->partial_cost[t];
+    return cost;
+}
+
+// Index i with probability weight[i] / total, or uniformly if all weights are zero
+static int kmeans_sample_weighted(const double *weight, int n, double total, double u) {
+    if (total <= 0.0) return (int)(u * n);
+    double target = u * total, acc = 0.0;
+    for (int i = 0; i < n; i++) {
+        acc += weight[i];
+        if (acc > target) return i;
+    }
+    return n - 1;
+}
+
+// Serial weighted k-means++ over a small candidate set (the k-means|| recluster step)
+static void kmeans_plusplus_weighted(const double *points, const double *weights, int n, int n_features,
+                                     int k, unsigned int seed, double *out) {
+    const simd_kernels_t *simd = simd_kernels();
+    double *min_dist = malloc(n * sizeof(double));
+    double *score = malloc(n * sizeof(double));
+    if (!min_dist || !score) {
+        free(min_dist);
+        free(score);
+        for (int c = 0; c < k; c++) memcpy(out + c * n_features, points + (c % n) * n_features, n_features * sizeof(double));
+        return;
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < n; i++) total += weights[i];
+    int first = kmeans_sample_weighted(weights, n, total, kmeans_uniform(seed, 1000, 0));
+    memcpy(out, points + first * n_features, n_features * sizeof(double));
+    for (int i = 0; i < n; i++) min_dist[i] = INFINITY;
+
+    for (int c = 1; c < k; c++) {
+        const double *last = out + (c - 1) * n_features;
+        double cost = 0.0;
+        for (int i = 0; i < n; i++) {
+            double dist = simd->sq_dist(points + i * n_features, last, n_features);
+            if (dist < min_dist[i]) min_dist[i] = dist;
+            score[i] = weights[i] * min_dist[i];
+            cost += score[i];
+        }
+        int next = kmeans_sample_weighted(score, n, cost, kmeans_uniform(seed, 1000, c));
+        memcpy(out + c * n_features, points + next * n_features, n_features * sizeof(double));
+    }
+    free(min_dist);
+    free(score);
+}
+
+// Fill km->centroids according to km->init. Returns false on allocation
+// failure, in which case the first k rows are used.
+static bool kmeans_init_centroids(KMeans *km, const Matrix *data, ThreadPool *pool) {
+    int n_samples = data->rows, n_features = data->cols, k = km->k;
+    double *centroids = km->centroids->data;
+    size_t row_bytes = n_features * sizeof(double);
+
+    // Initialize centroids (first k points as the fallback)
+    for (int i = 0; i < k; i++) {
+        memcpy(centroids + i * n_features, matrix_row(data, i % n_samples), row_bytes);
+    }
+    if (km->init == KMEANS_INIT_FIRST_K) return true;
+
+    // k-means|| expects about l = OVERSAMPLING * k candidates per round;
+    // allow twice that before sampling is cut short
+    int max_centers = km->init == KMEANS_INIT_PARALLEL
+        ? 1 + 2 * KMEANS_PARALLEL_ROUNDS * KMEANS_PARALLEL_OVERSAMPLING * k : k;
+    KMeansSeedTask task = {
+        .data = data,
+        .centers = NULL,
+        .min_dist = malloc(n_samples * sizeof(double)),
+        .closest = malloc(n_samples * sizeof(int)),
+        .partial_cost = malloc(thread_pool_size(pool) * sizeof(double)),
+    };
+    double *centers = malloc((size_t)max_centers * row_bytes);
+    double *weights = NULL;
+    bool ok = task.min_dist && task.closest && task.partial_cost && centers;
+    if (!ok) goto done;
+    task.centers = centers;
+    for (int i = 0; i < n_samples; i++) task.min_dist[i] = INFINITY;
+
+    int first = (int)(kmeans_uniform(km->seed, 0, 0) * n_samples);
+    memcpy(centers, matrix_row(data, first), row_bytes);
+    int n_centers = 1;
+    double cost = kmeans_seed_update(pool, &task, 0, 1);
+
+    if (km->init == KMEANS_INIT_PLUSPLUS) {
+        // Each next center is drawn with probability proportional to D(x)^2
+        for (int c = 1; c < k; c++) {
+            int next = kmeans_sample_weighted(task.min_dist, n_samples, cost, kmeans_uniform(km->seed, 1, c));
+            memcpy(centers + c * n_features, matrix_row(data, next), row_bytes);
+            cost = kmeans_seed_update(pool, &task, c, c + 1);
+        }
+        memcpy(centroids, centers, k * row_bytes);
+        goto done;
+    }
+
+    // k-means||: every point joins independently with probability l * D(x)^2 / cost
+    double l = (double)KMEANS_PARALLEL_OVERSAMPLING * k;
+    for (int round = 0; round < KMEANS_PARALLEL_ROUNDS && cost > 0.0; round++) {
+        int round_begin = n_centers;
+        for (int i = 0; i < n_samples && n_centers < max_centers; i++) {
+            if (kmeans_uniform(km->seed, 2 + round, i) < l * task.min_dist[i] / cost) {
+                memcpy(centers + (size_t)n_centers * n_features, matrix_row(data, i), row_bytes);
+                n_centers++;
+            }
+        }
+        if (n_centers == round_begin) break;
+        cost = kmeans_seed_update(pool, &task, round_begin, n_centers);
+    }
+
+    // Weight candidates by the points they attract, then recluster down to k
+    weights = calloc(n_centers, sizeof(double));
+    if (!weights) {
+        ok = false;
+        goto done;
+    }
+    for (int i = 0; i < n_samples; i++) weights[task.closest[i]] += 1.0;
+    if (n_centers <= k) {
+        memcpy(centroids, centers, (size_t)n_centers * row_bytes);
+    } else {
+        kmeans_plusplus_weighted(centers, weights, n_centers, n_features, k, km->seed, centroids);
+    }
+
+done:
+    free(task.min_dist);
+    free(task.closest);
+    free(task.partial_cost);
+    free(centers);
+    free(weights);
+    return ok;
+}
+
 void kmeans_fit(KMeans *km, const Matrix *data, int max_iters) {
     int n_samples = data->rows;
     int n_features = data->cols;
+    int k = km->k;
 
     // Resize assignments array
     km->assignments = (int*)realloc(km->assignments, n_samples * sizeof(int));
+    for (int i = 0; i < n_samples; i++) km->assignments[i] = -1;
 
-    // Initialize centroids randomly (simplified: first k points)
-    for (int i = 0; i < km->k; i++) {
-        for (int j = 0; j < n_features; j++) {
-            km->centroids->data[i * n_features + j] = data->data[i * n_features + j];
-        }
+    kmeans_algorithm_t algorithm = km->algorithm;
+    if (algorithm == KMEANS_AUTO) {
+        algorithm = n_features < KMEANS_ELKAN_MIN_FEATURES ? KMEANS_HAMERLY : KMEANS_ELKAN;
     }
+    bool bounded = algorithm != KMEANS_LLOYD;
+    bool gemm = !bounded && kmeans_use_gemm(k, n_features);
+
+    // Never start more threads than there are samples to share out
+    int n_threads = km->n_threads > n_samples ? n_samples : km->n_threads;
+    ThreadPool *owned_pool;
+    ThreadPool *pool = thread_pool_select(km->pool, n_threads, &owned_pool);
+    n_threads = thread_pool_size(pool);
+
+    ML_PROFILE_BEGIN(ML_PHASE_KMEANS_INIT);
+    if (!kmeans_init_centroids(km, data, pool)) {
+        ML_DEBUG_PRINT("k-means seeding fell back to the first %d rows", k);
+    }
+    ML_PROFILE_END(ML_PHASE_KMEANS_INIT);
+
+    // Every per-fit buffer comes from one arena sized up front: one
+    // allocation, and each buffer starts on its own cache line so threads
+    // writing neighbouring buffers don't share lines
+    size_t n_lower = algorithm == KMEANS_ELKAN ? (size_t)n_samples * k : (size_t)n_samples;
+    size_t workspace_bytes = ((size_t)n_threads * k * n_features + (size_t)n_threads * k) * sizeof(double) +
+                             n_threads * sizeof(int) + 11 * ML_ALIGNMENT;
+    if (bounded) {
+        workspace_bytes += (n_samples + n_lower + (size_t)k * k + 2 * k + (size_t)k * n_features) * sizeof(double);
+    }
+    if (gemm) {
+        workspace_bytes += ((size_t)n_features * k + k) * sizeof(double);
+    }
+    Arena *workspace = arena_create(workspace_bytes);
+    Matrix centroids_t = { .data = gemm ? arena_alloc(workspace, (size_t)n_features * k * sizeof(double)) : NULL,
+                           .rows = n_features, .cols = k, .stride = k, .is_view = true };
+    double *centroid_norms = gemm ? arena_alloc(workspace, k * sizeof(double)) : NULL;
+    KMeansAssignTask task = {
+        .data = data,
+        .centroids = km->centroids,
+        .assignments = km->assignments,
+        .partial_sums = arena_alloc(workspace, (size_t)n_threads * k * n_features * sizeof(double)),
+        .partial_counts = arena_alloc(workspace, (size_t)n_threads * k * sizeof(double)),
+        .changed = arena_alloc(workspace, n_threads * sizeof(int)),
+        .k = k,
+        .algorithm = algorithm,
+        .first_pass = true,
+        .upper = bounded ? arena_alloc(workspace, n_samples * sizeof(double)) : NULL,
+        .lower = bounded ? arena_alloc(workspace, n_lower * sizeof(double)) : NULL,
+        .centroid_dist = bounded ? arena_alloc(workspace, (size_t)k * k * sizeof(double)) : NULL,
+        .half_min_dist = bounded ? arena_alloc(workspace, k * sizeof(double)) : NULL,
+        .shift = bounded ? arena_alloc(workspace, k * sizeof(double)) : NULL,
+        .centroids_t = centroids_t.data && centroid_norms ? &centroids_t : NULL,
+        .centroid_norms = centroid_norms,
+    };
+    double *prev_centroids = bounded ? arena_alloc(workspace, (size_t)k * n_features * sizeof(double)) : NULL;
+    if (!task.partial_sums || !task.partial_counts || !task.changed) goto cleanup;
+    if (bounded && (!task.upper || !task.lower || !task.centroid_dist ||
+                    !task.half_min_dist || !task.shift || !prev_centroids)) goto cleanup;
 
     // K-means loop
+    const simd_kernels_t *simd = simd_kernels();
+    km->n_iter = 0;
     for (int iter = 0; iter < max_iters; iter++) {
+        km->n_iter = iter + 1;
+        ML_PROFILE_BEGIN(ML_PHASE_KMEANS_ASSIGN);
+        if (bounded && !task.first_pass) {
+            kmeans_centroid_distances(km->centroids, task.centroid_dist, task.half_min_dist);
+        }
+        if (task.centroids_t) kmeans_gemm_operands(km->centroids, &centroids_t, centroid_norms);
+        thread_pool_run(pool, kmeans_assign_block, &task);
+        task.first_pass = false;
+        ML_PROFILE_END(ML_PHASE_KMEANS_ASSIGN);
+
+        ML_PROFILE_BEGIN(ML_PHASE_KMEANS_UPDATE);
+        if (bounded) memcpy(prev_centroids, km->centroids->data, (size_t)k * n_features * sizeof(double));
+
+        // Reduce partial sums in thread order so results only depend on n_threads
         int changed = 0;
+        for (int t = 0; t < n_threads; t++) changed |= task.changed[t];
+        for (int c = 0; c < k; c++) {
+            double count = 0.0;
+            for (int t = 0; t < n_threads; t++) count += task.partial_counts[t * k + c];
+            km->centroid_counts[c] = count;  // lets kmeans_partial_fit continue from here
+            if (count == 0) continue;  // keep the previous centroid for empty clusters
 
-        // Assign points to nearest centroid
-        for (int i = 0; i < n_samples; i++) {
-            double min_dist = INFINITY;
-            int best_cluster = 0;
-            for (int j = 0; j < km->k; j++) {
-                double dist = 0.0;
-                for (int f = 0; f < n_features; f++) {
-                    double diff = data->data[i * n_features + f] - km->centroids->data[j * n_features + f];
-                    dist += diff * diff;
-                }
-                if (dist < min_dist) {
-                    min_dist = dist;
-                    best_cluster = j;
+            double *centroid = km->centroids->data + c * n_features;
+            memcpy(centroid, task.partial_sums + c * n_features, n_features * sizeof(double));
+            for (int t = 1; t < n_threads; t++) {
+                const double *partial = task.partial_sums + ((size_t)t * k + c) * n_features;
+                for (int f = 0; f < n_features; f++) centroid[f] += partial[f];
+            }
+            for (int f = 0; f < n_features; f++) centroid[f] /= count;
+        }
+        ML_PROFILE_END(ML_PHASE_KMEANS_UPDATE);
+
+        ML_PROFILE_BEGIN(ML_PHASE_KMEANS_CONVERGE);
+        if (changed && bounded) {
+            // Record how far each centroid moved so the next pass can loosen bounds
+            task.max_shift = task.second_shift = 0.0;
+            task.max_shift_idx = 0;
+            for (int c = 0; c < k; c++) {
+                double shift = sqrt(simd->sq_dist(prev_centroids + c * n_features,
+                                                  km->centroids->data + c * n_features, n_features));
+                task.shift[c] = shift;
+                if (shift > task.max_shift) {
+                    task.second_shift = task.max_shift;
+                    task.max_shift = shift;
+                    task.max_shift_idx = c;
+                } else if (shift > task.second_shift) {
+                    task.second_shift = shift;
                 }
             }
-            if (km->assignments[i] != best_cluster) {
-                km->assignments[i] = best_cluster;
-                changed = 1;
+        }
+        ML_PROFILE_END(ML_PHASE_KMEANS_CONVERGE);
+
+        // Early stopping if no changes
+        if (!changed) break;
+    }
+
+    ML_PROFILE_BEGIN(ML_PHASE_KMEANS_CONVERGE);
+    km->inertia = 0.0;
+    for (int i = 0; i < n_samples && km->n_iter > 0; i++) {
+        km->inertia += simd->sq_dist(matrix_row(data, i),
+                                     km->centroids->data + km->assignments[i] * n_features, n_features);
+    }
+    ML_PROFILE_END(ML_PHASE_KMEANS_CONVERGE);
+
+cleanup:
+    arena_free(workspace);
+    thread_pool_free(owned_pool);
+}
+
+// Mini-batch k-means (Sculley 2010). The batch is assigned against the
+// centroids as they were on entry, then each point pulls its centroid
+// towards it with learning rate 1 / (samples absorbed by that centroid),
+// so every centroid stays the running mean of the points it has seen.
+void kmeans_partial_fit(KMeans *km, const Matrix *batch) {
+    if (!km || !matrix_is_valid(batch) || batch->cols != km->centroids->cols) return;
+    if (batch->rows == 0) return;
+    int n_features = batch->cols;
+    int k = km->k;
+
+    int *assignments = (int*)realloc(km->assignments, batch->rows * sizeof(int));
+    if (!assignments) return;
+    km->assignments = assignments;
+
+    // Seed the empty centroids (never seeded, or left empty by kmeans_fit)
+    // from the leading rows of the stream. Trained centroids keep their
+    // place. A batch used up by seeding leaves nothing to update.
+    int start = 0;
+    for (int c = 0; c < k && start < batch->rows; c++) {
+        if (km->centroid_counts[c] > 0) continue;
+        memcpy(km->centroids->data + c * n_features, matrix_row(batch, start), n_features * sizeof(double));
+        km->centroid_counts[c] = 1.0;
+        assignments[start++] = c;
+    }
+
+    const simd_kernels_t *simd = simd_kernels();
+    for (int i = start; i < batch->rows; i++) {
+        const double *x = matrix_row(batch, i);
+        double min_dist = INFINITY;
+        int best_cluster = 0;
+        for (int j = 0; j < k; j++) {
+            double dist = simd->sq_dist(x, km->centroids->data + j * n_features, n_features);
+            if (dist < min_dist) {
+                min_dist = dist;
+                best_cluster = j;
             }
         }
+        assignments[i] = best_cluster;
+    }
 
-        // Update centroids
-        Matrix *counts = matrix_create(km->k, 1);  // Count of points per cluster
-        matrix_free(km->centroids);
-        km->centroids = matrix_create(km->k, n_features);
-        for (int i = 0; i < n_samples; i++) {
-            int c = km->assignments[i];
-            counts->data[c] += 1.0;
-            for (int f = 0; f < n_features; f++) {
-                km->centroids->data[c * n_features + f] += data->data[i * n_features + f];
+    for (int i = start; i < batch->rows; i++) {
+        int c = assignments[i];
+        double *centroid = km->centroids->data + c * n_features;
+        const double *x = matrix_row(batch, i);
+        double eta = 1.0 / (km->centroid_counts[c] += 1.0);
+        for (int f = 0; f < n_features; f++) {
+            centroid[f] += eta * (x[f] - centroid[f]);
+        }
+    }
+}
+
+// Brute-force prediction scores a block of rows against one tile of
+// centroids at a time, so the tile stays in L1 while the block streams
+// over it instead of every row reloading all k centroids.
+#define KMEANS_PREDICT_ROWS 64
+#define KMEANS_PREDICT_TILE_BYTES (16 * 1024)
+
+int kmeans_predict_one(const KMeans *km, const double *x, double *sq_dist) {
+    if (!km || !x) return -1;
+    const simd_kernels_t *simd = simd_kernels();
+    int n_features = km->centroids->cols;
+    double min_dist = INFINITY;
+    int best_cluster = 0;
+    ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, km->k);
+    for (int j = 0; j < km->k; j++) {
+        double dist = simd->sq_dist(x, km->centroids->data + j * n_features, n_features);
+        if (dist < min_dist) {
+            min_dist = dist;
+            best_cluster = j;
+        }
+    }
+    if (sq_dist) *sq_dist = min_dist;
+    return best_cluster;
+}
+
+// Outside Lloyd mode, skip any centroid j with d(c_best, c_j) >= 2 d(x, c_best):
+// by the triangle inequality it cannot be closer than the current best.
+// Once x is within half_min_dist of its best centroid the scan can stop.
+static void kmeans_predict_pruned(const KMeans *km, const Matrix *data, const double *centroid_dist,
+                                  const double *half_min_dist, int *labels, double *distances) {
+    const simd_kernels_t *simd = simd_kernels();
+    int k = km->k, n_features = data->cols;
+    for (int i = 0; i < data->rows; i++) {
+        const double *x = matrix_row(data, i);
+        double min_sq = simd->sq_dist(x, km->centroids->data, n_features);
+        ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, 1);
+        double min_dist = sqrt(min_sq);
+        int best_cluster = 0;
+        for (int j = 1; j < k; j++) {
+            if (min_dist <= half_min_dist[best_cluster]) break;
+            if (centroid_dist[best_cluster * k + j] >= 2.0 * min_dist) continue;
+            double sq = simd->sq_dist(x, km->centroids->data + j * n_features, n_features);
+            ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, 1);
+            if (sq < min_sq) {
+                min_sq = sq;
+                min_dist = sqrt(sq);
+                best_cluster = j;
             }
         }
-        for (int i = 0; i < km->k; i++) {
-            if (counts->data[i] > 0) {
-                for (int f = 0; f < n_features; f++) {
-                    km->centroids->data[i * n_features + f] /= counts->data[i];
+        labels[i] = best_cluster;
+        if (distances) distances[i] = min_sq;
+    }
+}
+
+static void kmeans_predict_tiled(const KMeans *km, const Matrix *data, int *labels, double *distances) {
+    const simd_kernels_t *simd = simd_kernels();
+    int k = km->k, n_features = data->cols;
+    int tile = KMEANS_PREDICT_TILE_BYTES / (int)(n_features * sizeof(double));
+    if (tile < 1) tile = 1;
+    double min_dist[KMEANS_PREDICT_ROWS];
+    int best_cluster[KMEANS_PREDICT_ROWS];
+
+    for (int i0 = 0; i0 < data->rows; i0 += KMEANS_PREDICT_ROWS) {
+        int rows = data->rows - i0 < KMEANS_PREDICT_ROWS ? data->rows - i0 : KMEANS_PREDICT_ROWS;
+        for (int r = 0; r < rows; r++) {
+            min_dist[r] = INFINITY;
+            best_cluster[r] = 0;
+        }
+        for (int j0 = 0; j0 < k; j0 += tile) {
+            int j1 = j0 + tile < k ? j0 + tile : k;
+            for (int r = 0; r < rows; r++) {
+                const double *x = matrix_row(data, i0 + r);
+                for (int j = j0; j < j1; j++) {
+                    double dist = simd->sq_dist(x, km->centroids->data + j * n_features, n_features);
+                    if (dist < min_dist[r]) {
+                        min_dist[r] = dist;
+                        best_cluster[r] = j;
+                    }
                 }
             }
         }
-        matrix_free(counts);
+        ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, (uint64_t)rows * k);
+        for (int r = 0; r < rows; r++) {
+            labels[i0 + r] = best_cluster[r];
+            if (distances) distances[i0 + r] = min_dist[r];
+        }
+    }
+}
 
-        // Early stopping if no changes
-        if (!changed) break;
+// GEMM scoring for large k and d; false if scratch memory ran out
+static bool kmeans_predict_gemm(const KMeans *km, const Matrix *data, int *labels, double *distances) {
+    const simd_kernels_t *simd = simd_kernels();
+    int k = km->k, n_features = data->cols;
+    Arena *scratch = arena_thread_scratch();
+    if (!scratch) return false;
+    ArenaMark mark = arena_mark(scratch);
+    Matrix centroids_t = { .data = arena_alloc(scratch, (size_t)n_features * k * sizeof(double)),
+                           .rows = n_features, .cols = k, .stride = k, .is_view = true };
+    double *centroid_norms = arena_alloc(scratch, k * sizeof(double));
+    double *dots = arena_alloc(scratch, (size_t)KMEANS_GEMM_ROWS * k * sizeof(double));
+    if (!centroids_t.data || !centroid_norms || !dots) {
+        arena_release(scratch, mark);
+        return false;
+    }
+
+    kmeans_gemm_operands(km->centroids, &centroids_t, centroid_norms);
+    double score[KMEANS_GEMM_ROWS];
+    for (int i0 = 0; i0 < data->rows; i0 += KMEANS_GEMM_ROWS) {
+        int rows = data->rows - i0 < KMEANS_GEMM_ROWS ? data->rows - i0 : KMEANS_GEMM_ROWS;
+        Matrix block = kmeans_row_block(data, i0, rows);
+        kmeans_gemm_nearest(&block, &centroids_t, centroid_norms, dots, labels + i0, score);
+        for (int r = 0; distances && r < rows; r++) {
+            // The expansion can round slightly below zero for a point on its centroid
+            distances[i0 + r] = fmax(0.0, simd->sum_sq(matrix_row(data, i0 + r), n_features) + score[r]);
+        }
+    }
+    arena_release(scratch, mark);
+    return true;
+}
+
+ml_error_t kmeans_predict_into(const KMeans *km, const Matrix *data, int *labels, double *distances) {
+    ML_CHECK_NULL(km);
+    ML_CHECK_NULL(data);
+    ML_CHECK_NULL(labels);
+    if (data->cols != km->centroids->cols) return ML_ERROR_DIMENSION_MISMATCH;
+    int k = km->k;
+
+    ML_PROFILE_BEGIN(ML_PHASE_KMEANS_PREDICT);
+    if (km->algorithm == KMEANS_LLOYD || data->rows <= k) {
+        if (!kmeans_use_gemm(k, data->cols) || !kmeans_predict_gemm(km, data, labels, distances)) {
+            kmeans_predict_tiled(km, data, labels, distances);
+        }
+        ML_PROFILE_END(ML_PHASE_KMEANS_PREDICT);
+        return ML_SUCCESS;
+    }
+
+    // The centroid distance tables come from the thread's scratch arena, so
+    // repeated calls do not touch malloc once it has grown
+    Arena *scratch = arena_thread_scratch();
+    ArenaMark mark = scratch ? arena_mark(scratch) : (ArenaMark){0};
+    double *centroid_dist = scratch ? arena_alloc(scratch, (size_t)k * k * sizeof(double)) : NULL;
+    double *half_min_dist = scratch ? arena_alloc(scratch, k * sizeof(double)) : NULL;
+    if (centroid_dist && half_min_dist) {
+        kmeans_centroid_distances(km->centroids, centroid_dist, half_min_dist);
+        kmeans_predict_pruned(km, data, centroid_dist, half_min_dist, labels, distances);
+    } else {
+        kmeans_predict_tiled(km, data, labels, distances);
     }
+    if (scratch) arena_release(scratch, mark);
+    ML_PROFILE_END(ML_PHASE_KMEANS_PREDICT);
+    return ML_SUCCESS;
 }
 
 Matrix* kmeans_predict(const KMeans *km, const Matrix *data) {
+    if (!km || !data) return NULL;
     Matrix *labels = matrix_create(data->rows, 1);
+    int *assignments = malloc((data->rows > 0 ? data->rows : 1) * sizeof(int));
+    if (!labels || !assignments || kmeans_predict_into(km, data, assignments, NULL) != ML_SUCCESS) {
+        matrix_free(labels);
+        free(assignments);
+        return NULL;
+    }
     for (int i = 0; i < data->rows; i++) {
-        double min_dist = INFINITY;
+        labels->data[i] = (double)assignments[i];
+    }
+    free(assignments);
+    return labels;
+}
+
+KMeansCompact* kmeans_compact(const KMeans *km, ml_precision_t precision) {
+    if (!km || (precision != ML_PRECISION_F32 && precision != ML_PRECISION_Q8)) return NULL;
+    KMeansCompact *model = calloc(1, sizeof(KMeansCompact));
+    if (!model) return NULL;
+    model->precision = precision;
+    model->k = km->k;
+    model->n_features = km->centroids->cols;
+    if (precision == ML_PRECISION_F32) {
+        model->centroids = matrix_f32_from_matrix(km->centroids);
+        if (!model->centroids) {
+            kmeans_compact_free(model);
+            return NULL;
+        }
+        return model;
+    }
+
+    model->centroids_q8 = matrix_q8_quantize(km->centroids);
+    model->offsets = malloc(km->k * sizeof(float));
+    if (!model->centroids_q8 || !model->offsets) {
+        kmeans_compact_free(model);
+        return NULL;
+    }
+    // With c_j = s_j q_j, |x - c_j|^2 = |x|^2 - 2 s_j (q_j . x) + s_j^2 |q_j|^2.
+    // |x|^2 is the same for every j, so the argmin only needs the last two
+    // terms: one int8 dot product per centroid plus this offset.
+    const MatrixQ8 *q8 = model->centroids_q8;
+    for (int j = 0; j < km->k; j++) {
+        const int8_t *q = q8->data + (size_t)j * q8->cols;
+        float norm_sq = 0.0f;
+        for (int f = 0; f < q8->cols; f++) norm_sq += (float)q[f] * q[f];
+        model->offsets[j] = q8->scales[j] * q8->scales[j] * norm_sq;
+    }
+    return model;
+}
+
+void kmeans_compact_free(KMeansCompact *model) {
+    if (model) {
+        matrix_f32_free(model->centroids);
+        matrix_q8_free(model->centroids_q8);
+        free(model->offsets);
+        free(model);
+    }
+}
+
+ml_error_t kmeans_compact_predict_into(const KMeansCompact *model, const MatrixF32 *data, int *labels) {
+    ML_CHECK_NULL(model);
+    ML_CHECK_NULL(data);
+    ML_CHECK_NULL(labels);
+    if (data->cols != model->n_features) return ML_ERROR_DIMENSION_MISMATCH;
+
+    const simd_kernels_t *simd = simd_kernels();
+    int k = model->k, n_features = model->n_features;
+    for (int i = 0; i < data->rows; i++) {
+        const float *x = matrix_f32_row(data, i);
+        float best = INFINITY;
         int best_cluster = 0;
-        for (int j = 0; j < km->k; j++) {
-            double dist = 0.0;
-            for (int f = 0; f < data->cols; f++) {
-                double diff = data->data[i * data->cols + f] - km->centroids->data[j * data->cols + f];
-                dist += diff * diff;
+        for (int j = 0; j < k; j++) {
+            float score;
+            if (model->precision == ML_PRECISION_F32) {
+                score = simd->sq_dist_f32(x, matrix_f32_row(model->centroids, j), n_features);
+            } else {
+                const MatrixQ8 *q8 = model->centroids_q8;
+                score = model->offsets[j] -
+                        2.0f * q8->scales[j] * simd->dot_s8_f32(q8->data + (size_t)j * n_features, x, n_features);
             }
-            if (dist < min_dist) {
-                min_dist = dist;
+            if (score < best) {
+                best = score;
                 best_cluster = j;
             }
         }
-        labels->data[i] = (double)best_cluster;
+        labels[i] = best_cluster;
     }
-    return labels;
-}
\ No newline at end of file
+    return ML_SUCCESS;
+}
+
+// Sparse (CSR) data. |x - c|^2 = |x|^2 - 2 x.c + |c|^2 with |c|^2 computed
+// once per centroid update; x.c for a block of rows is one sparse x dense
+// product with C^T, which reads only the rows of C^T for columns present
+// in the block. A row costs O(nnz * k) instead of O(n_features * k).
+
+// Rows [begin, begin + rows) of data. The row offsets stay absolute, which
+// is all the sparse kernels look at.
+static SparseMatrix kmeans_sparse_block(const SparseMatrix *data, int begin, int rows, int cols) {
+    return (SparseMatrix){ data->values, data->col_idx, data->row_ptr + begin, rows, cols,
+                           data->row_ptr[begin + rows] - data->row_ptr[begin] };
+}
+
+static double kmeans_sparse_row_sq(const SparseMatrix *data, int i) {
+    double sum = 0.0;
+    for (size_t p = data->row_ptr[i]; p < data->row_ptr[i + 1]; p++) sum += data->values[p] * data->values[p];
+    return sum;
+}
+
+// Nearest centroid for rows [begin, begin + rows), at most KMEANS_GEMM_ROWS.
+// dots is rows x k scratch; distances may be NULL.
+static void kmeans_sparse_nearest(const SparseMatrix *data, int begin, int rows, const Matrix *centroids_t,
+                                  const double *centroid_norms, double *dots, int *labels, double *distances) {
+    int k = centroids_t->cols;
+    SparseMatrix block = kmeans_sparse_block(data, begin, rows, centroids_t->rows);
+    Matrix product = { .data = dots, .rows = rows, .cols = k, .stride = k, .is_view = true };
+    sparse_multiply_dense(&block, centroids_t, &product);
+    ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, (uint64_t)rows * k);
+
+    for (int r = 0; r < rows; r++) {
+        const double *dot = dots + (size_t)r * k;
+        double best = INFINITY;
+        int best_cluster = 0;
+        for (int j = 0; j < k; j++) {
+            double score = centroid_norms[j] - 2.0 * dot[j];
+            if (score < best) {
+                best = score;
+                best_cluster = j;
+            }
+        }
+        labels[begin + r] = best_cluster;
+        if (distances) distances[begin + r] = fmax(0.0, kmeans_sparse_row_sq(data, begin + r) + best);
+    }
+}
+
+typedef struct {
+    const SparseMatrix *data;
+    const Matrix *centroids_t;
+    const double *centroid_norms;
+    double *dots;        // n_threads x KMEANS_GEMM_ROWS x k
+    int *labels;
+
+    // Seeding: fold the centroid in center into min_dist
+    const double *center;
+    double center_norm;
+    double *min_dist;
+    double *partial_cost;  // per thread
+} KMeansSparseTask;
+
+static void kmeans_sparse_assign_block(void *ctx, int thread_id, int n_threads) {
+    KMeansSparseTask *task = ctx;
+    double *dots = task->dots + (size_t)thread_id * KMEANS_GEMM_ROWS * task->centroids_t->cols;
+    int begin, end;
+    thread_partition(task->data->rows, thread_id, n_threads, &begin, &end);
+    for (int i0 = begin; i0 < end; i0 += KMEANS_GEMM_ROWS) {
+        int rows = end - i0 < KMEANS_GEMM_ROWS ? end - i0 : KMEANS_GEMM_ROWS;
+        kmeans_sparse_nearest(task->data, i0, rows, task->centroids_t, task->centroid_norms,
+                              dots, task->labels, NULL);
+    }
+}
+
+static void kmeans_sparse_seed_block(void *ctx, int thread_id, int n_threads) {
+    KMeansSparseTask *task = ctx;
+    double cost = 0.0;
+    int begin, end;
+    thread_partition(task->data->rows, thread_id, n_threads, &begin, &end);
+    for (int i = begin; i < end; i++) {
+        double dist = kmeans_sparse_row_sq(task->data, i) - 2.0 * sparse_row_dot(task->data, i, task->center) +
+                      task->center_norm;
+        if (dist < task->min_dist[i]) task->min_dist[i] = fmax(0.0, dist);
+        cost += task->min_dist[i];
+    }
+    ML_PROFILE_COUNT(ML_COUNTER_DISTANCES, end - begin);
+    task->partial_cost[thread_id] = cost;
+}
+
+static void kmeans_sparse_copy_row(const SparseMatrix *data, int i, double *out, int n_features) {
+    memset(out, 0, n_features * sizeof(double));
+    for (size_t p = data->row_ptr[i]; p < data->row_ptr[i + 1]; p++) out[data->col_idx[p]] = data->values[p];
+}
+
+// k-means++ with the same draws as the dense seeding; KMEANS_INIT_PARALLEL
+// also uses k-means++ here
+static bool kmeans_sparse_init(KMeans *km, const SparseMatrix *data, ThreadPool *pool, KMeansSparseTask *task) {
+    int n_samples = data->rows, n_features = km->centroids->cols, k = km->k;
+    for (int c = 0; c < k; c++) {
+        kmeans_sparse_copy_row(data, c % n_samples, matrix_row(km->centroids, c), n_features);
+    }
+    if (km->init == KMEANS_INIT_FIRST_K) return true;
+
+    task->min_dist = malloc(n_samples * sizeof(double));
+    task->partial_cost = malloc(thread_pool_size(pool) * sizeof(double));
+    bool ok = task->min_dist && task->partial_cost;
+    if (ok) {
+        const simd_kernels_t *simd = simd_kernels();
+        for (int i = 0; i < n_samples; i++) task->min_dist[i] = INFINITY;
+        int next = (int)(kmeans_uniform(km->seed, 0, 0) * n_samples);
+        for (int c = 0; c < k; c++) {
+            double *center = matrix_row(km->centroids, c);
+            kmeans_sparse_copy_row(data, next, center, n_features);
+            if (c == k - 1) break;
+            task->center = center;
+            task->center_norm = simd->sum_sq(center, n_features);
+            thread_pool_run(pool, kmeans_sparse_seed_block, task);
+            double cost = 0.0;
+            for (int t = 0; t < thread_pool_size(pool); t++) cost += task->partial_cost[t];
+            next = kmeans_sample_weighted(task->min_dist, n_samples, cost, kmeans_uniform(km->seed, 1, c + 1));
+        }
+    }
+    free(task->min_dist);
+    free(task->partial_cost);
+    task->min_dist = task->partial_cost = NULL;
+    return ok;
+}
+
+void kmeans_fit_sparse(KMeans *km, const SparseMatrix *data, int max_iters) {
+    if (!km || !data || data->rows <= 0 || data->cols > km->centroids->cols) return;
+    int n_samples = data->rows, n_features = km->centroids->cols, k = km->k;
+    int *assignments = realloc(km->assignments, n_samples * sizeof(int));
+    if (!assignments) return;
+    km->assignments = assignments;
+    for (int i = 0; i < n_samples; i++) assignments[i] = -1;
+
+    int n_threads = km->n_threads > n_samples ? n_samples : km->n_threads;
+    ThreadPool *owned_pool;
+    ThreadPool *pool = thread_pool_select(km->pool, n_threads, &owned_pool);
+    n_threads = thread_pool_size(pool);
+
+    size_t centroid_bytes = (size_t)k * n_features * sizeof(double);
+    Arena *workspace = arena_create(2 * centroid_bytes + (size_t)n_threads * KMEANS_GEMM_ROWS * k * sizeof(double) +
+                                    k * sizeof(double) + n_samples * sizeof(int) + 5 * ML_ALIGNMENT);
+    Matrix centroids_t = { .data = arena_alloc(workspace, centroid_bytes), .rows = n_features, .cols = k,
+                           .stride = k, .is_view = true };
+    double *centroid_norms = arena_alloc(workspace, k * sizeof(double));
+    double *sums = arena_alloc(workspace, centroid_bytes);
+    KMeansSparseTask task = {
+        .data = data,
+        .centroids_t = &centroids_t,
+        .centroid_norms = centroid_norms,
+        .dots = arena_alloc(workspace, (size_t)n_threads * KMEANS_GEMM_ROWS * k * sizeof(double)),
+        .labels = arena_alloc(workspace, n_samples * sizeof(int)),
+    };
+    if (!centroids_t.data || !centroid_norms || !sums || !task.dots || !task.labels) goto cleanup;
+
+    ML_PROFILE_BEGIN(ML_PHASE_KMEANS_INIT);
+    if (!kmeans_sparse_init(km, data, pool, &task)) {
+        ML_DEBUG_PRINT("k-means seeding fell back to the first %d rows", k);
+    }
+    ML_PROFILE_END(ML_PHASE_KMEANS_INIT);
+
+    km->n_iter = 0;
+    for (int iter = 0; iter < max_iters; iter++) {
+        km->n_iter = iter + 1;
+        ML_PROFILE_BEGIN(ML_PHASE_KMEANS_ASSIGN);
+        kmeans_gemm_operands(km->centroids, &centroids_t, centroid_norms);
+        thread_pool_run(pool, kmeans_sparse_assign_block, &task);
+        ML_PROFILE_END(ML_PHASE_KMEANS_ASSIGN);
+
+        // The update is O(nnz), cheap next to the O(nnz * k) assignment, so
+        // it runs serially into one set of sums
+        ML_PROFILE_BEGIN(ML_PHASE_KMEANS_UPDATE);
+        bool changed = false;
+        memset(sums, 0, centroid_bytes);
+        memset(km->centroid_counts, 0, k * sizeof(double));
+        for (int i = 0; i < n_samples; i++) {
+            int c = task.labels[i];
+            changed |= c != assignments[i];
+            assignments[i] = c;
+            km->centroid_counts[c] += 1.0;
+            double *sum = sums + (size_t)c * n_features;
+            for (size_t p = data->row_ptr[i]; p < data->row_ptr[i + 1]; p++) sum[data->col_idx[p]] += data->values[p];
+        }
+        for (int c = 0; c < k; c++) {
+            double count = km->centroid_counts[c];
+            if (count == 0) continue;  // keep the previous centroid for empty clusters
+            double *centroid = matrix_row(km->centroids, c);
+            const double *sum = sums + (size_t)c * n_features;
+            for (int f = 0; f < n_features; f++) centroid[f] = sum[f] / count;
+        }
+        ML_PROFILE_END(ML_PHASE_KMEANS_UPDATE);
+        if (!changed) break;
+    }
+
+    ML_PROFILE_BEGIN(ML_PHASE_KMEANS_CONVERGE);
+    const simd_kernels_t *simd = simd_kernels();
+    km->inertia = 0.0;
+    for (int i = 0; i < n_samples && km->n_iter > 0; i++) {
+        const double *c = matrix_row(km->centroids, assignments[i]);
+        km->inertia += fmax(0.0, kmeans_sparse_row_sq(data, i) - 2.0 * sparse_row_dot(data, i, c) +
+                                 simd->sum_sq(c, n_features));
+    }
+    ML_PROFILE_END(ML_PHASE_KMEANS_CONVERGE);
+
+cleanup:
+    arena_free(workspace);
+    thread_pool_free(owned_pool);
+}
+
+ml_error_t kmeans_predict_sparse_into(const KMeans *km, const SparseMatrix *data, int *labels, double *distances) {
+    ML_CHECK_NULL(km);
+    ML_CHECK_NULL(data);
+    ML_CHECK_NULL(labels);
+    if (data->cols > km->centroids->cols) return ML_ERROR_DIMENSION_MISMATCH;
+    int k = km->k, n_features = km->centroids->cols;
+
+    Arena *scratch = arena_thread_scratch();
+    if (!scratch) return ML_ERROR_MEMORY_ALLOCATION;
+    ArenaMark mark = arena_mark(scratch);
+    Matrix centroids_t = { .data = arena_alloc(scratch, (size_t)n_features * k * sizeof(double)),
+                           .rows = n_features, .cols = k, .stride = k, .is_view = true };
+    double *centroid_norms = arena_alloc(scratch, k * sizeof(double));
+    double *dots = arena_alloc(scratch, (size_t)KMEANS_GEMM_ROWS * k * sizeof(double));
+    if (!centroids_t.data || !centroid_norms || !dots) {
+        arena_release(scratch, mark);
+        return ML_ERROR_MEMORY_ALLOCATION;
+    }
+
+    ML_PROFILE_BEGIN(ML_PHASE_KMEANS_PREDICT);
+    kmeans_gemm_operands(km->centroids, &centroids_t, centroid_norms);
+    for (int i0 = 0; i0 < data->rows; i0 += KMEANS_GEMM_ROWS) {
+        int rows = data->rows - i0 < KMEANS_GEMM_ROWS ? data->rows - i0 : KMEANS_GEMM_ROWS;
+        kmeans_sparse_nearest(data, i0, rows, &centroids_t, centroid_norms, dots, labels, distances);
+    }
+    ML_PROFILE_END(ML_PHASE_KMEANS_PREDICT);
+    arena_release(scratch, mark);
+    return ML_SUCCESS;
+}
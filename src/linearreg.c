@@ -1,5 +1,12 @@
-#include "linreg.h"
+#include "linearreg.h"
+#include "simd.h"
+#include "profile.h"
+#include "model_io.h"
+#include "thread_pool.h"
+#include "arena.h"
+#include "ml_random.h"
 #include <stdlib.h>
+#include <stdint.h>
 
 LinearRegression* linreg_create(int n_features) {
     if (n_features <= 0) return NULL;
@@ -11,75 +18,666 @@ LinearRegression* linreg_create(int n_features) {
         return NULL;
     }
     lr->bias = 0.0;
+    lr->solver = LINREG_SOLVER_GD;
+    lr->tol = 1e-10;
+    lr->n_iter = 0;
+    lr->batch_size = 256;
+    lr->momentum = 0.9;
+    lr->beta1 = 0.9;
+    lr->beta2 = 0.999;
+    lr->shuffle = true;
+    lr->seed = 0;
+    lr->velocity = NULL;
+    lr->second_moment = NULL;
+    lr->n_steps = 0;
+    lr->n_threads = 0;
+    lr->pool = NULL;
+    lr->mapping = NULL;
+    lr->mapping_size = 0;
     return lr;
 }
 
 void linreg_free(LinearRegression *lr) {
     if (lr) {
         matrix_free(lr->weights);
+        free(lr->velocity);
+        free(lr->second_moment);
+        model_file_unmap(lr->mapping, lr->mapping_size);
         free(lr);
     }
 }
 
-void linreg_fit(LinearRegression *lr, const Matrix *X, const Matrix *y, double learning_rate, int max_iters) {
-    if (!lr || !X || !y || X->rows != y->rows || y->cols != 1 || X->cols != lr->weights->rows) return;
+// Model file layout: the weights, plus the solver settings. Optimizer
+// state is not saved; linreg_partial_fit after a load starts it afresh.
+enum { LINREG_FILE_SOLVER, LINREG_FILE_N_ITER, LINREG_FILE_BATCH_SIZE, LINREG_FILE_SHUFFLE, LINREG_FILE_SEED };
+enum { LINREG_FILE_BIAS, LINREG_FILE_TOL, LINREG_FILE_MOMENTUM, LINREG_FILE_BETA1, LINREG_FILE_BETA2 };
 
-    Matrix *pred = matrix_create(X->rows, 1);
-    Matrix *error = matrix_create(X->rows, 1);
-    Matrix *X_t = matrix_create(X->cols, X->rows);  // Transpose of X
-    Matrix *grad = matrix_create(X->cols, 1);
+ml_error_t linreg_save(const LinearRegression *lr, const char *filename) {
+    ML_CHECK_NULL(lr);
+    ML_CHECK_NULL(filename);
+    ModelParams params = {0};
+    params.ints[LINREG_FILE_SOLVER] = lr->solver;
+    params.ints[LINREG_FILE_N_ITER] = lr->n_iter;
+    params.ints[LINREG_FILE_BATCH_SIZE] = lr->batch_size;
+    params.ints[LINREG_FILE_SHUFFLE] = lr->shuffle;
+    params.ints[LINREG_FILE_SEED] = lr->seed;
+    params.reals[LINREG_FILE_BIAS] = lr->bias;
+    params.reals[LINREG_FILE_TOL] = lr->tol;
+    params.reals[LINREG_FILE_MOMENTUM] = lr->momentum;
+    params.reals[LINREG_FILE_BETA1] = lr->beta1;
+    params.reals[LINREG_FILE_BETA2] = lr->beta2;
+    const Matrix *sections[] = { lr->weights };
+    return model_file_save(filename, MODEL_FILE_LINREG, &params, sections, 1);
+}
 
-    for (int iter = 0; iter < max_iters; iter++) {
-        // Predict: y_pred = X * weights + bias
-        matrix_multiply(X, lr->weights, pred);
-        for (int i = 0; i < pred->rows; i++) {
-            pred->data[i] += lr->bias;
+LinearRegression* linreg_load(const char *filename, bool verify_checksum) {
+    ModelFile file;
+    if (model_file_open(filename, MODEL_FILE_LINREG, verify_checksum, &file) != ML_SUCCESS) return NULL;
+    Matrix *weights = file.sections[0];
+    LinearRegression *lr = file.n_sections == 1 && weights && weights->cols == 1 ? linreg_create(weights->rows) : NULL;
+    if (!lr) {
+        model_file_close(&file);
+        return NULL;
+    }
+    const int64_t *ints = file.params.ints;
+    const double *reals = file.params.reals;
+    lr->solver = (linreg_solver_t)ints[LINREG_FILE_SOLVER];
+    lr->n_iter = (int)ints[LINREG_FILE_N_ITER];
+    lr->batch_size = (int)ints[LINREG_FILE_BATCH_SIZE];
+    lr->shuffle = ints[LINREG_FILE_SHUFFLE] != 0;
+    lr->seed = (unsigned int)ints[LINREG_FILE_SEED];
+    lr->bias = reals[LINREG_FILE_BIAS];
+    lr->tol = reals[LINREG_FILE_TOL];
+    lr->momentum = reals[LINREG_FILE_MOMENTUM];
+    lr->beta1 = reals[LINREG_FILE_BETA1];
+    lr->beta2 = reals[LINREG_FILE_BETA2];
+
+    matrix_free(lr->weights);
+    lr->weights = weights;
+    file.sections[0] = NULL;
+    lr->mapping = file.mapping;
+    lr->mapping_size = file.mapping_size;
+    file.mapping = NULL;
+    model_file_close(&file);
+    return lr;
+}
+
+// Column means of X, used to fit the bias by centering instead of
+// augmenting X with a column of ones
+static void linreg_column_means(const Matrix *X, double *mean) {
+    const simd_kernels_t *simd = simd_kernels();
+    memset(mean, 0, X->cols * sizeof(double));
+    for (int i = 0; i < X->rows; i++) {
+        simd->add(mean, matrix_row(X, i), mean, X->cols);
+    }
+    for (int j = 0; j < X->cols; j++) mean[j] /= X->rows;
+}
+
+// Bias that makes the centered fit pass through (mean(X), mean(y))
+static double linreg_intercept(const LinearRegression *lr, const double *mean, double y_mean) {
+    return y_mean - simd_kernels()->dot(mean, lr->weights->data, lr->weights->rows);
+}
+
+static double linreg_mean(const Matrix *y) {
+    double sum = 0.0;
+    for (int i = 0; i < y->rows; i++) sum += matrix_row(y, i)[0];
+    return sum / y->rows;
+}
+
+// Full passes over X run on the pool: the gradient is a parallel_reduce
+// over fixed blocks of rows summed in row order (as are matrix_gemv_t and
+// matrix_syrk), so a fit gives the same weights on any number of threads
+#define LINREG_REDUCE_ROWS 2048
+
+typedef struct {
+    const LinearRegression *lr;
+    const Matrix *X;
+    const Matrix *y;
+    const double *mean;  // CG column means
+    const double *p;     // CG search direction
+    double *q;           // CG Xc p
+    int value_len;       // doubles summed per partial
+    bool failed;
+} LinregReduceTask;
+
+static void linreg_sum_partials(void *ctx, void *acc, const void *partial) {
+    const LinregReduceTask *task = ctx;
+    simd_kernels()->add(acc, partial, acc, task->value_len);
+}
+
+// In-place Cholesky G = L L^T on the upper triangle (stored as L^T).
+// Returns false if G is not numerically positive definite.
+static bool linreg_cholesky(double *G, int d) {
+    for (int j = 0; j < d; j++) {
+        double diag = G[j * d + j];
+        for (int p = 0; p < j; p++) diag -= G[p * d + j] * G[p * d + j];
+        if (diag <= ML_EPSILON * (1.0 + fabs(G[j * d + j]))) return false;
+        diag = sqrt(diag);
+        G[j * d + j] = diag;
+        for (int l = j + 1; l < d; l++) {
+            double v = G[j * d + l];
+            for (int p = 0; p < j; p++) v -= G[p * d + j] * G[p * d + l];
+            G[j * d + l] = v / diag;
         }
+    }
+    return true;
+}
+
+// Solve L L^T w = b given the factor from linreg_cholesky
+static void linreg_cholesky_solve(const double *U, int d, const double *b, double *w) {
+    for (int j = 0; j < d; j++) {
+        double v = b[j];
+        for (int p = 0; p < j; p++) v -= U[p * d + j] * w[p];
+        w[j] = v / U[j * d + j];
+    }
+    for (int j = d - 1; j >= 0; j--) {
+        double v = w[j];
+        for (int l = j + 1; l < d; l++) v -= U[j * d + l] * w[l];
+        w[j] = v / U[j * d + j];
+    }
+}
+
+// Normal equations G w = b with G = Xc^T Xc and b = Xc^T yc. matrix_syrk
+// and matrix_gemv_t center each row as they read it, so large column
+// offsets don't cancel.
+static bool linreg_fit_cholesky(LinearRegression *lr, ThreadPool *pool, const Matrix *X, const Matrix *y,
+                                const double *mean, double y_mean) {
+    int n = X->rows, d = X->cols;
+    Matrix *G = matrix_create(d, d);
+    double *b = malloc(d * sizeof(double));
+    double *yc = malloc(n * sizeof(double));
+    bool ok = G && b && yc;
+    if (ok) {
+        for (int i = 0; i < n; i++) yc[i] = matrix_row(y, i)[0] - y_mean;
+        ok = matrix_syrk(X, mean, G, pool) == ML_SUCCESS && matrix_gemv_t(X, mean, yc, b, pool) == ML_SUCCESS;
+    }
+    if (ok) {
+        ok = linreg_cholesky(G->data, d);
+        if (ok) linreg_cholesky_solve(G->data, d, b, lr->weights->data);
+    }
+    matrix_free(G);
+    free(b);
+    free(yc);
+    return ok;
+}
 
-        // Compute error: error = pred - y
-        for (int i = 0; i < pred->rows; i++) {
-            error->data[i] = pred->data[i] - y->data[i];
+// Householder QR of the centered design matrix, held column-major so each
+// reflection works on contiguous columns. Columns whose pivot vanishes
+// (rank deficiency) get a zero weight and use up no row of R: the next
+// reflection starts at the same row, so R stays upper trapezoidal.
+static bool linreg_fit_qr(LinearRegression *lr, const Matrix *X, const Matrix *y,
+                          const double *mean, double y_mean) {
+    int n = X->rows, d = X->cols;
+    double *A = malloc((size_t)n * d * sizeof(double));
+    double *r = malloc(n * sizeof(double));
+    double *diag = malloc(d * sizeof(double));
+    int *pivot_row = malloc(d * sizeof(int));  // row of R for column j, -1 if skipped
+    if (!A || !r || !diag || !pivot_row) {
+        free(A);
+        free(r);
+        free(diag);
+        free(pivot_row);
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < d; j++) A[(size_t)j * n + i] = matrix_row(X, i)[j] - mean[j];
+        r[i] = matrix_row(y, i)[0] - y_mean;
+    }
+
+    const simd_kernels_t *simd = simd_kernels();
+    double scale = 0.0;
+    int k = 0;  // next row of R
+    for (int j = 0; j < d; j++) {
+        pivot_row[j] = -1;
+        if (k >= n) continue;
+        double *v = A + (size_t)j * n + k;
+        int len = n - k;
+        double norm = sqrt(simd->sum_sq(v, len));
+        if (norm > scale) scale = norm;
+        if (norm <= ML_EPSILON * (1.0 + scale)) continue;
+        double alpha = v[0] > 0 ? -norm : norm;
+        v[0] -= alpha;
+        double vnorm_sq = simd->sum_sq(v, len);
+        diag[j] = alpha;
+        pivot_row[j] = k;
+
+        // Apply H = I - 2 v v^T / (v^T v) to the remaining columns and to r
+        for (int l = j + 1; l < d; l++) {
+            double *col = A + (size_t)l * n + k;
+            double f = 2.0 * simd->dot(v, col, len) / vnorm_sq;
+            for (int i = 0; i < len; i++) col[i] -= f * v[i];
         }
+        double f = 2.0 * simd->dot(v, r + k, len) / vnorm_sq;
+        for (int i = 0; i < len; i++) r[k + i] -= f * v[i];
+        k++;
+    }
+
+    // Back substitution R w = Q^T y; skipped columns have w = 0 and so
+    // drop out of the rows above them
+    double *w = lr->weights->data;
+    for (int j = d - 1; j >= 0; j--) {
+        int row = pivot_row[j];
+        if (row < 0) {
+            w[j] = 0.0;
+            continue;
+        }
+        double v = r[row];
+        for (int l = j + 1; l < d; l++) v -= A[(size_t)l * n + row] * w[l];
+        w[j] = v / diag[j];
+    }
+
+    free(A);
+    free(r);
+    free(diag);
+    free(pivot_row);
+    return true;
+}
+
+// q = Xc p for rows [begin, end), each row centered before the dot
+// product rather than subtracting mean . p afterwards
+static void linreg_project_rows(void *ctx, int begin, int end, int thread_id) {
+    LinregReduceTask *task = ctx;
+    const simd_kernels_t *simd = simd_kernels();
+    int d = task->X->cols;
+    (void)thread_id;
+    Arena *scratch = arena_thread_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    double *row = arena_alloc(scratch, d * sizeof(double));
+    if (!row) {
+        __atomic_store_n(&task->failed, true, __ATOMIC_RELAXED);
+        arena_release(scratch, mark);
+        return;
+    }
+    for (int i = begin; i < end; i++) {
+        simd->sub(matrix_row(task->X, i), task->mean, row, d);
+        task->q[i] = simd->dot(row, task->p, d);
+    }
+    arena_release(scratch, mark);
+}
+
+// CGLS: conjugate gradient on Xc^T Xc w = Xc^T yc using only products with
+// Xc and Xc^T, one pass over X each; rows are centered as they are read.
+// Returns false if the iteration breaks down (non-finite steps), leaving
+// the caller to fall back to a direct solver.
+static bool linreg_fit_cg(LinearRegression *lr, ThreadPool *pool, const Matrix *X, const Matrix *y,
+                          const double *mean, double y_mean, int max_iters) {
+    int n = X->rows, d = X->cols;
+    double *r = malloc(n * sizeof(double));
+    double *q = malloc(n * sizeof(double));
+    double *s = malloc(d * sizeof(double));
+    double *p = malloc(d * sizeof(double));
+    if (!r || !q || !s || !p) {
+        free(r);
+        free(q);
+        free(s);
+        free(p);
+        return false;
+    }
+
+    const simd_kernels_t *simd = simd_kernels();
+    double *w = lr->weights->data;
+    memset(w, 0, d * sizeof(double));
+    for (int i = 0; i < n; i++) r[i] = matrix_row(y, i)[0] - y_mean;
+
+    LinregReduceTask task = { .X = X, .mean = mean, .p = p, .q = q };
+    bool ok = matrix_gemv_t(X, mean, r, s, pool) == ML_SUCCESS;
+    memcpy(p, s, d * sizeof(double));
+    double gamma = simd->sum_sq(s, d);
+    if (!isfinite(gamma)) ok = false;
+
+    // s is n times the mean-squared-error gradient GD tests against tol
+    lr->n_iter = 0;
+    for (int iter = 0; ok && iter < max_iters && sqrt(gamma) / n > lr->tol; iter++) {
+        lr->n_iter = iter + 1;
+
+        parallel_for(pool, n, LINREG_REDUCE_ROWS, linreg_project_rows, &task);
+        if (task.failed) {
+            ok = false;
+            break;
+        }
+        double q_norm_sq = simd->sum_sq(q, n);
+        if (q_norm_sq == 0.0) break;
+        double alpha = gamma / q_norm_sq;
+        if (!isfinite(alpha)) {
+            ok = false;
+            break;
+        }
+        for (int j = 0; j < d; j++) w[j] += alpha * p[j];
+        for (int i = 0; i < n; i++) r[i] -= alpha * q[i];
+
+        ok = matrix_gemv_t(X, mean, r, s, pool) == ML_SUCCESS;
+        double gamma_new = simd->sum_sq(s, d);
+        double beta = gamma_new / gamma;
+        if (!isfinite(gamma_new) || !isfinite(beta)) {
+            ok = false;
+            break;
+        }
+        gamma = gamma_new;
+        for (int j = 0; j < d; j++) p[j] = s[j] + beta * p[j];
+    }
+
+    free(r);
+    free(q);
+    free(s);
+    free(p);
+    return ok;
+}
+
+// Fused predict/error/gradient over rows rows[0..count) (or the first count
+// rows of X when rows is NULL): one pass per row accumulates
+// grad[0..d) += e * x and grad[d] += e with e = x.w + b - y.
+// Returns the summed squared error.
+static double linreg_batch_gradient(const LinearRegression *lr, const Matrix *X, const Matrix *y,
+                                    const int *rows, int begin, int count, double *grad) {
+    const simd_kernels_t *simd = simd_kernels();
+    int d = X->cols;
+    const double *w = lr->weights->data;
+    double sse = 0.0;
+    memset(grad, 0, (d + 1) * sizeof(double));
+    for (int r = 0; r < count; r++) {
+        int i = rows ? rows[begin + r] : begin + r;
+        const double *x = matrix_row(X, i);
+        double e = simd->dot(x, w, d) + lr->bias - matrix_row(y, i)[0];
+        for (int j = 0; j < d; j++) grad[j] += e * x[j];
+        grad[d] += e;
+        sse += e * e;
+    }
+    return sse;
+}
+
+// Gradient of rows [begin, end) into grad[0..d], squared error into grad[d + 1]
+static void linreg_gradient_rows(void *ctx, int begin, int end, void *partial) {
+    const LinregReduceTask *task = ctx;
+    double *grad = partial;
+    grad[task->X->cols + 1] = linreg_batch_gradient(task->lr, task->X, task->y, NULL, begin, end - begin, grad);
+}
+
+static void linreg_fit_gd(LinearRegression *lr, ThreadPool *pool, const Matrix *X, const Matrix *y,
+                          double learning_rate, int max_iters) {
+    int d = X->cols;
+    double *grad = malloc((d + 2) * sizeof(double));
+    if (!grad) return;
+    LinregReduceTask task = { .lr = lr, .X = X, .y = y, .value_len = d + 2 };
+
+    lr->n_iter = 0;
+    for (int iter = 0; iter < max_iters; iter++) {
+        lr->n_iter = iter + 1;
 
-        // Compute gradient for weights: grad = (X^T * error) / n
-        matrix_transpose(X, X_t);
-        matrix_multiply(X_t, error, grad);
-        for (int i = 0; i < grad->rows; i++) {
-            grad->data[i] /= X->rows;
+        // Gradient of the mean squared error in a single pass over X, timed
+        // here rather than per chunk so the phase stays wall time
+        ML_PROFILE_BEGIN(ML_PHASE_LINREG_GRADIENT);
+        ml_error_t err = parallel_reduce(pool, X->rows, LINREG_REDUCE_ROWS, (d + 2) * sizeof(double),
+                                         linreg_gradient_rows, linreg_sum_partials, &task, grad);
+        ML_PROFILE_END(ML_PHASE_LINREG_GRADIENT);
+        if (err != ML_SUCCESS) break;
+        for (int j = 0; j <= d; j++) grad[j] /= X->rows;
+
+        // Update weights and bias
+        ML_PROFILE_BEGIN(ML_PHASE_LINREG_UPDATE);
+        for (int j = 0; j < d; j++) {
+            lr->weights->data[j] -= learning_rate * grad[j];
         }
+        lr->bias -= learning_rate * grad[d];
+        ML_PROFILE_END(ML_PHASE_LINREG_UPDATE);
+
+        // Stop once the full gradient is negligible
+        if (sqrt(simd_kernels()->sum_sq(grad, d + 1)) <= lr->tol) break;
+    }
+
+    free(grad);
+}
+
+// Allocate optimizer state on first use, or after the solver changed to one
+// that needs more of it
+static bool linreg_optimizer_state(LinearRegression *lr) {
+    int d = lr->weights->rows;
+    if (!lr->velocity) {
+        lr->velocity = calloc(d + 1, sizeof(double));
+        if (!lr->velocity) return false;
+    }
+    if (lr->solver == LINREG_SOLVER_ADAM && !lr->second_moment) {
+        lr->second_moment = calloc(d + 1, sizeof(double));
+        if (!lr->second_moment) return false;
+    }
+    return true;
+}
+
+// Apply one SGD-momentum or Adam update from a mean gradient over d + 1
+// parameters (bias last)
+static void linreg_optimizer_step(LinearRegression *lr, const double *grad, double learning_rate) {
+    int d = lr->weights->rows;
+    double *w = lr->weights->data;
+    double *v = lr->velocity;
+    lr->n_steps++;
+    ML_PROFILE_BEGIN(ML_PHASE_LINREG_UPDATE);
 
-        // Update weights: weights -= learning_rate * grad
-        for (int i = 0; i < lr->weights->rows; i++) {
-            lr->weights->data[i] -= learning_rate * grad->data[i];
+    if (lr->solver == LINREG_SOLVER_ADAM) {
+        double *s = lr->second_moment;
+        double b1 = lr->beta1, b2 = lr->beta2;
+        double step = learning_rate * sqrt(1.0 - pow(b2, (double)lr->n_steps)) /
+                      (1.0 - pow(b1, (double)lr->n_steps));
+        for (int j = 0; j <= d; j++) {
+            v[j] = b1 * v[j] + (1.0 - b1) * grad[j];
+            s[j] = b2 * s[j] + (1.0 - b2) * grad[j] * grad[j];
+            double delta = step * v[j] / (sqrt(s[j]) + 1e-8);
+            if (j < d) w[j] -= delta;
+            else lr->bias -= delta;
         }
+    } else {
+        for (int j = 0; j <= d; j++) {
+            v[j] = lr->momentum * v[j] + grad[j];
+            if (j < d) w[j] -= learning_rate * v[j];
+            else lr->bias -= learning_rate * v[j];
+        }
+    }
+    ML_PROFILE_END(ML_PHASE_LINREG_UPDATE);
+}
+
+// One epoch of mini-batch updates. rows is the visiting order, NULL for
+// storage order. Returns the summed squared error seen during the epoch.
+static double linreg_epoch(LinearRegression *lr, const Matrix *X, const Matrix *y,
+                           const int *rows, double learning_rate, double *grad) {
+    int d = X->cols;
+    int batch = lr->batch_size > 0 ? lr->batch_size : X->rows;
+    double sse = 0.0;
+    for (int begin = 0; begin < X->rows; begin += batch) {
+        int count = X->rows - begin < batch ? X->rows - begin : batch;
+        ML_PROFILE_BEGIN(ML_PHASE_LINREG_GRADIENT);
+        sse += linreg_batch_gradient(lr, X, y, rows, begin, count, grad);
+        ML_PROFILE_END(ML_PHASE_LINREG_GRADIENT);
+        for (int j = 0; j <= d; j++) grad[j] /= count;
+        linreg_optimizer_step(lr, grad, learning_rate);
+    }
+    return sse;
+}
+
+static void linreg_fit_minibatch(LinearRegression *lr, const Matrix *X, const Matrix *y,
+                                 double learning_rate, int max_epochs) {
+    int n = X->rows, d = X->cols;
+    double *grad = malloc((d + 1) * sizeof(double));
+    int *rows = lr->shuffle ? malloc(n * sizeof(int)) : NULL;
+    if (!grad || (lr->shuffle && !rows) || !linreg_optimizer_state(lr)) {
+        free(grad);
+        free(rows);
+        return;
+    }
+    if (rows) {
+        for (int i = 0; i < n; i++) rows[i] = i;
+    }
+
+    lr->n_iter = 0;
+    double prev_mse = INFINITY;
+    for (int epoch = 0; epoch < max_epochs; epoch++) {
+        lr->n_iter = epoch + 1;
+        if (rows) ml_shuffle(rows, n, lr->seed, (uint64_t)epoch);
+        double mse = linreg_epoch(lr, X, y, rows, learning_rate, grad) / n;
 
-        // Compute gradient for bias: mean of error
-        double bias_grad = 0.0;
-        for (int i = 0; i < error->rows; i++) {
-            bias_grad += error->data[i];
+        // Stochastic gradients never vanish exactly, so stop on the epoch
+        // loss settling instead
+        if (fabs(prev_mse - mse) <= lr->tol * (1.0 + mse)) break;
+        prev_mse = mse;
+    }
+
+    free(grad);
+    free(rows);
+}
+
+void linreg_partial_fit(LinearRegression *lr, const Matrix *X, const Matrix *y, double learning_rate) {
+    if (!lr || !X || !y || X->rows != y->rows || y->cols != 1 || X->cols != lr->weights->rows) return;
+    if (X->rows == 0) return;
+
+    double *grad = malloc((X->cols + 1) * sizeof(double));
+    if (!grad || !linreg_optimizer_state(lr)) {
+        free(grad);
+        return;
+    }
+    linreg_epoch(lr, X, y, NULL, learning_rate, grad);
+    free(grad);
+}
+
+void linreg_fit(LinearRegression *lr, const Matrix *X, const Matrix *y, double learning_rate, int max_iters) {
+    if (!lr || !X || !y || X->rows != y->rows || y->cols != 1 || X->cols != lr->weights->rows) return;
+
+    if (lr->solver == LINREG_SOLVER_SGD || lr->solver == LINREG_SOLVER_ADAM) {
+        linreg_fit_minibatch(lr, X, y, learning_rate, max_iters);
+        return;
+    }
+    ThreadPool *owned_pool;
+    ThreadPool *pool = thread_pool_select(lr->pool, lr->n_threads, &owned_pool);
+    if (lr->solver == LINREG_SOLVER_GD) {
+        linreg_fit_gd(lr, pool, X, y, learning_rate, max_iters);
+        thread_pool_free(owned_pool);
+        return;
+    }
+
+    double *mean = malloc(X->cols * sizeof(double));
+    if (!mean) {
+        thread_pool_free(owned_pool);
+        return;
+    }
+    linreg_column_means(X, mean);
+    double y_mean = linreg_mean(y);
+
+    bool ok;
+    ML_PROFILE_BEGIN(ML_PHASE_LINREG_SOLVE);
+    switch (lr->solver) {
+    case LINREG_SOLVER_CHOLESKY:
+        lr->n_iter = 1;
+        ok = linreg_fit_cholesky(lr, pool, X, y, mean, y_mean);
+        if (!ok) {
+            // Singular X^T X: QR copes with the rank deficiency
+            ML_DEBUG_PRINT("Cholesky failed, falling back to QR");
+            ok = linreg_fit_qr(lr, X, y, mean, y_mean);
+        }
+        break;
+    case LINREG_SOLVER_QR:
+        lr->n_iter = 1;
+        ok = linreg_fit_qr(lr, X, y, mean, y_mean);
+        break;
+    default:
+        ok = linreg_fit_cg(lr, pool, X, y, mean, y_mean, max_iters);
+        if (!ok) {
+            ML_DEBUG_PRINT("CG broke down, falling back to QR");
+            ok = linreg_fit_qr(lr, X, y, mean, y_mean);
         }
-        bias_grad /= X->rows;
+        break;
+    }
+    ML_PROFILE_END(ML_PHASE_LINREG_SOLVE);
+    if (ok) lr->bias = linreg_intercept(lr, mean, y_mean);
+    free(mean);
+    thread_pool_free(owned_pool);
+}
 
-        // Update bias
-        lr->bias -= learning_rate * bias_grad;
+double linreg_predict_one(const LinearRegression *lr, const double *x) {
+    return simd_kernels()->dot(x, lr->weights->data, lr->weights->rows) + lr->bias;
+}
+
+// One dot product per row against the d x 1 weights, which stay in cache
+// for the whole batch. A GEMM here would pack X for a single output column.
+ml_error_t linreg_predict_into(const LinearRegression *lr, const Matrix *X, double *out) {
+    ML_CHECK_NULL(lr);
+    ML_CHECK_NULL(X);
+    ML_CHECK_NULL(out);
+    if (X->cols != lr->weights->rows) return ML_ERROR_DIMENSION_MISMATCH;
+
+    ML_PROFILE_BEGIN(ML_PHASE_LINREG_PREDICT);
+    const simd_kernels_t *simd = simd_kernels();
+    const double *weights = lr->weights->data;
+    for (int i = 0; i < X->rows; i++) {
+        out[i] = simd->dot(matrix_row(X, i), weights, X->cols) + lr->bias;
     }
+    ML_PROFILE_END(ML_PHASE_LINREG_PREDICT);
+    return ML_SUCCESS;
+}
 
-    matrix_free(pred);
-    matrix_free(error);
-    matrix_free(X_t);
-    matrix_free(grad);
+// One sparse dot product per row: O(nnz) work for the whole batch
+ml_error_t linreg_predict_sparse_into(const LinearRegression *lr, const SparseMatrix *X, double *out) {
+    ML_CHECK_NULL(lr);
+    ML_CHECK_NULL(X);
+    ML_CHECK_NULL(out);
+    if (X->cols > lr->weights->rows) return ML_ERROR_DIMENSION_MISMATCH;
+
+    ML_PROFILE_BEGIN(ML_PHASE_LINREG_PREDICT);
+    for (int i = 0; i < X->rows; i++) {
+        out[i] = sparse_row_dot(X, i, lr->weights->data) + lr->bias;
+    }
+    ML_PROFILE_END(ML_PHASE_LINREG_PREDICT);
+    return ML_SUCCESS;
 }
 
 Matrix* linreg_predict(const LinearRegression *lr, const Matrix *X) {
     if (!lr || !X || X->cols != lr->weights->rows) return NULL;
     Matrix *pred = matrix_create(X->rows, 1);
     if (!pred) return NULL;
+    linreg_predict_into(lr, X, pred->data);
+    return pred;
+}
 
-    // pred = X * weights + bias
-    matrix_multiply(X, lr->weights, pred);
-    for (int i = 0; i < pred->rows; i++) {
-        pred->data[i] += lr->bias;
+LinregCompact* linreg_compact(const LinearRegression *lr, ml_precision_t precision) {
+    if (!lr || (precision != ML_PRECISION_F32 && precision != ML_PRECISION_Q8)) return NULL;
+    LinregCompact *model = calloc(1, sizeof(LinregCompact));
+    if (!model) return NULL;
+    model->precision = precision;
+    model->n_features = lr->weights->rows;
+    model->bias = lr->bias;
+    // The weight vector as a single row, so int8 weights share one scale
+    Matrix *row = matrix_view_buffer(lr->weights->data, 1, lr->weights->rows);
+    if (row && precision == ML_PRECISION_F32) model->weights = matrix_f32_from_matrix(row);
+    if (row && precision == ML_PRECISION_Q8) model->weights_q8 = matrix_q8_quantize(row);
+    matrix_free(row);
+    if (!model->weights && !model->weights_q8) {
+        linreg_compact_free(model);
+        return NULL;
     }
+    return model;
+}
 
-    return pred;
-}
\ No newline at end of file
+void linreg_compact_free(LinregCompact *model) {
+    if (model) {
+        matrix_f32_free(model->weights);
+        matrix_q8_free(model->weights_q8);
+        free(model);
+    }
+}
+
+ml_error_t linreg_compact_predict_into(const LinregCompact *model, const MatrixF32 *X, double *out) {
+    ML_CHECK_NULL(model);
+    ML_CHECK_NULL(X);
+    ML_CHECK_NULL(out);
+    if (X->cols != model->n_features) return ML_ERROR_DIMENSION_MISMATCH;
+
+    const simd_kernels_t *simd = simd_kernels();
+    if (model->precision == ML_PRECISION_F32) {
+        const float *w = model->weights->data;
+        for (int i = 0; i < X->rows; i++) {
+            out[i] = simd->dot_f32(matrix_f32_row(X, i), w, X->cols) + model->bias;
+        }
+    } else {
+        const int8_t *w = model->weights_q8->data;
+        double scale = model->weights_q8->scales[0];
+        for (int i = 0; i < X->rows; i++) {
+            out[i] = scale * simd->dot_s8_f32(w, matrix_f32_row(X, i), X->cols) + model->bias;
+        }
+    }
+    return ML_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #include "kmeans.h"
 #include "dataset.h"
-#include "visualize.h"
+#include "visualise.h"
+#include "profile.h"
 #include <stdio.h>
 
 int main(int argc, char *argv[]) {
@@ -9,6 +10,12 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    // ML_TRACE=file.json records a Chrome trace in ML_PROFILE builds
+    const char *trace = getenv("ML_TRACE");
+    if (trace && profile_trace_start(trace) != ML_SUCCESS) {
+        fprintf(stderr, "Tracing unavailable (build with ML_PROFILE)\n");
+    }
+
     Matrix *data = load_csv(argv[1]);
     if (!data) {
         printf("Failed to load dataset\n");
@@ -22,6 +29,8 @@ int main(int argc, char *argv[]) {
     Matrix *labels = kmeans_predict(km, data);
 
     visualize_clusters(data, labels, km->centroids);
+    if (profile_enabled()) profile_print(stderr);
+    if (trace) profile_trace_stop();
 
     matrix_free(labels);
     kmeans_free(km);
@@ -1,6 +1,27 @@
 #include "matrix.h"
+#include "simd.h"
+#include "profile.h"
+#include "thread_pool.h"
 #include <time.h>
 
+// The header is padded to ML_ALIGNMENT so data placed right after it
+// starts on a cache line
+#define MATRIX_HEADER_SIZE ((sizeof(Matrix) + ML_ALIGNMENT - 1) / ML_ALIGNMENT * ML_ALIGNMENT)
+
+static double* matrix_inline_data(const Matrix *m) {
+    return (double*)((char*)m + MATRIX_HEADER_SIZE);
+}
+
+static void matrix_init_header(Matrix *m, double *data, int rows, int cols) {
+    m->data = data;
+    m->rows = rows;
+    m->cols = cols;
+    m->stride = cols;
+    m->is_view = false;
+    m->in_arena = false;
+    m->owns_data = false;
+}
+
 // Matrix creation and destruction
 Matrix* matrix_create(int rows, int cols) {
     if (rows <= 0 || cols <= 0) {
@@ -8,18 +29,26 @@ Matrix* matrix_create(int rows, int cols) {
         return NULL;
     }
     
-    Matrix *m = malloc(sizeof(Matrix));
-    if (!m) return NULL;
+    size_t data_bytes = (size_t)rows * cols * sizeof(double);
+    void *mem = NULL;
+    if (posix_memalign(&mem, ML_ALIGNMENT, MATRIX_HEADER_SIZE + data_bytes) != 0) return NULL;
+    ML_PROFILE_COUNT(ML_COUNTER_ALLOCATIONS, 1);
     
-    m->data = calloc(rows * cols, sizeof(double));
-    if (!m->data) {
-        free(m);
-        return NULL;
-    }
+    Matrix *m = mem;
+    matrix_init_header(m, matrix_inline_data(m), rows, cols);
+    memset(m->data, 0, data_bytes);
+    return m;
+}
+
+Matrix* matrix_create_in(Arena *arena, int rows, int cols) {
+    if (!arena || rows <= 0 || cols <= 0) return NULL;
     
-    m->rows = rows;
-    m->cols = cols;
-    m->is_view = false;
+    Matrix *m = arena_alloc(arena, MATRIX_HEADER_SIZE + (size_t)rows * cols * sizeof(double));
+    if (!m) return NULL;
+    
+    matrix_init_header(m, matrix_inline_data(m), rows, cols);
+    memset(m->data, 0, (size_t)rows * cols * sizeof(double));
+    m->in_arena = true;
     return m;
 }
 
@@ -33,6 +62,18 @@ Matrix* matrix_create_from_array(const double *data, int rows, int cols) {
     return m;
 }
 
+Matrix* matrix_create_from_buffer(double *data, int rows, int cols) {
+    if (!data || rows <= 0 || cols <= 0) return NULL;
+    
+    Matrix *m = malloc(sizeof(Matrix));
+    if (!m) return NULL;
+    ML_PROFILE_COUNT(ML_COUNTER_ALLOCATIONS, 1);
+    
+    matrix_init_header(m, data, rows, cols);
+    m->owns_data = true;
+    return m;
+}
+
 Matrix* matrix_create_zeros(int rows, int cols) {
     return matrix_create(rows, cols);  // calloc already zeros memory
 }
@@ -71,8 +112,17 @@ Matrix* matrix_create_random(int rows, int cols, double min_val, double max_val)
 
 Matrix* matrix_copy(const Matrix *src) {
     if (!matrix_is_valid(src)) return NULL;
+    if (matrix_is_contiguous(src)) {
+        return matrix_create_from_array(src->data, src->rows, src->cols);
+    }
+    
+    Matrix *m = matrix_create(src->rows, src->cols);
+    if (!m) return NULL;
     
-    return matrix_create_from_array(src->data, src->rows, src->cols);
+    for (int i = 0; i < src->rows; i++) {
+        memcpy(matrix_row(m, i), matrix_row(src, i), src->cols * sizeof(double));
+    }
+    return m;
 }
 
 Matrix* matrix_view(Matrix *src, int start_row, int start_col, int rows, int cols) {
@@ -81,28 +131,39 @@ Matrix* matrix_view(Matrix *src, int start_row, int start_col, int rows, int col
         return NULL;
     }
     
+    // Rows of the view keep the parent's stride, so a narrow view steps
+    // over the parent's remaining columns between rows
+    return matrix_view_strided(matrix_row(src, start_row) + start_col, rows, cols, src->stride);
+}
+
+Matrix* matrix_view_buffer(double *data, int rows, int cols) {
+    return matrix_view_strided(data, rows, cols, cols);
+}
+
+Matrix* matrix_view_strided(double *data, int rows, int cols, int stride) {
+    if (!data || rows <= 0 || cols <= 0 || stride < cols) return NULL;
+    
     Matrix *view = malloc(sizeof(Matrix));
     if (!view) return NULL;
+    ML_PROFILE_COUNT(ML_COUNTER_ALLOCATIONS, 1);
     
-    view->data = src->data + start_row * src->cols + start_col;
-    view->rows = rows;
-    view->cols = cols;
+    matrix_init_header(view, data, rows, cols);
+    view->stride = stride;
     view->is_view = true;
     return view;
 }
 
 void matrix_free(Matrix *m) {
-    if (m) {
-        if (!m->is_view) {
-            ML_SAFE_FREE(m->data);
-        }
+    if (m && !m->in_arena) {
+        // Data from matrix_create shares the header's allocation
+        if (m->owns_data) ML_SAFE_FREE(m->data);
         free(m);
     }
 }
 
 // Matrix properties
 bool matrix_is_valid(const Matrix *m) {
-    return m && m->data && m->rows > 0 && m->cols > 0;
+    return m && m->data && m->rows > 0 && m->cols > 0 && m->stride >= m->cols;
 }
 
 bool matrix_same_size(const Matrix *a, const Matrix *b) {
@@ -118,7 +179,7 @@ double matrix_get(const Matrix *m, int row, int col) {
     if (!matrix_is_valid(m) || row < 0 || row >= m->rows || col < 0 || col >= m->cols) {
         return NAN;
     }
-    return m->data[row * m->cols + col];
+    return matrix_row(m, row)[col];
 }
 
 ml_error_t matrix_set(Matrix *m, int row, int col, double value) {
@@ -126,10 +187,24 @@ ml_error_t matrix_set(Matrix *m, int row, int col, double value) {
     if (row < 0 || row >= m->rows || col < 0 || col >= m->cols) {
         return ML_ERROR_INVALID_PARAMETER;
     }
-    m->data[row * m->cols + col] = value;
+    matrix_row(m, row)[col] = value;
     return ML_SUCCESS;
 }
 
+// Element-wise kernels over whole matrices: one call over the flat
+// buffers when every operand is contiguous, otherwise one call per row
+typedef void (*matrix_binary_fn)(const double *a, const double *b, double *out, int n);
+
+static void matrix_apply_binary(matrix_binary_fn fn, const Matrix *a, const Matrix *b, Matrix *result) {
+    if (matrix_is_contiguous(a) && matrix_is_contiguous(b) && matrix_is_contiguous(result)) {
+        fn(a->data, b->data, result->data, a->rows * a->cols);
+        return;
+    }
+    for (int i = 0; i < a->rows; i++) {
+        fn(matrix_row(a, i), matrix_row(b, i), matrix_row(result, i), a->cols);
+    }
+}
+
 // Basic operations
 ml_error_t matrix_add(const Matrix *a, const Matrix *b, Matrix *result) {
     ML_CHECK_NULL(a);
@@ -140,10 +215,7 @@ ml_error_t matrix_add(const Matrix *a, const Matrix *b, Matrix *result) {
         return ML_ERROR_DIMENSION_MISMATCH;
     }
     
-    int size = a->rows * a->cols;
-    for (int i = 0; i < size; i++) {
-        result->data[i] = a->data[i] + b->data[i];
-    }
+    matrix_apply_binary(simd_kernels()->add, a, b, result);
     return ML_SUCCESS;
 }
 
@@ -156,13 +228,148 @@ ml_error_t matrix_subtract(const Matrix *a, const Matrix *b, Matrix *result) {
         return ML_ERROR_DIMENSION_MISMATCH;
     }
     
-    int size = a->rows * a->cols;
-    for (int i = 0; i < size; i++) {
-        result->data[i] = a->data[i] - b->data[i];
-    }
+    matrix_apply_binary(simd_kernels()->sub, a, b, result);
     return ML_SUCCESS;
 }
 
+// Blocked GEMM. MR x NR is the register tile produced by the micro-kernel;
+// KC x NR slivers of B stay in L1, MC x KC blocks of A in L2 and KC x NC
+// panels of B in L3. Both operands are packed so the kernel streams
+// contiguous memory regardless of the source layout.
+#define GEMM_MR 4
+#define GEMM_NR 8
+#define GEMM_KC 256
+#define GEMM_MC 128
+#define GEMM_NC 2048
+// Below this many multiply-adds the packing overhead outweighs the gain
+#define GEMM_SMALL_FLOPS (48 * 48 * 48)
+// From this many multiply-adds up the rows are shared across threads
+#define GEMM_PARALLEL_FLOPS (160 * 160 * 160)
+
+static int gemm_min(int a, int b) {
+    return a < b ? a : b;
+}
+
+// Pack an mc x kc block of A into MR-row slivers, column by column,
+// zero-padding the last sliver so the kernel never needs a row guard
+static void gemm_pack_a(const double *a, int lda, int mc, int kc, double *buf) {
+    for (int i = 0; i < mc; i += GEMM_MR) {
+        int mr = gemm_min(GEMM_MR, mc - i);
+        for (int p = 0; p < kc; p++) {
+            int r = 0;
+            for (; r < mr; r++) buf[r] = a[(size_t)(i + r) * lda + p];
+            for (; r < GEMM_MR; r++) buf[r] = 0.0;
+            buf += GEMM_MR;
+        }
+    }
+}
+
+// Pack a kc x nc panel of B into NR-column slivers, row by row
+static void gemm_pack_b(const double *b, int ldb, int kc, int nc, double *buf) {
+    for (int j = 0; j < nc; j += GEMM_NR) {
+        int nr = gemm_min(GEMM_NR, nc - j);
+        for (int p = 0; p < kc; p++) {
+            const double *src = b + (size_t)p * ldb + j;
+            int c = 0;
+            for (; c < nr; c++) buf[c] = src[c];
+            for (; c < GEMM_NR; c++) buf[c] = 0.0;
+            buf += GEMM_NR;
+        }
+    }
+}
+
+// C[mr x nr] += packed A sliver * packed B sliver. The accumulator tile is
+// small enough to live in vector registers for the whole kc loop.
+static void gemm_micro_kernel(int kc, const double *a, const double *b,
+                              double *c, int ldc, int mr, int nr) {
+    double acc[GEMM_MR][GEMM_NR] = {{0.0}};
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < GEMM_MR; i++) {
+            double ai = a[i];
+            for (int j = 0; j < GEMM_NR; j++) {
+                acc[i][j] += ai * b[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (int i = 0; i < mr; i++) {
+        for (int j = 0; j < nr; j++) {
+            c[(size_t)i * ldc + j] += acc[i][j];
+        }
+    }
+}
+
+// i-k-j loop for small products and matrix-vector shapes: the inner loop
+// walks rows of B and C contiguously, which is all the blocking they need
+static void gemm_small(const double *a, int lda, const double *b, int ldb,
+                       double *c, int ldc, int m, int n, int k) {
+    for (int i = 0; i < m; i++) {
+        double *c_row = c + (size_t)i * ldc;
+        for (int p = 0; p < k; p++) {
+            double a_ip = a[(size_t)i * lda + p];
+            const double *b_row = b + (size_t)p * ldb;
+            for (int j = 0; j < n; j++) {
+                c_row[j] += a_ip * b_row[j];
+            }
+        }
+    }
+}
+
+// Rows [row_begin, row_end) of C += A * B, with pack buffers from the
+// calling thread's scratch arena: aligned for the micro-kernel's vector
+// loads and reused across calls instead of malloc'd per product
+static bool gemm_rows(const Matrix *a, const Matrix *b, Matrix *result, int row_begin, int row_end) {
+    int m = row_end - row_begin, n = b->cols, k = a->cols;
+    int lda = a->stride, ldb = b->stride, ldc = result->stride;
+    int kc_max = gemm_min(k, GEMM_KC);
+    int mc_max = (gemm_min(m, GEMM_MC) + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    int nc_max = (gemm_min(n, GEMM_NC) + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    Arena *scratch = arena_thread_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    double *a_pack = arena_alloc(scratch, (size_t)mc_max * kc_max * sizeof(double));
+    double *b_pack = arena_alloc(scratch, (size_t)kc_max * nc_max * sizeof(double));
+    if (!a_pack || !b_pack) {
+        arena_release(scratch, mark);
+        return false;
+    }
+
+    for (int jc = 0; jc < n; jc += GEMM_NC) {
+        int nc = gemm_min(GEMM_NC, n - jc);
+        for (int pc = 0; pc < k; pc += GEMM_KC) {
+            int kc = gemm_min(GEMM_KC, k - pc);
+            gemm_pack_b(matrix_row(b, pc) + jc, ldb, kc, nc, b_pack);
+            for (int ic = row_begin; ic < row_end; ic += GEMM_MC) {
+                int mc = gemm_min(GEMM_MC, row_end - ic);
+                gemm_pack_a(matrix_row(a, ic) + pc, lda, mc, kc, a_pack);
+                for (int jr = 0; jr < nc; jr += GEMM_NR) {
+                    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+                        gemm_micro_kernel(kc, a_pack + ir * kc, b_pack + jr * kc,
+                                          matrix_row(result, ic + ir) + jc + jr, ldc,
+                                          gemm_min(GEMM_MR, mc - ir), gemm_min(GEMM_NR, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+
+    arena_release(scratch, mark);
+    return true;
+}
+
+typedef struct {
+    const Matrix *a;
+    const Matrix *b;
+    Matrix *result;
+    bool failed;
+} GemmTask;
+
+static void gemm_row_blocks(void *ctx, int begin, int end, int thread_id) {
+    GemmTask *task = ctx;
+    (void)thread_id;
+    if (!gemm_rows(task->a, task->b, task->result, begin, end)) __atomic_store_n(&task->failed, true, __ATOMIC_RELAXED);
+}
+
 ml_error_t matrix_multiply(const Matrix *a, const Matrix *b, Matrix *result) {
     ML_CHECK_NULL(a);
     ML_CHECK_NULL(b);
@@ -175,16 +382,24 @@ ml_error_t matrix_multiply(const Matrix *a, const Matrix *b, Matrix *result) {
     // Initialize result to zero
     matrix_fill(result, 0.0);
     
-    // Perform multiplication
-    for (int i = 0; i < a->rows; i++) {
-        for (int j = 0; j < b->cols; j++) {
-            for (int k = 0; k < a->cols; k++) {
-                result->data[i * result->cols + j] += 
-                    a->data[i * a->cols + k] * b->data[k * b->cols + j];
-            }
-        }
+    int m = a->rows, n = b->cols, k = a->cols;
+    if (n < GEMM_NR || m < GEMM_MR || (double)m * n * k < GEMM_SMALL_FLOPS) {
+        gemm_small(a->data, a->stride, b->data, b->stride, result->data, result->stride, m, n, k);
+        return ML_SUCCESS;
     }
-    return ML_SUCCESS;
+    if ((double)m * n * k < GEMM_PARALLEL_FLOPS) {
+        return gemm_rows(a, b, result, 0, m) ? ML_SUCCESS : ML_ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Row blocks of C across the global pool, a couple per thread and
+    // whole register tiles each. Every element is still computed by one
+    // thread in the serial order, so the result is the same bit for bit.
+    ThreadPool *pool = thread_pool_global();
+    int grain = (m + 2 * thread_pool_size(pool) - 1) / (2 * thread_pool_size(pool));
+    grain = (grain + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    GemmTask task = { a, b, result, false };
+    parallel_for(pool, m, grain, gemm_row_blocks, &task);
+    return task.failed ? ML_ERROR_MEMORY_ALLOCATION : ML_SUCCESS;
 }
 
 ml_error_t matrix_multiply_scalar(const Matrix *m, double scalar, Matrix *result) {
@@ -195,13 +410,92 @@ ml_error_t matrix_multiply_scalar(const Matrix *m, double scalar, Matrix *result
         return ML_ERROR_DIMENSION_MISMATCH;
     }
     
-    int size = m->rows * m->cols;
-    for (int i = 0; i < size; i++) {
-        result->data[i] = m->data[i] * scalar;
+    const simd_kernels_t *simd = simd_kernels();
+    if (matrix_is_contiguous(m) && matrix_is_contiguous(result)) {
+        simd->scale(m->data, scalar, result->data, m->rows * m->cols);
+        return ML_SUCCESS;
+    }
+    for (int i = 0; i < m->rows; i++) {
+        simd->scale(matrix_row(m, i), scalar, matrix_row(result, i), m->cols);
     }
     return ML_SUCCESS;
 }
 
+// Cache-oblivious transpose: the longer side is halved until a tile fits
+// in L1, so reads and writes both use whole cache lines at every level of
+// the memory hierarchy without tuning a block size per machine
+#define TRANSPOSE_TILE 32
+
+static void transpose_blocks(const double *src, int lds, double *dst, int ldd, int rows, int cols) {
+    if (rows <= TRANSPOSE_TILE && cols <= TRANSPOSE_TILE) {
+        for (int j = 0; j < cols; j++) {
+            double *out = dst + (size_t)j * ldd;
+            for (int i = 0; i < rows; i++) out[i] = src[(size_t)i * lds + j];
+        }
+    } else if (rows >= cols) {
+        int half = rows / 2;
+        transpose_blocks(src, lds, dst, ldd, half, cols);
+        transpose_blocks(src + (size_t)half * lds, lds, dst + half, ldd, rows - half, cols);
+    } else {
+        int half = cols / 2;
+        transpose_blocks(src, lds, dst, ldd, rows, half);
+        transpose_blocks(src + half, lds, dst + (size_t)half * ldd, ldd, rows, cols - half);
+    }
+}
+
+// Swap the rows x cols block at a with the transpose of the cols x rows
+// block at b, both in one matrix with leading dimension ld
+static void transpose_swap_blocks(double *a, double *b, int ld, int rows, int cols) {
+    if (rows <= TRANSPOSE_TILE && cols <= TRANSPOSE_TILE) {
+        // Stage b's tile on the stack so both tiles are walked along their
+        // rows; swapping element by element reads b down its columns, which
+        // at power-of-two strides all land in the same few cache sets
+        double tile[TRANSPOSE_TILE * TRANSPOSE_TILE];
+        for (int j = 0; j < cols; j++) {
+            const double *row = b + (size_t)j * ld;
+            for (int i = 0; i < rows; i++) tile[i * TRANSPOSE_TILE + j] = row[i];
+        }
+        for (int i = 0; i < rows; i++) {
+            double *row = a + (size_t)i * ld;
+            for (int j = 0; j < cols; j++) {
+                double tmp = row[j];
+                row[j] = tile[i * TRANSPOSE_TILE + j];
+                tile[i * TRANSPOSE_TILE + j] = tmp;
+            }
+        }
+        for (int j = 0; j < cols; j++) {
+            double *row = b + (size_t)j * ld;
+            for (int i = 0; i < rows; i++) row[i] = tile[i * TRANSPOSE_TILE + j];
+        }
+    } else if (rows >= cols) {
+        int half = rows / 2;
+        transpose_swap_blocks(a, b, ld, half, cols);
+        transpose_swap_blocks(a + (size_t)half * ld, b + half, ld, rows - half, cols);
+    } else {
+        int half = cols / 2;
+        transpose_swap_blocks(a, b, ld, rows, half);
+        transpose_swap_blocks(a + half, b + (size_t)half * ld, ld, rows, cols - half);
+    }
+}
+
+// Diagonal blocks transpose in place, off-diagonal ones swap with each other
+static void transpose_square(double *a, int ld, int n) {
+    if (n <= TRANSPOSE_TILE) {
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                double tmp = a[(size_t)i * ld + j];
+                a[(size_t)i * ld + j] = a[(size_t)j * ld + i];
+                a[(size_t)j * ld + i] = tmp;
+            }
+        }
+        return;
+    }
+    int half = n / 2;
+    transpose_square(a, ld, half);
+    transpose_square(a + (size_t)half * ld + half, ld, n - half);
+    transpose_swap_blocks(a + half, a + (size_t)half * ld, ld, half, n - half);
+}
+
 ml_error_t matrix_transpose(const Matrix *m, Matrix *result) {
     ML_CHECK_NULL(m);
     ML_CHECK_NULL(result);
@@ -209,13 +503,155 @@ ml_error_t matrix_transpose(const Matrix *m, Matrix *result) {
     if (m->rows != result->cols || m->cols != result->rows) {
         return ML_ERROR_DIMENSION_MISMATCH;
     }
+    if (m->data == result->data && m->stride == result->stride) {
+        return matrix_transpose_inplace(result);
+    }
     
-    for (int i = 0; i < m->rows; i++) {
-        for (int j = 0; j < m->cols; j++) {
-            result->data[j * result->cols + i] = m->data[i * m->cols + j];
+    transpose_blocks(m->data, m->stride, result->data, result->stride, m->rows, m->cols);
+    return ML_SUCCESS;
+}
+
+ml_error_t matrix_transpose_inplace(Matrix *m) {
+    ML_CHECK_NULL(m);
+    if (m->rows != m->cols) return ML_ERROR_DIMENSION_MISMATCH;
+    transpose_square(m->data, m->stride, m->rows);
+    return ML_SUCCESS;
+}
+
+// A^T x and Gram matrices are reduced over fixed blocks of rows of A, so
+// results are the same on any number of threads. Partials of one
+// reduction are kept under MATRIX_REDUCE_BYTES by growing the blocks.
+#define MATRIX_REDUCE_ROWS 2048
+#define MATRIX_REDUCE_BYTES ((size_t)64 << 20)
+// Rows centered at a time by matrix_syrk; the block stays in L2 while
+// every row of the Gram matrix is updated from it
+#define SYRK_BLOCK_ROWS 64
+
+typedef struct {
+    const Matrix *a;
+    const double *x;        // matrix_gemv_t
+    const double *center;   // may be NULL
+    int value_len;
+    bool failed;
+} MatrixReduceTask;
+
+static int matrix_reduce_grain(int rows, size_t value_bytes) {
+    double grain = (double)rows * value_bytes / MATRIX_REDUCE_BYTES + 1.0;
+    return grain > MATRIX_REDUCE_ROWS ? (int)grain : MATRIX_REDUCE_ROWS;
+}
+
+static void matrix_reduce_add(void *ctx, void *acc, const void *partial) {
+    const MatrixReduceTask *task = ctx;
+    simd_kernels()->add(acc, partial, acc, task->value_len);
+}
+
+// y += (A[begin:end] - center)^T x[begin:end], four rows per sweep over y.
+// Rows are centered as they are read, so a large column offset never
+// enters the sum to cancel against later.
+static void gemv_t_rows(void *ctx, int begin, int end, void *partial) {
+    const MatrixReduceTask *task = ctx;
+    const Matrix *a = task->a;
+    const double *x = task->x;
+    const double *restrict c = task->center;
+    double *restrict y = partial;
+    int n = a->cols, i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const double *restrict a0 = matrix_row(a, i), *restrict a1 = matrix_row(a, i + 1);
+        const double *restrict a2 = matrix_row(a, i + 2), *restrict a3 = matrix_row(a, i + 3);
+        double x0 = x[i], x1 = x[i + 1], x2 = x[i + 2], x3 = x[i + 3];
+        if (c) {
+            for (int j = 0; j < n; j++) {
+                y[j] += x0 * (a0[j] - c[j]) + x1 * (a1[j] - c[j]) + x2 * (a2[j] - c[j]) + x3 * (a3[j] - c[j]);
+            }
+        } else {
+            for (int j = 0; j < n; j++) y[j] += x0 * a0[j] + x1 * a1[j] + x2 * a2[j] + x3 * a3[j];
         }
     }
-    return ML_SUCCESS;
+    for (; i < end; i++) {
+        const double *restrict ai = matrix_row(a, i);
+        double xi = x[i];
+        if (c) {
+            for (int j = 0; j < n; j++) y[j] += xi * (ai[j] - c[j]);
+        } else {
+            for (int j = 0; j < n; j++) y[j] += xi * ai[j];
+        }
+    }
+}
+
+ml_error_t matrix_gemv_t(const Matrix *a, const double *center, const double *x, double *y, ThreadPool *pool) {
+    ML_CHECK_NULL(a);
+    ML_CHECK_NULL(x);
+    ML_CHECK_NULL(y);
+    if (!matrix_is_valid(a)) return ML_ERROR_INVALID_PARAMETER;
+    MatrixReduceTask task = { .a = a, .x = x, .center = center, .value_len = a->cols };
+    return parallel_reduce(pool, a->rows, matrix_reduce_grain(a->rows, a->cols * sizeof(double)),
+                           a->cols * sizeof(double), gemv_t_rows, matrix_reduce_add, &task, y);
+}
+
+// Upper triangle of G += B^T B for B = A[begin:end] - center, one block
+// of rows at a time
+static void syrk_rows(void *ctx, int begin, int end, void *partial) {
+    MatrixReduceTask *task = ctx;
+    const Matrix *a = task->a;
+    int d = a->cols;
+    double *G = partial;
+    Arena *scratch = arena_thread_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    double *block = arena_alloc(scratch, (size_t)SYRK_BLOCK_ROWS * d * sizeof(double));
+    if (!block) {
+        __atomic_store_n(&task->failed, true, __ATOMIC_RELAXED);
+        arena_release(scratch, mark);
+        return;
+    }
+
+    for (int i0 = begin; i0 < end; i0 += SYRK_BLOCK_ROWS) {
+        int rows = gemm_min(SYRK_BLOCK_ROWS, end - i0);
+        for (int r = 0; r < rows; r++) {
+            const double *src = matrix_row(a, i0 + r);
+            double *dst = block + (size_t)r * d;
+            if (task->center) {
+                simd_kernels()->sub(src, task->center, dst, d);
+            } else {
+                memcpy(dst, src, d * sizeof(double));
+            }
+        }
+        // Only l >= j: half the multiply-adds of a full A^T A product
+        for (int j = 0; j < d; j++) {
+            double *restrict g = G + (size_t)j * d;
+            for (int r = 0; r < rows; r++) {
+                const double *restrict b = block + (size_t)r * d;
+                double bj = b[j];
+                for (int l = j; l < d; l++) g[l] += bj * b[l];
+            }
+        }
+    }
+    arena_release(scratch, mark);
+}
+
+ml_error_t matrix_syrk(const Matrix *a, const double *center, Matrix *result, ThreadPool *pool) {
+    ML_CHECK_NULL(a);
+    ML_CHECK_NULL(result);
+    if (!matrix_is_valid(a)) return ML_ERROR_INVALID_PARAMETER;
+    int d = a->cols;
+    if (result->rows != d || result->cols != d) return ML_ERROR_DIMENSION_MISMATCH;
+
+    size_t value_bytes = (size_t)d * d * sizeof(double);
+    double *G = matrix_is_contiguous(result) ? result->data : malloc(value_bytes);
+    if (!G) return ML_ERROR_MEMORY_ALLOCATION;
+    MatrixReduceTask task = { .a = a, .center = center, .value_len = d * d };
+    ml_error_t err = parallel_reduce(pool, a->rows, matrix_reduce_grain(a->rows, value_bytes), value_bytes,
+                                     syrk_rows, matrix_reduce_add, &task, G);
+    if (err == ML_SUCCESS && task.failed) err = ML_ERROR_MEMORY_ALLOCATION;
+    if (err == ML_SUCCESS) {
+        for (int j = 0; j < d; j++) {
+            for (int l = j + 1; l < d; l++) G[(size_t)l * d + j] = G[(size_t)j * d + l];
+        }
+        if (G != result->data) {
+            for (int j = 0; j < d; j++) memcpy(matrix_row(result, j), G + (size_t)j * d, d * sizeof(double));
+        }
+    }
+    if (G != result->data) free(G);
+    return err;
 }
 
 ml_error_t matrix_hadamard(const Matrix *a, const Matrix *b, Matrix *result) {
@@ -227,10 +663,7 @@ ml_error_t matrix_hadamard(const Matrix *a, const Matrix *b, Matrix *result) {
         return ML_ERROR_DIMENSION_MISMATCH;
     }
     
-    int size = a->rows * a->cols;
-    for (int i = 0; i < size; i++) {
-        result->data[i] = a->data[i] * b->data[i];
-    }
+    matrix_apply_binary(simd_kernels()->mul, a, b, result);
     return ML_SUCCESS;
 }
 
@@ -239,10 +672,20 @@ double matrix_dot_product(const Matrix *a, const Matrix *b) {
     if (!matrix_is_valid(a) || !matrix_is_valid(b)) return NAN;
     if (a->rows * a->cols != b->rows * b->cols) return NAN;
     
+    const simd_kernels_t *simd = simd_kernels();
+    if (matrix_is_contiguous(a) && matrix_is_contiguous(b)) {
+        return simd->dot(a->data, b->data, a->rows * a->cols);
+    }
     double sum = 0.0;
-    int size = a->rows * a->cols;
-    for (int i = 0; i < size; i++) {
-        sum += a->data[i] * b->data[i];
+    if (a->cols == b->cols) {
+        for (int i = 0; i < a->rows; i++) {
+            sum += simd->dot(matrix_row(a, i), matrix_row(b, i), a->cols);
+        }
+        return sum;
+    }
+    // Differently shaped views of the same length (row vs column vector)
+    for (int idx = 0; idx < a->rows * a->cols; idx++) {
+        sum += matrix_row(a, idx / a->cols)[idx % a->cols] * matrix_row(b, idx / b->cols)[idx % b->cols];
     }
     return sum;
 }
@@ -255,10 +698,13 @@ double matrix_norm(const Matrix *m) {
 double matrix_norm_squared(const Matrix *m) {
     if (!matrix_is_valid(m)) return NAN;
     
+    const simd_kernels_t *simd = simd_kernels();
+    if (matrix_is_contiguous(m)) {
+        return simd->sum_sq(m->data, m->rows * m->cols);
+    }
     double sum = 0.0;
-    int size = m->rows * m->cols;
-    for (int i = 0; i < size; i++) {
-        sum += m->data[i] * m->data[i];
+    for (int i = 0; i < m->rows; i++) {
+        sum += simd->sum_sq(matrix_row(m, i), m->cols);
     }
     return sum;
 }
@@ -279,11 +725,13 @@ double matrix_mean(const Matrix *m) {
     if (!matrix_is_valid(m)) return NAN;
     
     double sum = 0.0;
-    int size = m->rows * m->cols;
-    for (int i = 0; i < size; i++) {
-        sum += m->data[i];
+    for (int i = 0; i < m->rows; i++) {
+        const double *row = matrix_row(m, i);
+        for (int j = 0; j < m->cols; j++) {
+            sum += row[j];
+        }
     }
-    return sum / size;
+    return sum / ((double)m->rows * m->cols);
 }
 
 double matrix_std(const Matrix *m) {
@@ -291,40 +739,42 @@ double matrix_std(const Matrix *m) {
     
     double mean = matrix_mean(m);
     double sum_sq_diff = 0.0;
-    int size = m->rows * m->cols;
     
-    for (int i = 0; i < size; i++) {
-        double diff = m->data[i] - mean;
-        sum_sq_diff += diff * diff;
+    for (int i = 0; i < m->rows; i++) {
+        const double *row = matrix_row(m, i);
+        for (int j = 0; j < m->cols; j++) {
+            double diff = row[j] - mean;
+            sum_sq_diff += diff * diff;
+        }
     }
     
-    return sqrt(sum_sq_diff / size);
+    return sqrt(sum_sq_diff / ((double)m->rows * m->cols));
 }
 
 double matrix_min(const Matrix *m) {
     if (!matrix_is_valid(m)) return NAN;
     
-    double min_val = m->data[0];
-    int size = m->rows * m->cols;
-    for (int i = 1; i < size; i++) {
-        if (m->data[i] < min_val) {
-            min_val = m->data[i];
-        }
+    const simd_kernels_t *simd = simd_kernels();
+    if (matrix_is_contiguous(m)) return simd->min(m->data, m->rows * m->cols);
+    double result = simd->min(m->data, m->cols);
+    for (int i = 1; i < m->rows; i++) {
+        double row_min = simd->min(matrix_row(m, i), m->cols);
+        if (row_min < result) result = row_min;
     }
-    return min_val;
+    return result;
 }
 
 double matrix_max(const Matrix *m) {
     if (!matrix_is_valid(m)) return NAN;
     
-    double max_val = m->data[0];
-    int size = m->rows * m->cols;
-    for (int i = 1; i < size; i++) {
-        if (m->data[i] > max_val) {
-            max_val = m->data[i];
-        }
+    const simd_kernels_t *simd = simd_kernels();
+    if (matrix_is_contiguous(m)) return simd->max(m->data, m->rows * m->cols);
+    double result = simd->max(m->data, m->cols);
+    for (int i = 1; i < m->rows; i++) {
+        double row_max = simd->max(matrix_row(m, i), m->cols);
+        if (row_max > result) result = row_max;
     }
-    return max_val;
+    return result;
 }
 
 // Utility functions
@@ -338,7 +788,7 @@ void matrix_print(const Matrix *m) {
     for (int i = 0; i < m->rows; i++) {
         printf("[");
         for (int j = 0; j < m->cols; j++) {
-            printf("%8.4f", m->data[i * m->cols + j]);
+            printf("%8.4f", matrix_row(m, i)[j]);
             if (j < m->cols - 1) printf(", ");
         }
         printf("]\n");
@@ -356,9 +806,13 @@ void matrix_print_shape(const Matrix *m) {
 ml_error_t matrix_fill(Matrix *m, double value) {
     ML_CHECK_NULL(m);
     
-    int size = m->rows * m->cols;
-    for (int i = 0; i < size; i++) {
-        m->data[i] = value;
+    const simd_kernels_t *simd = simd_kernels();
+    if (matrix_is_contiguous(m)) {
+        simd->fill(m->data, value, m->rows * m->cols);
+        return ML_SUCCESS;
+    }
+    for (int i = 0; i < m->rows; i++) {
+        simd->fill(matrix_row(m, i), value, m->cols);
     }
     return ML_SUCCESS;
 }
@@ -371,10 +825,12 @@ ml_error_t matrix_fill_random(Matrix *m, double min_val, double max_val) {
     }
     
     double range = max_val - min_val;
-    int size = m->rows * m->cols;
     
-    for (int i = 0; i < size; i++) {
-        m->data[i] = min_val + (double)rand() / RAND_MAX * range;
+    for (int i = 0; i < m->rows; i++) {
+        double *row = matrix_row(m, i);
+        for (int j = 0; j < m->cols; j++) {
+            row[j] = min_val + (double)rand() / RAND_MAX * range;
+        }
     }
     return ML_SUCCESS;
 }
@@ -388,7 +844,7 @@ ml_error_t matrix_get_row(const Matrix *m, int row, Matrix *result) {
         return ML_ERROR_INVALID_PARAMETER;
     }
     
-    memcpy(result->data, m->data + row * m->cols, m->cols * sizeof(double));
+    memcpy(result->data, matrix_row(m, row), m->cols * sizeof(double));
     return ML_SUCCESS;
 }
 
@@ -401,7 +857,7 @@ ml_error_t matrix_get_col(const Matrix *m, int col, Matrix *result) {
     }
     
     for (int i = 0; i < m->rows; i++) {
-        result->data[i] = m->data[i * m->cols + col];
+        matrix_row(result, i)[0] = matrix_row(m, i)[col];
     }
     return ML_SUCCESS;
 }
\ No newline at end of file
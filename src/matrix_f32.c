@@ -0,0 +1,146 @@
+#include "matrix_f32.h"
+#include "simd.h"
+
+#define MATRIX_F32_HEADER_SIZE ((sizeof(MatrixF32) + ML_ALIGNMENT - 1) / ML_ALIGNMENT * ML_ALIGNMENT)
+
+MatrixF32* matrix_f32_create(int rows, int cols) {
+    if (rows <= 0 || cols <= 0) return NULL;
+
+    size_t data_bytes = (size_t)rows * cols * sizeof(float);
+    void *mem = NULL;
+    if (posix_memalign(&mem, ML_ALIGNMENT, MATRIX_F32_HEADER_SIZE + data_bytes) != 0) return NULL;
+
+    // Header and data share the allocation, data on its own cache line
+    MatrixF32 *m = mem;
+    m->data = (float*)((char*)m + MATRIX_F32_HEADER_SIZE);
+    m->rows = rows;
+    m->cols = cols;
+    m->stride = cols;
+    m->is_view = false;
+    memset(m->data, 0, data_bytes);
+    return m;
+}
+
+MatrixF32* matrix_f32_from_matrix(const Matrix *m) {
+    if (!matrix_is_valid(m)) return NULL;
+    MatrixF32 *out = matrix_f32_create(m->rows, m->cols);
+    if (!out) return NULL;
+    for (int i = 0; i < m->rows; i++) {
+        const double *in = matrix_row(m, i);
+        float *row = matrix_f32_row(out, i);
+        for (int j = 0; j < m->cols; j++) row[j] = (float)in[j];
+    }
+    return out;
+}
+
+MatrixF32* matrix_f32_view(MatrixF32 *src, int start_row, int start_col, int rows, int cols) {
+    if (!src || rows <= 0 || cols <= 0 || start_row < 0 || start_col < 0 ||
+        start_row + rows > src->rows || start_col + cols > src->cols) {
+        return NULL;
+    }
+    MatrixF32 *view = malloc(sizeof(MatrixF32));
+    if (!view) return NULL;
+    view->data = matrix_f32_row(src, start_row) + start_col;
+    view->rows = rows;
+    view->cols = cols;
+    view->stride = src->stride;
+    view->is_view = true;
+    return view;
+}
+
+Matrix* matrix_f32_to_matrix(const MatrixF32 *m) {
+    if (!m) return NULL;
+    Matrix *out = matrix_create(m->rows, m->cols);
+    if (!out) return NULL;
+    for (int i = 0; i < m->rows; i++) {
+        const float *in = matrix_f32_row(m, i);
+        double *row = matrix_row(out, i);
+        for (int j = 0; j < m->cols; j++) row[j] = in[j];
+    }
+    return out;
+}
+
+void matrix_f32_free(MatrixF32 *m) {
+    // Owned data lives in the header's allocation, so one free covers both
+    free(m);
+}
+
+// Single-precision GEMM. Each row of C accumulates rows of B scaled by
+// A's entries (i-k-j), with K blocked so the active rows of B stay in
+// cache across rows of A. Simpler than the double-precision packed GEMM;
+// this is meant for scoring batches against small parameter matrices.
+#define GEMM_F32_KC 256
+#define GEMM_F32_NC 4096
+
+ml_error_t matrix_f32_multiply(const MatrixF32 *a, const MatrixF32 *b, MatrixF32 *result) {
+    ML_CHECK_NULL(a);
+    ML_CHECK_NULL(b);
+    ML_CHECK_NULL(result);
+    if (a->cols != b->rows || result->rows != a->rows || result->cols != b->cols) {
+        return ML_ERROR_DIMENSION_MISMATCH;
+    }
+
+    const simd_kernels_t *simd = simd_kernels();
+    int m = a->rows, n = b->cols, k = a->cols;
+    for (int i = 0; i < m; i++) memset(matrix_f32_row(result, i), 0, n * sizeof(float));
+
+    for (int jc = 0; jc < n; jc += GEMM_F32_NC) {
+        int nc = n - jc < GEMM_F32_NC ? n - jc : GEMM_F32_NC;
+        for (int pc = 0; pc < k; pc += GEMM_F32_KC) {
+            int kc = k - pc < GEMM_F32_KC ? k - pc : GEMM_F32_KC;
+            for (int i = 0; i < m; i++) {
+                const float *a_row = matrix_f32_row(a, i) + pc;
+                float *c_row = matrix_f32_row(result, i) + jc;
+                for (int p = 0; p < kc; p++) {
+                    simd->axpy_f32(a_row[p], matrix_f32_row(b, pc + p) + jc, c_row, nc);
+                }
+            }
+        }
+    }
+    return ML_SUCCESS;
+}
+
+MatrixQ8* matrix_q8_quantize(const Matrix *m) {
+    if (!matrix_is_valid(m)) return NULL;
+    MatrixQ8 *q = malloc(sizeof(MatrixQ8));
+    if (!q) return NULL;
+    q->data = malloc((size_t)m->rows * m->cols);
+    q->scales = malloc(m->rows * sizeof(float));
+    q->rows = m->rows;
+    q->cols = m->cols;
+    if (!q->data || !q->scales) {
+        matrix_q8_free(q);
+        return NULL;
+    }
+
+    const simd_kernels_t *simd = simd_kernels();
+    for (int i = 0; i < m->rows; i++) {
+        const double *row = matrix_row(m, i);
+        double max_abs = fmax(fabs(simd->min(row, m->cols)), fabs(simd->max(row, m->cols)));
+        double scale = max_abs > 0 ? max_abs / 127.0 : 1.0;
+        int8_t *out = q->data + (size_t)i * m->cols;
+        for (int j = 0; j < m->cols; j++) out[j] = (int8_t)lrint(row[j] / scale);
+        q->scales[i] = (float)scale;
+    }
+    return q;
+}
+
+Matrix* matrix_q8_dequantize(const MatrixQ8 *q) {
+    if (!q) return NULL;
+    Matrix *m = matrix_create(q->rows, q->cols);
+    if (!m) return NULL;
+    for (int i = 0; i < q->rows; i++) {
+        const int8_t *in = q->data + (size_t)i * q->cols;
+        double *row = matrix_row(m, i);
+        for (int j = 0; j < q->cols; j++) row[j] = (double)q->scales[i] * in[j];
+    }
+    return m;
+}
+
+void matrix_q8_free(MatrixQ8 *q) {
+    if (q) {
+        free(q->data);
+        free(q->scales);
+        free(q);
+    }
+}
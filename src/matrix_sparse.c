@@ -0,0 +1,124 @@
+#include "matrix_sparse.h"
+#include "profile.h"
+
+SparseMatrix* sparse_create(int rows, int cols, size_t nnz) {
+    if (rows <= 0 || cols <= 0) return NULL;
+    // malloc(0) may return NULL, so always ask for at least one slot
+    double *values = malloc((nnz ? nnz : 1) * sizeof(double));
+    int *col_idx = malloc((nnz ? nnz : 1) * sizeof(int));
+    size_t *row_ptr = calloc((size_t)rows + 1, sizeof(size_t));
+    SparseMatrix *s = malloc(sizeof(SparseMatrix));
+    if (!values || !col_idx || !row_ptr || !s) {
+        free(values);
+        free(col_idx);
+        free(row_ptr);
+        free(s);
+        return NULL;
+    }
+    ML_PROFILE_COUNT(ML_COUNTER_ALLOCATIONS, 1);
+    *s = (SparseMatrix){ values, col_idx, row_ptr, rows, cols, nnz };
+    return s;
+}
+
+SparseMatrix* sparse_create_from_arrays(double *values, int *col_idx, size_t *row_ptr, int rows, int cols) {
+    if (!values || !col_idx || !row_ptr || rows <= 0 || cols <= 0) return NULL;
+    SparseMatrix *s = malloc(sizeof(SparseMatrix));
+    if (!s) return NULL;
+    *s = (SparseMatrix){ values, col_idx, row_ptr, rows, cols, row_ptr[rows] };
+    return s;
+}
+
+SparseMatrix* sparse_from_dense(const Matrix *m) {
+    if (!matrix_is_valid(m)) return NULL;
+    size_t nnz = 0;
+    for (int i = 0; i < m->rows; i++) {
+        const double *row = matrix_row(m, i);
+        for (int j = 0; j < m->cols; j++) nnz += row[j] != 0.0;
+    }
+
+    SparseMatrix *s = sparse_create(m->rows, m->cols, nnz);
+    if (!s) return NULL;
+    size_t p = 0;
+    for (int i = 0; i < m->rows; i++) {
+        const double *row = matrix_row(m, i);
+        for (int j = 0; j < m->cols; j++) {
+            if (row[j] != 0.0) {
+                s->values[p] = row[j];
+                s->col_idx[p++] = j;
+            }
+        }
+        s->row_ptr[i + 1] = p;
+    }
+    return s;
+}
+
+Matrix* sparse_to_dense(const SparseMatrix *s) {
+    if (!s) return NULL;
+    Matrix *m = matrix_create(s->rows, s->cols);
+    if (!m) return NULL;
+    for (int i = 0; i < s->rows; i++) {
+        double *row = matrix_row(m, i);
+        for (size_t p = s->row_ptr[i]; p < s->row_ptr[i + 1]; p++) row[s->col_idx[p]] += s->values[p];
+    }
+    return m;
+}
+
+void sparse_free(SparseMatrix *s) {
+    if (s) {
+        free(s->values);
+        free(s->col_idx);
+        free(s->row_ptr);
+        free(s);
+    }
+}
+
+bool sparse_is_valid(const SparseMatrix *s) {
+    if (!s || !s->values || !s->col_idx || !s->row_ptr || s->rows <= 0 || s->cols <= 0) return false;
+    if (s->row_ptr[0] != 0 || s->row_ptr[s->rows] != s->nnz) return false;
+    for (int i = 0; i < s->rows; i++) {
+        if (s->row_ptr[i + 1] < s->row_ptr[i]) return false;
+        int prev = -1;
+        for (size_t p = s->row_ptr[i]; p < s->row_ptr[i + 1]; p++) {
+            if (s->col_idx[p] <= prev || s->col_idx[p] >= s->cols) return false;
+            prev = s->col_idx[p];
+        }
+    }
+    return true;
+}
+
+double sparse_density(const SparseMatrix *s) {
+    if (!s || s->rows <= 0 || s->cols <= 0) return 0.0;
+    return (double)s->nnz / ((double)s->rows * s->cols);
+}
+
+ml_error_t sparse_multiply_dense(const SparseMatrix *a, const Matrix *b, Matrix *result) {
+    ML_CHECK_NULL(a);
+    ML_CHECK_NULL(b);
+    ML_CHECK_NULL(result);
+    if (a->cols != b->rows || result->rows != a->rows || result->cols != b->cols) {
+        return ML_ERROR_DIMENSION_MISMATCH;
+    }
+
+    int n = b->cols;
+    for (int i = 0; i < a->rows; i++) {
+        double *restrict out = matrix_row(result, i);
+        memset(out, 0, n * sizeof(double));
+        for (size_t p = a->row_ptr[i]; p < a->row_ptr[i + 1]; p++) {
+            double alpha = a->values[p];
+            const double *restrict in = matrix_row(b, a->col_idx[p]);
+            for (int j = 0; j < n; j++) out[j] += alpha * in[j];
+        }
+    }
+    return ML_SUCCESS;
+}
+
+ml_error_t sparse_row_sq_norms(const SparseMatrix *s, double *norms) {
+    ML_CHECK_NULL(s);
+    ML_CHECK_NULL(norms);
+    for (int i = 0; i < s->rows; i++) {
+        double sum = 0.0;
+        for (size_t p = s->row_ptr[i]; p < s->row_ptr[i + 1]; p++) sum += s->values[p] * s->values[p];
+        norms[i] = sum;
+    }
+    return ML_SUCCESS;
+}
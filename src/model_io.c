@@ -0,0 +1,208 @@
+#include "model_io.h"
+#include "atomic_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MODEL_FILE_MAGIC "MLMODEL1"
+#define MODEL_FILE_VERSION 1
+#define MODEL_FILE_ENDIAN_TAG 0x01020304u
+#define MODEL_FILE_DTYPE_FLOAT64 1
+#define MODEL_FILE_ALIGN 64
+
+typedef struct {
+    uint64_t offset;  // 0 for an empty section
+    uint64_t rows;
+    uint64_t cols;
+} ModelFileSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;        // reads back differently on a foreign byte order
+    uint32_t model_type;
+    uint32_t dtype;
+    uint64_t file_size;
+    uint32_t n_sections;
+    uint32_t reserved;
+    ModelFileSection sections[MODEL_FILE_MAX_SECTIONS];
+    int64_t ints[MODEL_FILE_MAX_PARAMS];
+    double reals[MODEL_FILE_MAX_PARAMS];
+    uint64_t reserved2[5];
+    uint64_t payload_checksum;  // every section in order
+    uint64_t header_checksum;   // every byte before this field
+} ModelFileHeader;
+
+_Static_assert(sizeof(ModelFileHeader) == 384, "model file header must stay 384 bytes");
+
+// FNV-1a over 64-bit words, as in the binary dataset format
+static uint64_t model_file_checksum(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *p = data;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ULL;
+    }
+    for (; i < len; i++) hash = (hash ^ p[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+#define MODEL_FILE_CHECKSUM_SEED 0xCBF29CE484222325ULL
+
+static uint64_t model_file_align(uint64_t offset) {
+    return (offset + MODEL_FILE_ALIGN - 1) / MODEL_FILE_ALIGN * MODEL_FILE_ALIGN;
+}
+
+ml_error_t model_file_save(const char *filename, model_file_type_t type, const ModelParams *params,
+                           const Matrix *const *sections, int n_sections) {
+    ML_CHECK_NULL(filename);
+    ML_CHECK_NULL(params);
+    if (n_sections < 0 || n_sections > MODEL_FILE_MAX_SECTIONS || (n_sections && !sections)) {
+        return ML_ERROR_INVALID_PARAMETER;
+    }
+
+    ModelFileHeader header = {0};
+    memcpy(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic));
+    header.version = MODEL_FILE_VERSION;
+    header.endian_tag = MODEL_FILE_ENDIAN_TAG;
+    header.model_type = type;
+    header.dtype = MODEL_FILE_DTYPE_FLOAT64;
+    header.n_sections = n_sections;
+    memcpy(header.ints, params->ints, sizeof(header.ints));
+    memcpy(header.reals, params->reals, sizeof(header.reals));
+
+    // Rows are hashed one at a time so strided views need no compacting copy
+    uint64_t offset = model_file_align(sizeof(header));
+    uint64_t checksum = MODEL_FILE_CHECKSUM_SEED;
+    for (int s = 0; s < n_sections; s++) {
+        const Matrix *m = sections[s];
+        if (!m) continue;
+        if (!matrix_is_valid(m)) return ML_ERROR_INVALID_DATA;
+        header.sections[s] = (ModelFileSection){ offset, (uint64_t)m->rows, (uint64_t)m->cols };
+        for (int i = 0; i < m->rows; i++) {
+            checksum = model_file_checksum(checksum, matrix_row(m, i), m->cols * sizeof(double));
+        }
+        offset = model_file_align(offset + (uint64_t)m->rows * m->cols * sizeof(double));
+    }
+    header.file_size = offset;
+    header.payload_checksum = checksum;
+    header.header_checksum = model_file_checksum(MODEL_FILE_CHECKSUM_SEED, &header,
+                                                 offsetof(ModelFileHeader, header_checksum));
+
+    AtomicFile out;
+    ml_error_t err = atomic_file_open(&out, filename);
+    if (err != ML_SUCCESS) return err;
+    FILE *file = out.file;
+    static const char zeros[MODEL_FILE_ALIGN] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t written = sizeof(header);
+    for (int s = 0; ok && s < n_sections; s++) {
+        const Matrix *m = sections[s];
+        if (!m) continue;
+        ok = fwrite(zeros, 1, header.sections[s].offset - written, file) == header.sections[s].offset - written;
+        for (int i = 0; ok && i < m->rows; i++) {
+            ok = fwrite(matrix_row(m, i), sizeof(double), m->cols, file) == (size_t)m->cols;
+        }
+        written = header.sections[s].offset + (uint64_t)m->rows * m->cols * sizeof(double);
+    }
+    if (ok) ok = fwrite(zeros, 1, header.file_size - written, file) == header.file_size - written;
+    return atomic_file_commit(&out, ok);
+}
+
+static bool model_file_header_is_valid(const ModelFileHeader *h, model_file_type_t type, size_t file_size) {
+    if (memcmp(h->magic, MODEL_FILE_MAGIC, sizeof(h->magic)) != 0) return false;
+    if (h->version != MODEL_FILE_VERSION || h->endian_tag != MODEL_FILE_ENDIAN_TAG) return false;
+    if (h->model_type != (uint32_t)type || h->dtype != MODEL_FILE_DTYPE_FLOAT64) return false;
+    if (h->header_checksum != model_file_checksum(MODEL_FILE_CHECKSUM_SEED, h,
+                                                  offsetof(ModelFileHeader, header_checksum))) return false;
+    if (h->file_size != file_size || h->n_sections > MODEL_FILE_MAX_SECTIONS) return false;
+
+    // Sections must be aligned and lie inside the file in order, without overflow
+    uint64_t end = sizeof(*h);
+    for (uint32_t s = 0; s < h->n_sections; s++) {
+        const ModelFileSection *sec = &h->sections[s];
+        if (sec->offset == 0) continue;
+        if (sec->offset % MODEL_FILE_ALIGN || sec->offset < end) return false;
+        if (sec->rows == 0 || sec->rows > INT32_MAX || sec->cols == 0 || sec->cols > INT32_MAX) return false;
+        if (sec->cols > file_size / sizeof(double) / sec->rows) return false;
+        uint64_t bytes = sec->rows * sec->cols * sizeof(double);
+        if (bytes > file_size || sec->offset > file_size - bytes) return false;
+        end = sec->offset + bytes;
+    }
+    return true;
+}
+
+ml_error_t model_file_open(const char *filename, model_file_type_t type, bool verify_checksum, ModelFile *file) {
+    ML_CHECK_NULL(filename);
+    ML_CHECK_NULL(file);
+    memset(file, 0, sizeof(*file));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return ML_ERROR_FILE_IO;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ModelFileHeader)) {
+        close(fd);
+        return ML_ERROR_INVALID_DATA;
+    }
+    size_t size = (size_t)st.st_size;
+
+    // Private writable mapping: pages stay shared with every other process
+    // that maps the file until someone refits the model, which copies on write
+    char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return ML_ERROR_FILE_IO;
+    file->mapping = map;
+    file->mapping_size = size;
+
+    const ModelFileHeader *h = (const ModelFileHeader*)map;
+    if (!model_file_header_is_valid(h, type, size)) {
+        model_file_close(file);
+        return ML_ERROR_INVALID_DATA;
+    }
+    if (verify_checksum) {
+        uint64_t checksum = MODEL_FILE_CHECKSUM_SEED;
+        for (uint32_t s = 0; s < h->n_sections; s++) {
+            const ModelFileSection *sec = &h->sections[s];
+            if (sec->offset) checksum = model_file_checksum(checksum, map + sec->offset,
+                                                            sec->rows * sec->cols * sizeof(double));
+        }
+        if (checksum != h->payload_checksum) {
+            model_file_close(file);
+            return ML_ERROR_INVALID_DATA;
+        }
+    }
+
+    memcpy(file->params.ints, h->ints, sizeof(h->ints));
+    memcpy(file->params.reals, h->reals, sizeof(h->reals));
+    file->n_sections = (int)h->n_sections;
+    for (int s = 0; s < file->n_sections; s++) {
+        const ModelFileSection *sec = &h->sections[s];
+        if (!sec->offset) continue;
+        file->sections[s] = matrix_view_buffer((double*)(map + sec->offset), (int)sec->rows, (int)sec->cols);
+        if (!file->sections[s]) {
+            model_file_close(file);
+            return ML_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+    return ML_SUCCESS;
+}
+
+void model_file_close(ModelFile *file) {
+    if (!file) return;
+    for (int s = 0; s < MODEL_FILE_MAX_SECTIONS; s++) {
+        matrix_free(file->sections[s]);
+        file->sections[s] = NULL;
+    }
+    model_file_unmap(file->mapping, file->mapping_size);
+    file->mapping = NULL;
+    file->mapping_size = 0;
+}
+
+void model_file_unmap(void *mapping, size_t size) {
+    if (mapping) munmap(mapping, size);
+}
@@ -0,0 +1,260 @@
+#include "profile.h"
+#include <pthread.h>
+#include <time.h>
+
+static const char *profile_phase_names[ML_PHASE_COUNT] = {
+    "kmeans.init", "kmeans.assign", "kmeans.update", "kmeans.converge", "kmeans.predict",
+    "linreg.gradient", "linreg.update", "linreg.solve", "linreg.predict",
+    "csv.scan", "csv.parse", "csv.stitch",
+};
+
+static const char *profile_counter_names[ML_COUNTER_COUNT] = {
+    "distances", "bytes_parsed", "allocations",
+};
+
+const char* profile_phase_name(ml_phase_t phase) {
+    return (unsigned)phase < ML_PHASE_COUNT ? profile_phase_names[phase] : "unknown";
+}
+
+const char* profile_counter_name(ml_counter_t counter) {
+    return (unsigned)counter < ML_COUNTER_COUNT ? profile_counter_names[counter] : "unknown";
+}
+
+uint64_t profile_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef ML_PROFILE
+
+// Trace events beyond this are dropped (and counted) rather than grown
+// without bound in long runs
+#define PROFILE_TRACE_MAX_EVENTS (1 << 22)
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int phase;
+    int thread;
+} ProfileTraceEvent;
+
+_Thread_local uint64_t profile_local_counts[ML_COUNTER_COUNT];
+static _Thread_local int profile_thread_index = -1;
+static int profile_next_thread_index = 0;
+
+static uint64_t profile_calls[ML_PHASE_COUNT];
+static uint64_t profile_total_ns[ML_PHASE_COUNT];
+static uint64_t profile_max_ns[ML_PHASE_COUNT];
+static uint64_t profile_counts[ML_COUNTER_COUNT];
+
+static pthread_mutex_t profile_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool profile_tracing = false;
+static char *profile_trace_path = NULL;
+static ProfileTraceEvent *profile_trace_events = NULL;
+static size_t profile_trace_count = 0;
+static size_t profile_trace_capacity = 0;
+static uint64_t profile_trace_dropped = 0;
+static uint64_t profile_trace_origin = 0;
+
+bool profile_enabled(void) {
+    return true;
+}
+
+void profile_flush(void) {
+    for (int c = 0; c < ML_COUNTER_COUNT; c++) {
+        if (profile_local_counts[c]) {
+            __atomic_fetch_add(&profile_counts[c], profile_local_counts[c], __ATOMIC_RELAXED);
+            profile_local_counts[c] = 0;
+        }
+    }
+}
+
+static void profile_trace_record(ml_phase_t phase, uint64_t start_ns, uint64_t duration_ns) {
+    if (profile_thread_index < 0) {
+        profile_thread_index = __atomic_fetch_add(&profile_next_thread_index, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_lock(&profile_trace_lock);
+    if (profile_tracing) {
+        if (profile_trace_count == profile_trace_capacity && profile_trace_capacity < PROFILE_TRACE_MAX_EVENTS) {
+            size_t capacity = profile_trace_capacity ? profile_trace_capacity * 2 : 1024;
+            ProfileTraceEvent *events = realloc(profile_trace_events, capacity * sizeof(ProfileTraceEvent));
+            if (events) {
+                profile_trace_events = events;
+                profile_trace_capacity = capacity;
+            }
+        }
+        if (profile_trace_count < profile_trace_capacity) {
+            profile_trace_events[profile_trace_count++] = (ProfileTraceEvent){
+                start_ns, duration_ns, (int)phase, profile_thread_index
+            };
+        } else {
+            profile_trace_dropped++;
+        }
+    }
+    pthread_mutex_unlock(&profile_trace_lock);
+}
+
+void profile_end(ml_phase_t phase, uint64_t start_ns) {
+    uint64_t duration = profile_now_ns() - start_ns;
+    __atomic_fetch_add(&profile_calls[phase], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&profile_total_ns[phase], duration, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&profile_max_ns[phase], __ATOMIC_RELAXED);
+    while (duration > max &&
+           !__atomic_compare_exchange_n(&profile_max_ns[phase], &max, duration, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    profile_flush();
+    if (__atomic_load_n(&profile_tracing, __ATOMIC_RELAXED)) {
+        profile_trace_record(phase, start_ns, duration);
+    }
+}
+
+void profile_reset(void) {
+    profile_flush();
+    for (int p = 0; p < ML_PHASE_COUNT; p++) {
+        __atomic_store_n(&profile_calls[p], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&profile_total_ns[p], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&profile_max_ns[p], 0, __ATOMIC_RELAXED);
+    }
+    for (int c = 0; c < ML_COUNTER_COUNT; c++) {
+        __atomic_store_n(&profile_counts[c], 0, __ATOMIC_RELAXED);
+    }
+}
+
+ProfilePhaseStats profile_phase(ml_phase_t phase) {
+    ProfilePhaseStats stats = {0};
+    if ((unsigned)phase >= ML_PHASE_COUNT) return stats;
+    stats.calls = __atomic_load_n(&profile_calls[phase], __ATOMIC_RELAXED);
+    stats.total_ns = __atomic_load_n(&profile_total_ns[phase], __ATOMIC_RELAXED);
+    stats.max_ns = __atomic_load_n(&profile_max_ns[phase], __ATOMIC_RELAXED);
+    return stats;
+}
+
+uint64_t profile_counter(ml_counter_t counter) {
+    if ((unsigned)counter >= ML_COUNTER_COUNT) return 0;
+    profile_flush();
+    return __atomic_load_n(&profile_counts[counter], __ATOMIC_RELAXED);
+}
+
+ml_error_t profile_trace_start(const char *path) {
+    ML_CHECK_NULL(path);
+    char *copy = strdup(path);
+    if (!copy) return ML_ERROR_MEMORY_ALLOCATION;
+    pthread_mutex_lock(&profile_trace_lock);
+    free(profile_trace_path);
+    profile_trace_path = copy;
+    profile_trace_count = 0;
+    profile_trace_dropped = 0;
+    profile_trace_origin = profile_now_ns();
+    __atomic_store_n(&profile_tracing, true, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&profile_trace_lock);
+    return ML_SUCCESS;
+}
+
+// Chrome trace event format: complete ("X") events with microsecond
+// timestamps, the category being the phase name up to the dot
+static bool profile_trace_write(FILE *f) {
+    fprintf(f, "{\"traceEvents\": [");
+    for (size_t i = 0; i < profile_trace_count; i++) {
+        const ProfileTraceEvent *e = &profile_trace_events[i];
+        const char *name = profile_phase_names[e->phase];
+        int category_len = (int)(strchr(name, '.') - name);
+        fprintf(f, "%s\n  {\"name\": \"%s\", \"cat\": \"%.*s\", \"ph\": \"X\", \"ts\": %.3f, "
+                   "\"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                i ? "," : "", name, category_len, name,
+                (e->start_ns - profile_trace_origin) * 1e-3, e->duration_ns * 1e-3, e->thread);
+    }
+    fprintf(f, "\n], \"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": %llu",
+            (unsigned long long)profile_trace_dropped);
+    for (int c = 0; c < ML_COUNTER_COUNT; c++) {
+        fprintf(f, ", \"%s\": %llu", profile_counter_names[c],
+                (unsigned long long)__atomic_load_n(&profile_counts[c], __ATOMIC_RELAXED));
+    }
+    fprintf(f, "}}\n");
+    return !ferror(f);
+}
+
+ml_error_t profile_trace_stop(void) {
+    profile_flush();
+    pthread_mutex_lock(&profile_trace_lock);
+    if (!profile_tracing) {
+        pthread_mutex_unlock(&profile_trace_lock);
+        return ML_ERROR_INVALID_PARAMETER;
+    }
+    __atomic_store_n(&profile_tracing, false, __ATOMIC_RELAXED);
+
+    ml_error_t err = ML_SUCCESS;
+    FILE *f = fopen(profile_trace_path, "w");
+    if (!f) {
+        err = ML_ERROR_FILE_IO;
+    } else {
+        if (!profile_trace_write(f)) err = ML_ERROR_FILE_IO;
+        if (fclose(f) != 0) err = ML_ERROR_FILE_IO;
+    }
+
+    free(profile_trace_events);
+    profile_trace_events = NULL;
+    profile_trace_count = profile_trace_capacity = 0;
+    ML_SAFE_FREE(profile_trace_path);
+    pthread_mutex_unlock(&profile_trace_lock);
+    return err;
+}
+
+#else
+
+bool profile_enabled(void) {
+    return false;
+}
+
+void profile_flush(void) {
+}
+
+void profile_end(ml_phase_t phase, uint64_t start_ns) {
+    (void)phase;
+    (void)start_ns;
+}
+
+void profile_reset(void) {
+}
+
+ProfilePhaseStats profile_phase(ml_phase_t phase) {
+    (void)phase;
+    return (ProfilePhaseStats){0};
+}
+
+uint64_t profile_counter(ml_counter_t counter) {
+    (void)counter;
+    return 0;
+}
+
+ml_error_t profile_trace_start(const char *path) {
+    (void)path;
+    return ML_ERROR_NOT_IMPLEMENTED;
+}
+
+ml_error_t profile_trace_stop(void) {
+    return ML_ERROR_NOT_IMPLEMENTED;
+}
+
+#endif
+
+void profile_print(FILE *out) {
+    if (!out) return;
+    if (!profile_enabled()) {
+        fprintf(out, "profiling disabled (build with ML_PROFILE)\n");
+        return;
+    }
+    fprintf(out, "%-18s %10s %14s %12s %12s\n", "phase", "calls", "total ms", "mean us", "max us");
+    for (int p = 0; p < ML_PHASE_COUNT; p++) {
+        ProfilePhaseStats s = profile_phase((ml_phase_t)p);
+        if (s.calls == 0) continue;
+        fprintf(out, "%-18s %10llu %14.3f %12.3f %12.3f\n", profile_phase_names[p],
+                (unsigned long long)s.calls, s.total_ns * 1e-6,
+                s.total_ns * 1e-3 / s.calls, s.max_ns * 1e-3);
+    }
+    for (int c = 0; c < ML_COUNTER_COUNT; c++) {
+        fprintf(out, "%-18s %10llu\n", profile_counter_names[c],
+                (unsigned long long)profile_counter((ml_counter_t)c));
+    }
+}
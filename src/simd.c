@@ -0,0 +1,656 @@
+#include "simd.h"
+#include <pthread.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Scalar reference kernels
+static void scalar_add(const double *a, const double *b, double *out, int n) {
+    for (int i = 0; i < n; i++) out[i] = a[i] + b[i];
+}
+
+static void scalar_sub(const double *a, const double *b, double *out, int n) {
+    for (int i = 0; i < n; i++) out[i] = a[i] - b[i];
+}
+
+static void scalar_mul(const double *a, const double *b, double *out, int n) {
+    for (int i = 0; i < n; i++) out[i] = a[i] * b[i];
+}
+
+static void scalar_scale(const double *a, double scalar, double *out, int n) {
+    for (int i = 0; i < n; i++) out[i] = a[i] * scalar;
+}
+
+static void scalar_fill(double *out, double value, int n) {
+    for (int i = 0; i < n; i++) out[i] = value;
+}
+
+static double scalar_dot(const double *a, const double *b, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static double scalar_sum_sq(const double *a, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += a[i] * a[i];
+    return sum;
+}
+
+static double scalar_sq_dist(const double *a, const double *b, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        double diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static double scalar_min(const double *a, int n) {
+    double min_val = a[0];
+    for (int i = 1; i < n; i++) if (a[i] < min_val) min_val = a[i];
+    return min_val;
+}
+
+static double scalar_max(const double *a, int n) {
+    double max_val = a[0];
+    for (int i = 1; i < n; i++) if (a[i] > max_val) max_val = a[i];
+    return max_val;
+}
+
+static float scalar_dot_f32(const float *a, const float *b, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static float scalar_sq_dist_f32(const float *a, const float *b, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static void scalar_axpy_f32(float alpha, const float *x, float *y, int n) {
+    for (int i = 0; i < n; i++) y[i] += alpha * x[i];
+}
+
+static float scalar_dot_s8_f32(const int8_t *q, const float *x, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) sum += (float)q[i] * x[i];
+    return sum;
+}
+
+static const simd_kernels_t scalar_kernels = {
+    scalar_add, scalar_sub, scalar_mul, scalar_scale, scalar_fill,
+    scalar_dot, scalar_sum_sq, scalar_sq_dist, scalar_min, scalar_max,
+    scalar_dot_f32, scalar_sq_dist_f32, scalar_axpy_f32, scalar_dot_s8_f32
+};
+
+#ifdef SIMD_X86
+
+// Generates the element-wise binary kernels for one instruction set.
+// The remainder that does not fill a vector falls back to scalar code.
+#define SIMD_BINARY_OP(prefix, isa, vec, width, load, store, op, name, sop) \
+    __attribute__((target(isa))) \
+    static void prefix##_##name(const double *a, const double *b, double *out, int n) { \
+        int i = 0; \
+        for (; i + (width) <= n; i += (width)) { \
+            vec va = load(a + i), vb = load(b + i); \
+            store(out + i, op(va, vb)); \
+        } \
+        for (; i < n; i++) out[i] = a[i] sop b[i]; \
+    }
+
+// SSE2: two doubles per register
+SIMD_BINARY_OP(sse2, "sse2", __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, add, +)
+SIMD_BINARY_OP(sse2, "sse2", __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd, sub, -)
+SIMD_BINARY_OP(sse2, "sse2", __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd, mul, *)
+
+__attribute__((target("sse2")))
+static void sse2_scale(const double *a, double scalar, double *out, int n) {
+    __m128d vs = _mm_set1_pd(scalar);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), vs));
+    for (; i < n; i++) out[i] = a[i] * scalar;
+}
+
+__attribute__((target("sse2")))
+static void sse2_fill(double *out, double value, int n) {
+    __m128d vv = _mm_set1_pd(value);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, vv);
+    for (; i < n; i++) out[i] = value;
+}
+
+__attribute__((target("sse2")))
+static double sse2_hsum(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+__attribute__((target("sse2")))
+static double sse2_dot(const double *a, const double *b, int n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double sum = sse2_hsum(_mm_add_pd(acc0, acc1));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static double sse2_sum_sq(const double *a, int n) {
+    return sse2_dot(a, a, n);
+}
+
+__attribute__((target("sse2")))
+static double sse2_sq_dist(const double *a, const double *b, int n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+    }
+    double sum = sse2_hsum(_mm_add_pd(acc0, acc1));
+    for (; i < n; i++) {
+        double diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static double sse2_min(const double *a, int n) {
+    if (n < 2) return a[0];
+    __m128d acc = _mm_loadu_pd(a);
+    int i = 2;
+    for (; i + 2 <= n; i += 2) acc = _mm_min_pd(acc, _mm_loadu_pd(a + i));
+    double min_val = _mm_cvtsd_f64(_mm_min_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    for (; i < n; i++) if (a[i] < min_val) min_val = a[i];
+    return min_val;
+}
+
+__attribute__((target("sse2")))
+static double sse2_max(const double *a, int n) {
+    if (n < 2) return a[0];
+    __m128d acc = _mm_loadu_pd(a);
+    int i = 2;
+    for (; i + 2 <= n; i += 2) acc = _mm_max_pd(acc, _mm_loadu_pd(a + i));
+    double max_val = _mm_cvtsd_f64(_mm_max_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    for (; i < n; i++) if (a[i] > max_val) max_val = a[i];
+    return max_val;
+}
+
+// Single precision: four floats per register
+__attribute__((target("sse2")))
+static float sse2_hsum_ps(__m128 v) {
+    __m128 shuf = _mm_movehl_ps(v, v);
+    v = _mm_add_ps(v, shuf);
+    return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+__attribute__((target("sse2")))
+static float sse2_dot_f32(const float *a, const float *b, int n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float sum = sse2_hsum_ps(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static float sse2_sq_dist_f32(const float *a, const float *b, int n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+    float sum = sse2_hsum_ps(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static void sse2_axpy_f32(float alpha, const float *x, float *y, int n) {
+    __m128 va = _mm_set1_ps(alpha);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+// SSE2 has no byte-to-dword sign extension: widen by unpacking each byte
+// into the top of a dword and shifting it back down arithmetically
+__attribute__((target("sse2")))
+static float sse2_dot_s8_f32(const int8_t *q, const float *x, int n) {
+    __m128 acc = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t bytes;
+        memcpy(&bytes, q + i, sizeof(bytes));
+        __m128i v = _mm_cvtsi32_si128(bytes);
+        v = _mm_unpacklo_epi8(v, v);
+        v = _mm_unpacklo_epi16(v, v);
+        __m128 qf = _mm_cvtepi32_ps(_mm_srai_epi32(v, 24));
+        acc = _mm_add_ps(acc, _mm_mul_ps(qf, _mm_loadu_ps(x + i)));
+    }
+    float sum = sse2_hsum_ps(acc);
+    for (; i < n; i++) sum += (float)q[i] * x[i];
+    return sum;
+}
+
+static const simd_kernels_t sse2_kernels = {
+    sse2_add, sse2_sub, sse2_mul, sse2_scale, sse2_fill,
+    sse2_dot, sse2_sum_sq, sse2_sq_dist, sse2_min, sse2_max,
+    sse2_dot_f32, sse2_sq_dist_f32, sse2_axpy_f32, sse2_dot_s8_f32
+};
+
+// AVX2 + FMA: four doubles per register
+SIMD_BINARY_OP(avx2, "avx2,fma", __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, add, +)
+SIMD_BINARY_OP(avx2, "avx2,fma", __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd, sub, -)
+SIMD_BINARY_OP(avx2, "avx2,fma", __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, mul, *)
+
+__attribute__((target("avx2,fma")))
+static void avx2_scale(const double *a, double scalar, double *out, int n) {
+    __m256d vs = _mm256_set1_pd(scalar);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), vs));
+    for (; i < n; i++) out[i] = a[i] * scalar;
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_fill(double *out, double value, int n) {
+    __m256d vv = _mm256_set1_pd(value);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, vv);
+    for (; i < n; i++) out[i] = value;
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_hsum(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_dot(const double *a, const double *b, int n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+    }
+    double sum = avx2_hsum(_mm256_add_pd(acc0, acc1));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_sum_sq(const double *a, int n) {
+    return avx2_dot(a, a, n);
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_sq_dist(const double *a, const double *b, int n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+    }
+    double sum = avx2_hsum(_mm256_add_pd(acc0, acc1));
+    for (; i < n; i++) {
+        double diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_min(const double *a, int n) {
+    if (n < 4) return scalar_min(a, n);
+    __m256d acc = _mm256_loadu_pd(a);
+    int i = 4;
+    for (; i + 4 <= n; i += 4) acc = _mm256_min_pd(acc, _mm256_loadu_pd(a + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double min_val = scalar_min(lanes, 4);
+    for (; i < n; i++) if (a[i] < min_val) min_val = a[i];
+    return min_val;
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_max(const double *a, int n) {
+    if (n < 4) return scalar_max(a, n);
+    __m256d acc = _mm256_loadu_pd(a);
+    int i = 4;
+    for (; i + 4 <= n; i += 4) acc = _mm256_max_pd(acc, _mm256_loadu_pd(a + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double max_val = scalar_max(lanes, 4);
+    for (; i < n; i++) if (a[i] > max_val) max_val = a[i];
+    return max_val;
+}
+
+// Single precision: eight floats per register
+__attribute__((target("avx2,fma")))
+static float avx2_hsum_ps(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    return _mm_cvtss_f32(_mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1)));
+}
+
+__attribute__((target("avx2,fma")))
+static float avx2_dot_f32(const float *a, const float *b, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    float sum = avx2_hsum_ps(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float avx2_sq_dist_f32(const float *a, const float *b, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    float sum = avx2_hsum_ps(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_axpy_f32(float alpha, const float *x, float *y, int n) {
+    __m256 va = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+__attribute__((target("avx2,fma")))
+static float avx2_dot_s8_f32(const int8_t *q, const float *x, int n) {
+    __m256 acc = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i wide = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(q + i)));
+        acc = _mm256_fmadd_ps(_mm256_cvtepi32_ps(wide), _mm256_loadu_ps(x + i), acc);
+    }
+    float sum = avx2_hsum_ps(acc);
+    for (; i < n; i++) sum += (float)q[i] * x[i];
+    return sum;
+}
+
+static const simd_kernels_t avx2_kernels = {
+    avx2_add, avx2_sub, avx2_mul, avx2_scale, avx2_fill,
+    avx2_dot, avx2_sum_sq, avx2_sq_dist, avx2_min, avx2_max,
+    avx2_dot_f32, avx2_sq_dist_f32, avx2_axpy_f32, avx2_dot_s8_f32
+};
+
+// AVX-512F: eight doubles per register, tails handled with masked loads
+#define AVX512_TAIL_MASK(n, i) ((__mmask8)((1u << ((n) - (i))) - 1u))
+
+#define AVX512_BINARY_OP(name, op) \
+    __attribute__((target("avx512f"))) \
+    static void avx512_##name(const double *a, const double *b, double *out, int n) { \
+        int i = 0; \
+        for (; i + 8 <= n; i += 8) { \
+            _mm512_storeu_pd(out + i, op(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i))); \
+        } \
+        if (i < n) { \
+            __mmask8 m = AVX512_TAIL_MASK(n, i); \
+            _mm512_mask_storeu_pd(out + i, m, op(_mm512_maskz_loadu_pd(m, a + i), \
+                                                 _mm512_maskz_loadu_pd(m, b + i))); \
+        } \
+    }
+
+AVX512_BINARY_OP(add, _mm512_add_pd)
+AVX512_BINARY_OP(sub, _mm512_sub_pd)
+AVX512_BINARY_OP(mul, _mm512_mul_pd)
+
+__attribute__((target("avx512f")))
+static void avx512_scale(const double *a, double scalar, double *out, int n) {
+    __m512d vs = _mm512_set1_pd(scalar);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), vs));
+    if (i < n) {
+        __mmask8 m = AVX512_TAIL_MASK(n, i);
+        _mm512_mask_storeu_pd(out + i, m, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, a + i), vs));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_fill(double *out, double value, int n) {
+    __m512d vv = _mm512_set1_pd(value);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, vv);
+    if (i < n) _mm512_mask_storeu_pd(out + i, AVX512_TAIL_MASK(n, i), vv);
+}
+
+__attribute__((target("avx512f")))
+static double avx512_dot(const double *a, const double *b, int n) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xFF : AVX512_TAIL_MASK(n, i);
+        acc0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i), acc0);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+static double avx512_sum_sq(const double *a, int n) {
+    return avx512_dot(a, a, n);
+}
+
+__attribute__((target("avx512f")))
+static double avx512_sq_dist(const double *a, const double *b, int n) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = n - i >= 8 ? (__mmask8)0xFF : AVX512_TAIL_MASK(n, i);
+        __m512d d = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i));
+        acc0 = _mm512_fmadd_pd(d, d, acc0);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+static double avx512_min(const double *a, int n) {
+    if (n < 8) return scalar_min(a, n);
+    __m512d acc = _mm512_loadu_pd(a);
+    int i = 8;
+    for (; i + 8 <= n; i += 8) acc = _mm512_min_pd(acc, _mm512_loadu_pd(a + i));
+    double min_val = _mm512_reduce_min_pd(acc);
+    for (; i < n; i++) if (a[i] < min_val) min_val = a[i];
+    return min_val;
+}
+
+__attribute__((target("avx512f")))
+static double avx512_max(const double *a, int n) {
+    if (n < 8) return scalar_max(a, n);
+    __m512d acc = _mm512_loadu_pd(a);
+    int i = 8;
+    for (; i + 8 <= n; i += 8) acc = _mm512_max_pd(acc, _mm512_loadu_pd(a + i));
+    double max_val = _mm512_reduce_max_pd(acc);
+    for (; i < n; i++) if (a[i] > max_val) max_val = a[i];
+    return max_val;
+}
+
+// Single precision: sixteen floats per register
+#define AVX512_TAIL_MASK16(n, i) ((__mmask16)((1u << ((n) - (i))) - 1u))
+
+__attribute__((target("avx512f")))
+static float avx512_dot_f32(const float *a, const float *b, int n) {
+    __m512 acc = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc);
+    }
+    if (i < n) {
+        __mmask16 m = AVX512_TAIL_MASK16(n, i);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f")))
+static float avx512_sq_dist_f32(const float *a, const float *b, int n) {
+    __m512 acc = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    if (i < n) {
+        __mmask16 m = AVX512_TAIL_MASK16(n, i);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i));
+        acc = _mm512_fmadd_ps(d, d, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_axpy_f32(float alpha, const float *x, float *y, int n) {
+    __m512 va = _mm512_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+    if (i < n) {
+        __mmask16 m = AVX512_TAIL_MASK16(n, i);
+        __m512 vy = _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i));
+        _mm512_mask_storeu_ps(y + i, m, vy);
+    }
+}
+
+__attribute__((target("avx512f")))
+static float avx512_dot_s8_f32(const int8_t *q, const float *x, int n) {
+    __m512 acc = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i wide = _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)(q + i)));
+        acc = _mm512_fmadd_ps(_mm512_cvtepi32_ps(wide), _mm512_loadu_ps(x + i), acc);
+    }
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; i < n; i++) sum += (float)q[i] * x[i];
+    return sum;
+}
+
+static const simd_kernels_t avx512_kernels = {
+    avx512_add, avx512_sub, avx512_mul, avx512_scale, avx512_fill,
+    avx512_dot, avx512_sum_sq, avx512_sq_dist, avx512_min, avx512_max,
+    avx512_dot_f32, avx512_sq_dist_f32, avx512_axpy_f32, avx512_dot_s8_f32
+};
+
+#endif  // SIMD_X86
+
+// Dispatch
+static const char *level_names[] = {"scalar", "sse2", "avx2", "avx512"};
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+static simd_level_t active_level = SIMD_SCALAR;
+static const simd_kernels_t *active_kernels = &scalar_kernels;
+
+simd_level_t simd_detect_level(void) {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+const simd_kernels_t* simd_kernels_for(simd_level_t level) {
+    if (level > simd_detect_level()) return NULL;
+    switch (level) {
+#ifdef SIMD_X86
+    case SIMD_AVX512: return &avx512_kernels;
+    case SIMD_AVX2:   return &avx2_kernels;
+    case SIMD_SSE2:   return &sse2_kernels;
+#endif
+    default:          return &scalar_kernels;
+    }
+}
+
+const char* simd_level_name(simd_level_t level) {
+    if (level < SIMD_SCALAR || level > SIMD_AVX512) return "unknown";
+    return level_names[level];
+}
+
+static void simd_dispatch_init(void) {
+    simd_level_t level = simd_detect_level();
+
+    // ML_SIMD pins a path; requests above what the CPU supports are clamped
+    const char *env = getenv("ML_SIMD");
+    if (env && *env) {
+        for (int i = SIMD_SCALAR; i <= SIMD_AVX512; i++) {
+            if (strcmp(env, level_names[i]) == 0) {
+                if ((simd_level_t)i < level) level = (simd_level_t)i;
+                break;
+            }
+        }
+    }
+
+    active_level = level;
+    active_kernels = simd_kernels_for(level);
+    ML_DEBUG_PRINT("SIMD path: %s", simd_level_name(level));
+}
+
+const simd_kernels_t* simd_kernels(void) {
+    pthread_once(&dispatch_once, simd_dispatch_init);
+    return active_kernels;
+}
+
+simd_level_t simd_level(void) {
+    pthread_once(&dispatch_once, simd_dispatch_init);
+    return active_level;
+}
\ No newline at end of file
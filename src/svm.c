@@ -0,0 +1,735 @@
+#include "svm.h"
+#include "simd.h"
+#include "model_io.h"
+#include "ml_random.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+SVM* svm_create(int n_features) {
+    if (n_features <= 0) return NULL;
+    SVM *svm = (SVM*)malloc(sizeof(SVM));
+    if (!svm) return NULL;
+    svm->weights = matrix_create_zeros(n_features, 1);
+    if (!svm->weights) {
+        free(svm);
+        return NULL;
+    }
+    svm->support_vectors = NULL;
+    svm->bias = 0.0;
+    svm->solver = SVM_SOLVER_DUAL_CD;
+    svm->tol = 0.1;
+    svm->batch_size = 1;
+    svm->seed = 0;
+    svm->n_iter = 0;
+    svm->n_steps = 0;
+    svm->kernel = SVM_KERNEL_LINEAR;
+    svm->gamma = 0.0;
+    svm->degree = 3;
+    svm->coef0 = 0.0;
+    svm->dual_coef = NULL;
+    svm->cache_mb = 100.0;
+    svm->cache_hits = 0;
+    svm->cache_misses = 0;
+    svm->mapping = NULL;
+    svm->mapping_size = 0;
+    return svm;
+}
+
+void svm_free(SVM *svm) {
+    if (svm) {
+        matrix_free(svm->support_vectors);
+        matrix_free(svm->dual_coef);
+        matrix_free(svm->weights);
+        model_file_unmap(svm->mapping, svm->mapping_size);
+        free(svm);
+    }
+}
+
+// Model file layout: weights, support vectors and dual coefficients (the
+// last two empty for linear and Pegasos models), plus the settings
+enum { SVM_FILE_SOLVER, SVM_FILE_KERNEL, SVM_FILE_DEGREE, SVM_FILE_BATCH_SIZE, SVM_FILE_SEED,
+       SVM_FILE_N_ITER, SVM_FILE_N_STEPS };
+enum { SVM_FILE_BIAS, SVM_FILE_TOL, SVM_FILE_GAMMA, SVM_FILE_COEF0, SVM_FILE_CACHE_MB };
+
+ml_error_t svm_save(const SVM *svm, const char *filename) {
+    ML_CHECK_NULL(svm);
+    ML_CHECK_NULL(filename);
+    ModelParams params = {0};
+    params.ints[SVM_FILE_SOLVER] = svm->solver;
+    params.ints[SVM_FILE_KERNEL] = svm->kernel;
+    params.ints[SVM_FILE_DEGREE] = svm->degree;
+    params.ints[SVM_FILE_BATCH_SIZE] = svm->batch_size;
+    params.ints[SVM_FILE_SEED] = svm->seed;
+    params.ints[SVM_FILE_N_ITER] = svm->n_iter;
+    params.ints[SVM_FILE_N_STEPS] = svm->n_steps;
+    params.reals[SVM_FILE_BIAS] = svm->bias;
+    params.reals[SVM_FILE_TOL] = svm->tol;
+    params.reals[SVM_FILE_GAMMA] = svm->gamma;
+    params.reals[SVM_FILE_COEF0] = svm->coef0;
+    params.reals[SVM_FILE_CACHE_MB] = svm->cache_mb;
+    const Matrix *sections[] = { svm->weights, svm->support_vectors, svm->dual_coef };
+    return model_file_save(filename, MODEL_FILE_SVM, &params, sections, 3);
+}
+
+SVM* svm_load(const char *filename, bool verify_checksum) {
+    ModelFile file;
+    if (model_file_open(filename, MODEL_FILE_SVM, verify_checksum, &file) != ML_SUCCESS) return NULL;
+    Matrix *weights = file.sections[0], *sv = file.sections[1], *dual = file.sections[2];
+    // Linear dual CD keeps its support vectors but no dual coefficients
+    bool valid = file.n_sections == 3 && weights && weights->cols == 1 && (sv || !dual) &&
+                 (!sv || sv->cols == weights->rows) &&
+                 (!dual || (dual->rows == sv->rows && dual->cols == 1));
+    SVM *svm = valid ? svm_create(weights->rows) : NULL;
+    if (!svm) {
+        model_file_close(&file);
+        return NULL;
+    }
+    const int64_t *ints = file.params.ints;
+    const double *reals = file.params.reals;
+    svm->solver = (svm_solver_t)ints[SVM_FILE_SOLVER];
+    svm->kernel = (svm_kernel_t)ints[SVM_FILE_KERNEL];
+    svm->degree = (int)ints[SVM_FILE_DEGREE];
+    svm->batch_size = (int)ints[SVM_FILE_BATCH_SIZE];
+    svm->seed = (unsigned int)ints[SVM_FILE_SEED];
+    svm->n_iter = (int)ints[SVM_FILE_N_ITER];
+    svm->n_steps = ints[SVM_FILE_N_STEPS];
+    svm->bias = reals[SVM_FILE_BIAS];
+    svm->tol = reals[SVM_FILE_TOL];
+    svm->gamma = reals[SVM_FILE_GAMMA];
+    svm->coef0 = reals[SVM_FILE_COEF0];
+    svm->cache_mb = reals[SVM_FILE_CACHE_MB];
+
+    matrix_free(svm->weights);
+    svm->weights = weights;
+    svm->support_vectors = sv;
+    svm->dual_coef = dual;
+    file.sections[0] = file.sections[1] = file.sections[2] = NULL;
+    svm->mapping = file.mapping;
+    svm->mapping_size = file.mapping_size;
+    file.mapping = NULL;
+    model_file_close(&file);
+    return svm;
+}
+
+static bool svm_check_inputs(const SVM *svm, const Matrix *X, const Matrix *y) {
+    return svm && X && y && X->rows == y->rows && y->cols == 1 &&
+           X->cols == svm->weights->rows && X->rows > 0;
+}
+
+static double svm_label(const Matrix *y, int i) {
+    return matrix_row(y, i)[0] > 0 ? 1.0 : -1.0;
+}
+
+// Copy the rows with nonzero dual weight into svm->support_vectors
+static void svm_store_support_vectors(SVM *svm, const Matrix *X, const double *alpha) {
+    int n_support = 0;
+    for (int i = 0; i < X->rows; i++) {
+        if (alpha[i] > 0) n_support++;
+    }
+    matrix_free(svm->support_vectors);
+    svm->support_vectors = NULL;
+    if (n_support == 0) return;
+
+    svm->support_vectors = matrix_create(n_support, X->cols);
+    if (!svm->support_vectors) return;
+    for (int i = 0, s = 0; i < X->rows; i++) {
+        if (alpha[i] > 0) {
+            memcpy(svm->support_vectors->data + s * X->cols, matrix_row(X, i), X->cols * sizeof(double));
+            s++;
+        }
+    }
+}
+
+// Dual coordinate descent for the L1-loss SVM (Hsieh et al., 2008). The
+// bias is handled as an extra feature fixed at 1. Each coordinate step
+// costs one dot product and one axpy over a row, so an epoch is linear in
+// the data. Coordinates stuck at a bound with a gradient pushing further
+// out are shrunk from the active set; when the active set converges the
+// full set is rechecked once before stopping.
+static void svm_fit_dual_cd(SVM *svm, const Matrix *X, const Matrix *y, double C, int max_iters) {
+    const simd_kernels_t *simd = simd_kernels();
+    int n = X->rows, d = X->cols;
+    double *alpha = calloc(n, sizeof(double));
+    double *qd = malloc(n * sizeof(double));
+    int *index = malloc(n * sizeof(int));
+    if (!alpha || !qd || !index) {
+        free(alpha);
+        free(qd);
+        free(index);
+        return;
+    }
+
+    double *w = svm->weights->data;
+    memset(w, 0, d * sizeof(double));
+    double b = 0.0;
+    for (int i = 0; i < n; i++) {
+        qd[i] = simd->sum_sq(matrix_row(X, i), d) + 1.0;
+        index[i] = i;
+    }
+
+    int active_size = n;
+    double pg_max_old = INFINITY, pg_min_old = -INFINITY;
+    int iter = 0;
+    while (iter < max_iters) {
+        double pg_max_new = -INFINITY, pg_min_new = INFINITY;
+        ml_shuffle(index, active_size, svm->seed, (uint64_t)iter);
+
+        for (int s = 0; s < active_size; s++) {
+            int i = index[s];
+            const double *x = matrix_row(X, i);
+            double yi = svm_label(y, i);
+            double g = yi * (simd->dot(x, w, d) + b) - 1.0;
+
+            // Projected gradient; shrink coordinates pinned at a bound
+            double pg = 0.0;
+            if (alpha[i] == 0.0) {
+                if (g > pg_max_old) {
+                    active_size--;
+                    index[s] = index[active_size];
+                    index[active_size] = i;
+                    s--;
+                    continue;
+                }
+                if (g < 0) pg = g;
+            } else if (alpha[i] == C) {
+                if (g < pg_min_old) {
+                    active_size--;
+                    index[s] = index[active_size];
+                    index[active_size] = i;
+                    s--;
+                    continue;
+                }
+                if (g > 0) pg = g;
+            } else {
+                pg = g;
+            }
+            if (pg > pg_max_new) pg_max_new = pg;
+            if (pg < pg_min_new) pg_min_new = pg;
+
+            if (fabs(pg) > 1e-12) {
+                double old = alpha[i];
+                double a = old - g / qd[i];
+                alpha[i] = a < 0 ? 0 : (a > C ? C : a);
+                double delta = (alpha[i] - old) * yi;
+                for (int j = 0; j < d; j++) w[j] += delta * x[j];
+                b += delta;
+            }
+        }
+        iter++;
+
+        if (pg_max_new - pg_min_new <= svm->tol) {
+            if (active_size == n) break;
+            // Converged on the shrunk problem: recheck every coordinate
+            active_size = n;
+            pg_max_old = INFINITY;
+            pg_min_old = -INFINITY;
+            continue;
+        }
+        pg_max_old = pg_max_new > 0 ? pg_max_new : INFINITY;
+        pg_min_old = pg_min_new < 0 ? pg_min_new : -INFINITY;
+    }
+
+    svm->bias = b;
+    svm->n_iter = iter;
+    svm_store_support_vectors(svm, X, alpha);
+    free(alpha);
+    free(qd);
+    free(index);
+}
+
+// Kernel between rows x and z given their squared norms (needed by RBF)
+static double svm_kernel(const SVM *svm, double gamma, const double *x, const double *z,
+                         double x_sq, double z_sq, int d) {
+    double dot = simd_kernels()->dot(x, z, d);
+    switch (svm->kernel) {
+    case SVM_KERNEL_RBF:
+        return exp(-gamma * fmax(x_sq + z_sq - 2.0 * dot, 0.0));
+    case SVM_KERNEL_POLY: {
+        double base = gamma * dot + svm->coef0, result = 1.0;
+        for (int p = 0; p < svm->degree; p++) result *= base;
+        return result;
+    }
+    default:
+        return dot;
+    }
+}
+
+static double svm_gamma(const SVM *svm, int n_features) {
+    return svm->gamma > 0 ? svm->gamma : 1.0 / n_features;
+}
+
+// LRU cache of rows of Q (Q_ij = y_i y_j K(x_i, x_j)) for SMO. Rows live
+// in a doubly linked list ordered by last use; when the byte budget is
+// spent the least recently used row's buffer is recycled. At least two rows
+// are always kept because each SMO step needs rows i and j at once.
+typedef struct {
+    const SVM *svm;
+    const Matrix *X;
+    const double *y;       // +1 / -1 labels
+    const double *sq_norm; // |x_i|^2
+    double gamma;
+    int n;
+    int max_rows;
+    int n_cached;
+    double **rows;         // n entries, NULL when row i is not cached
+    int *prev, *next;      // LRU list links, -1 terminated
+    int head, tail;        // most / least recently used
+    long long hits, misses;
+} SvmKernelCache;
+
+static bool svm_cache_init(SvmKernelCache *cache, const SVM *svm, const Matrix *X,
+                           const double *y, const double *sq_norm) {
+    int n = X->rows;
+    cache->svm = svm;
+    cache->X = X;
+    cache->y = y;
+    cache->sq_norm = sq_norm;
+    cache->gamma = svm_gamma(svm, X->cols);
+    cache->n = n;
+    double budget_rows = svm->cache_mb * 1024.0 * 1024.0 / ((double)n * sizeof(double));
+    cache->max_rows = budget_rows >= n ? n : (budget_rows < 2 ? 2 : (int)budget_rows);
+    if (cache->max_rows > n) cache->max_rows = n;
+    cache->n_cached = 0;
+    cache->rows = calloc(n, sizeof(double*));
+    cache->prev = malloc(n * sizeof(int));
+    cache->next = malloc(n * sizeof(int));
+    cache->head = cache->tail = -1;
+    cache->hits = cache->misses = 0;
+    return cache->rows && cache->prev && cache->next;
+}
+
+static void svm_cache_free(SvmKernelCache *cache) {
+    if (cache->rows) {
+        for (int i = 0; i < cache->n; i++) free(cache->rows[i]);
+    }
+    free(cache->rows);
+    free(cache->prev);
+    free(cache->next);
+}
+
+static void svm_cache_unlink(SvmKernelCache *cache, int i) {
+    if (cache->prev[i] >= 0) cache->next[cache->prev[i]] = cache->next[i];
+    else cache->head = cache->next[i];
+    if (cache->next[i] >= 0) cache->prev[cache->next[i]] = cache->prev[i];
+    else cache->tail = cache->prev[i];
+}
+
+static void svm_cache_push_front(SvmKernelCache *cache, int i) {
+    cache->prev[i] = -1;
+    cache->next[i] = cache->head;
+    if (cache->head >= 0) cache->prev[cache->head] = i;
+    cache->head = i;
+    if (cache->tail < 0) cache->tail = i;
+}
+
+// Row i of Q, or NULL on allocation failure
+static const double* svm_cache_row(SvmKernelCache *cache, int i) {
+    if (cache->rows[i]) {
+        cache->hits++;
+        if (cache->head != i) {
+            svm_cache_unlink(cache, i);
+            svm_cache_push_front(cache, i);
+        }
+        return cache->rows[i];
+    }
+
+    cache->misses++;
+    double *row;
+    if (cache->n_cached == cache->max_rows) {
+        int victim = cache->tail;
+        svm_cache_unlink(cache, victim);
+        row = cache->rows[victim];
+        cache->rows[victim] = NULL;
+    } else {
+        row = malloc(cache->n * sizeof(double));
+        if (!row) return NULL;
+        cache->n_cached++;
+    }
+
+    int d = cache->X->cols;
+    const double *xi = matrix_row(cache->X, i);
+    for (int t = 0; t < cache->n; t++) {
+        double k = svm_kernel(cache->svm, cache->gamma, xi, matrix_row(cache->X, t),
+                              cache->sq_norm[i], cache->sq_norm[t], d);
+        row[t] = cache->y[i] * cache->y[t] * k;
+    }
+    cache->rows[i] = row;
+    svm_cache_push_front(cache, i);
+    return row;
+}
+
+#define SVM_TAU 1e-12
+
+// Pick the maximal violating pair with second-order working set selection
+// (Fan, Chen and Lin, 2005): i maximises -y_i G_i over I_up, j minimises
+// the objective decrease estimate -(b_ij^2 / a_ij) over I_low. Returns
+// false when the KKT gap is below tol. Row i of Q, which the selection
+// already needed, is handed back through out_Qi.
+static bool svm_smo_select(SvmKernelCache *cache, const double *alpha, const double *G,
+                           const double *qd, double C, double tol, int *out_i, int *out_j,
+                           const double **out_Qi) {
+    const double *y = cache->y;
+    int n = cache->n;
+    double g_max = -INFINITY, g_max2 = -INFINITY;
+    int i = -1;
+    for (int t = 0; t < n; t++) {
+        if (y[t] > 0) {
+            if (alpha[t] < C && -G[t] >= g_max) {
+                g_max = -G[t];
+                i = t;
+            }
+        } else if (alpha[t] > 0 && G[t] >= g_max) {
+            g_max = G[t];
+            i = t;
+        }
+    }
+    if (i < 0) return false;
+
+    const double *Qi = svm_cache_row(cache, i);
+    if (!Qi) return false;
+    int j = -1;
+    double best = INFINITY;
+    for (int t = 0; t < n; t++) {
+        double grad_diff, quad;
+        if (y[t] > 0) {
+            if (alpha[t] <= 0) continue;
+            if (G[t] >= g_max2) g_max2 = G[t];
+            grad_diff = g_max + G[t];
+            quad = qd[i] + qd[t] - 2.0 * y[i] * Qi[t];
+        } else {
+            if (alpha[t] >= C) continue;
+            if (-G[t] >= g_max2) g_max2 = -G[t];
+            grad_diff = g_max - G[t];
+            quad = qd[i] + qd[t] + 2.0 * y[i] * Qi[t];
+        }
+        if (grad_diff > 0) {
+            double obj = -(grad_diff * grad_diff) / (quad > 0 ? quad : SVM_TAU);
+            if (obj <= best) {
+                best = obj;
+                j = t;
+            }
+        }
+    }
+    if (g_max + g_max2 < tol || j < 0) return false;
+    *out_i = i;
+    *out_j = j;
+    *out_Qi = Qi;
+    return true;
+}
+
+// Analytic two-variable update of alpha_i, alpha_j keeping y^T alpha fixed
+// and both inside [0, C]
+static void svm_smo_update(double *alpha, const double *G, const double *y, const double *Qi,
+                           const double *qd, int i, int j, double C) {
+    if (y[i] != y[j]) {
+        double quad = qd[i] + qd[j] + 2.0 * Qi[j];
+        double delta = (-G[i] - G[j]) / (quad > 0 ? quad : SVM_TAU);
+        double diff = alpha[i] - alpha[j];
+        alpha[i] += delta;
+        alpha[j] += delta;
+        if (diff > 0) {
+            if (alpha[j] < 0) { alpha[j] = 0; alpha[i] = diff; }
+        } else {
+            if (alpha[i] < 0) { alpha[i] = 0; alpha[j] = -diff; }
+        }
+        if (diff > 0) {
+            if (alpha[i] > C) { alpha[i] = C; alpha[j] = C - diff; }
+        } else {
+            if (alpha[j] > C) { alpha[j] = C; alpha[i] = C + diff; }
+        }
+    } else {
+        double quad = qd[i] + qd[j] - 2.0 * Qi[j];
+        double delta = (G[i] - G[j]) / (quad > 0 ? quad : SVM_TAU);
+        double sum = alpha[i] + alpha[j];
+        alpha[i] -= delta;
+        alpha[j] += delta;
+        if (sum > C) {
+            if (alpha[i] > C) { alpha[i] = C; alpha[j] = sum - C; }
+            if (alpha[j] > C) { alpha[j] = C; alpha[i] = sum - C; }
+        } else {
+            if (alpha[j] < 0) { alpha[j] = 0; alpha[i] = sum; }
+            if (alpha[i] < 0) { alpha[i] = 0; alpha[j] = sum; }
+        }
+    }
+}
+
+// Bias from the free support vectors' KKT conditions, or the middle of the
+// feasible interval when every alpha sits at a bound
+static double svm_smo_bias(const double *alpha, const double *G, const double *y, int n, double C) {
+    double ub = INFINITY, lb = -INFINITY, sum_free = 0.0;
+    int n_free = 0;
+    for (int t = 0; t < n; t++) {
+        double yg = y[t] * G[t];
+        if (alpha[t] >= C) {
+            if (y[t] < 0) ub = fmin(ub, yg);
+            else lb = fmax(lb, yg);
+        } else if (alpha[t] <= 0) {
+            if (y[t] > 0) ub = fmin(ub, yg);
+            else lb = fmax(lb, yg);
+        } else {
+            n_free++;
+            sum_free += yg;
+        }
+    }
+    double rho = n_free > 0 ? sum_free / n_free : (ub + lb) / 2.0;
+    return -rho;
+}
+
+// SMO for the C-SVC dual: min 1/2 a^T Q a - e^T a, 0 <= a <= C, y^T a = 0.
+// Only the rows of Q for the selected pairs are ever computed, through the
+// LRU cache, so memory stays within cache_mb regardless of n.
+static void svm_fit_smo(SVM *svm, const Matrix *X, const Matrix *y, double C, int max_iters) {
+    const simd_kernels_t *simd = simd_kernels();
+    int n = X->rows, d = X->cols;
+    double *labels = malloc(n * sizeof(double));
+    double *sq_norm = malloc(n * sizeof(double));
+    double *alpha = calloc(n, sizeof(double));
+    double *G = malloc(n * sizeof(double));
+    double *qd = malloc(n * sizeof(double));
+    SvmKernelCache cache = {0};
+    bool ok = labels && sq_norm && alpha && G && qd;
+    if (ok) {
+        for (int t = 0; t < n; t++) {
+            labels[t] = svm_label(y, t);
+            sq_norm[t] = simd->sum_sq(matrix_row(X, t), d);
+        }
+        ok = svm_cache_init(&cache, svm, X, labels, sq_norm);
+    }
+    if (!ok) {
+        svm_cache_free(&cache);
+        free(labels);
+        free(sq_norm);
+        free(alpha);
+        free(G);
+        free(qd);
+        return;
+    }
+
+    for (int t = 0; t < n; t++) {
+        const double *x = matrix_row(X, t);
+        qd[t] = svm_kernel(svm, cache.gamma, x, x, sq_norm[t], sq_norm[t], d);
+        G[t] = -1.0;
+    }
+
+    int iter = 0, i, j;
+    const double *Qi;
+    while (iter < max_iters && svm_smo_select(&cache, alpha, G, qd, C, svm->tol, &i, &j, &Qi)) {
+        // Row i was fetched by the selection and is most recently used, so
+        // fetching row j cannot evict it
+        const double *Qj = svm_cache_row(&cache, j);
+        if (!Qj) break;
+        double old_i = alpha[i], old_j = alpha[j];
+        svm_smo_update(alpha, G, labels, Qi, qd, i, j, C);
+        double delta_i = alpha[i] - old_i, delta_j = alpha[j] - old_j;
+        for (int t = 0; t < n; t++) G[t] += Qi[t] * delta_i + Qj[t] * delta_j;
+        iter++;
+    }
+
+    svm->n_iter = iter;
+    svm->bias = svm_smo_bias(alpha, G, labels, n, C);
+    svm->cache_hits = cache.hits;
+    svm->cache_misses = cache.misses;
+    svm_store_support_vectors(svm, X, alpha);
+
+    matrix_free(svm->dual_coef);
+    svm->dual_coef = svm->support_vectors ? matrix_create(svm->support_vectors->rows, 1) : NULL;
+    if (svm->dual_coef) {
+        for (int t = 0, s = 0; t < n; t++) {
+            if (alpha[t] > 0) svm->dual_coef->data[s++] = alpha[t] * labels[t];
+        }
+    }
+
+    svm_cache_free(&cache);
+    free(labels);
+    free(sq_norm);
+    free(alpha);
+    free(G);
+    free(qd);
+}
+
+// One Pegasos step on rows[begin, begin + count): w <- (1 - eta*lambda) w
+// + eta/|B| * sum of y_i x_i over margin violators. The bias is not
+// regularized.
+static void svm_pegasos_step(SVM *svm, const Matrix *X, const Matrix *y, const int *rows,
+                             int begin, int count, double lambda, double *grad) {
+    const simd_kernels_t *simd = simd_kernels();
+    int d = X->cols;
+    double *w = svm->weights->data;
+    double grad_b = 0.0;
+    memset(grad, 0, d * sizeof(double));
+    for (int r = 0; r < count; r++) {
+        int i = rows ? rows[begin + r] : begin + r;
+        const double *x = matrix_row(X, i);
+        double yi = svm_label(y, i);
+        if (yi * (simd->dot(x, w, d) + svm->bias) < 1.0) {
+            for (int j = 0; j < d; j++) grad[j] += yi * x[j];
+            grad_b += yi;
+        }
+    }
+
+    svm->n_steps++;
+    double eta = 1.0 / (lambda * (double)svm->n_steps);
+    simd->scale(w, 1.0 - eta * lambda, w, d);
+    double step = eta / count;
+    for (int j = 0; j < d; j++) w[j] += step * grad[j];
+    svm->bias += step * grad_b;
+
+    // Project onto the ball of radius 1/sqrt(lambda), which
+    // contains the optimum and keeps early steps from overshooting
+    double norm_sq = simd->sum_sq(w, d);
+    if (norm_sq * lambda > 1.0) simd->scale(w, 1.0 / sqrt(norm_sq * lambda), w, d);
+}
+
+static void svm_fit_pegasos(SVM *svm, const Matrix *X, const Matrix *y, double C, int max_iters) {
+    int n = X->rows, d = X->cols;
+    int batch = svm->batch_size > 0 ? svm->batch_size : 1;
+    double lambda = 1.0 / (C * n);
+    int *index = malloc(n * sizeof(int));
+    double *grad = malloc(d * sizeof(double));
+    if (!index || !grad) {
+        free(index);
+        free(grad);
+        return;
+    }
+
+    matrix_fill(svm->weights, 0.0);
+    svm->bias = 0.0;
+    svm->n_steps = 0;
+    for (int i = 0; i < n; i++) index[i] = i;
+
+    for (int epoch = 0; epoch < max_iters; epoch++) {
+        ml_shuffle(index, n, svm->seed, (uint64_t)epoch);
+        for (int begin = 0; begin < n; begin += batch) {
+            int count = n - begin < batch ? n - begin : batch;
+            svm_pegasos_step(svm, X, y, index, begin, count, lambda, grad);
+        }
+        svm->n_iter = epoch + 1;
+    }
+
+    matrix_free(svm->support_vectors);
+    svm->support_vectors = NULL;
+    free(index);
+    free(grad);
+}
+
+void svm_fit(SVM *svm, const Matrix *X, const Matrix *y, double C, int max_iters) {
+    if (!svm_check_inputs(svm, X, y) || C <= 0) return;
+    svm->n_iter = 0;
+    if (svm->kernel != SVM_KERNEL_LINEAR) {
+        svm_fit_smo(svm, X, y, C, max_iters);
+    } else if (svm->solver == SVM_SOLVER_PEGASOS) {
+        svm_fit_pegasos(svm, X, y, C, max_iters);
+    } else {
+        svm_fit_dual_cd(svm, X, y, C, max_iters);
+    }
+}
+
+void svm_partial_fit(SVM *svm, const Matrix *X, const Matrix *y, double lambda) {
+    if (!svm_check_inputs(svm, X, y) || lambda <= 0) return;
+    double *grad = malloc(X->cols * sizeof(double));
+    if (!grad) return;
+    int batch = svm->batch_size > 0 ? svm->batch_size : 1;
+    for (int begin = 0; begin < X->rows; begin += batch) {
+        int count = X->rows - begin < batch ? X->rows - begin : batch;
+        svm_pegasos_step(svm, X, y, NULL, begin, count, lambda, grad);
+    }
+    free(grad);
+}
+
+// Kernel expansion sum_s dual_coef_s K(sv_s, x) + b for one row, given the
+// support vectors' squared norms
+static double svm_kernel_score(const SVM *svm, double gamma, const double *x, const double *sv_sq, int d) {
+    const Matrix *sv = svm->support_vectors;
+    double x_sq = svm->kernel == SVM_KERNEL_RBF ? simd_kernels()->sum_sq(x, d) : 0.0;
+    double score = svm->bias;
+    for (int s = 0; s < sv->rows; s++) {
+        score += svm->dual_coef->data[s] * svm_kernel(svm, gamma, x, sv->data + s * d, x_sq, sv_sq[s], d);
+    }
+    return score;
+}
+
+Matrix* svm_decision_function(const SVM *svm, const Matrix *X) {
+    if (!svm || !X || X->cols != svm->weights->rows) return NULL;
+    Matrix *scores = matrix_create(X->rows, 1);
+    if (!scores) return NULL;
+
+    const simd_kernels_t *simd = simd_kernels();
+    int d = X->cols;
+    if (svm->kernel == SVM_KERNEL_LINEAR) {
+        const double *w = svm->weights->data;
+        for (int i = 0; i < X->rows; i++) {
+            scores->data[i] = simd->dot(matrix_row(X, i), w, d) + svm->bias;
+        }
+        return scores;
+    }
+
+    if (!svm->support_vectors || !svm->dual_coef) {
+        matrix_fill(scores, svm->bias);
+        return scores;
+    }
+    const Matrix *sv = svm->support_vectors;
+    double *sv_sq = malloc(sv->rows * sizeof(double));
+    if (!sv_sq) {
+        matrix_free(scores);
+        return NULL;
+    }
+    for (int s = 0; s < sv->rows; s++) sv_sq[s] = simd->sum_sq(sv->data + s * d, d);
+    double gamma = svm_gamma(svm, d);
+    for (int i = 0; i < X->rows; i++) {
+        scores->data[i] = svm_kernel_score(svm, gamma, matrix_row(X, i), sv_sq, d);
+    }
+    free(sv_sq);
+    return scores;
+}
+
+Matrix* svm_predict(const SVM *svm, const Matrix *X) {
+    if (!svm || !X || X->cols != svm->weights->rows) return NULL;
+    if (svm->kernel != SVM_KERNEL_LINEAR) {
+        Matrix *labels = svm_decision_function(svm, X);
+        if (!labels) return NULL;
+        for (int i = 0; i < labels->rows; i++) {
+            labels->data[i] = labels->data[i] >= 0 ? 1.0 : -1.0;
+        }
+        return labels;
+    }
+
+    Matrix *labels = matrix_create(X->rows, 1);
+    if (!labels) return NULL;
+
+    // Single pass: one dot product per row, thresholded in place
+    const simd_kernels_t *simd = simd_kernels();
+    const double *w = svm->weights->data;
+    for (int i = 0; i < X->rows; i++) {
+        double score = simd->dot(matrix_row(X, i), w, X->cols) + svm->bias;
+        labels->data[i] = score >= 0 ? 1.0 : -1.0;
+    }
+    return labels;
+}
+
+// Sparse rows against the linear weights: O(nnz) per batch. Kernel
+// models would need every support vector densified per row, so they are
+// not scored here.
+ml_error_t svm_decision_function_sparse(const SVM *svm, const SparseMatrix *X, double *scores) {
+    ML_CHECK_NULL(svm);
+    ML_CHECK_NULL(X);
+    ML_CHECK_NULL(scores);
+    if (svm->kernel != SVM_KERNEL_LINEAR) return ML_ERROR_NOT_IMPLEMENTED;
+    if (X->cols > svm->weights->rows) return ML_ERROR_DIMENSION_MISMATCH;
+    for (int i = 0; i < X->rows; i++) {
+        scores[i] = sparse_row_dot(X, i, svm->weights->data) + svm->bias;
+    }
+    return ML_SUCCESS;
+}
+
+ml_error_t svm_predict_sparse(const SVM *svm, const SparseMatrix *X, double *labels) {
+    ml_error_t err = svm_decision_function_sparse(svm, X, labels);
+    if (err != ML_SUCCESS) return err;
+    for (int i = 0; i < X->rows; i++) labels[i] = labels[i] >= 0 ? 1.0 : -1.0;
+    return ML_SUCCESS;
+}
+
+double svm_cache_hit_rate(const SVM *svm) {
+    if (!svm) return 0.0;
+    long long lookups = svm->cache_hits + svm->cache_misses;
+    return lookups > 0 ? (double)svm->cache_hits / lookups : 0.0;
+}
@@ -0,0 +1,376 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // pthread_setaffinity_np
+#endif
+#include "thread_pool.h"
+#include "arena.h"
+#include "profile.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Chunks of one parallel_for still owned by a thread: the next chunk in
+// the low 32 bits, one past the last in the high 32. The owner takes from
+// the front and thieves from the back, each with a single CAS on the pair.
+// Padded to a cache line so threads never share one.
+typedef struct {
+    uint64_t range;
+    char pad[ML_ALIGNMENT - sizeof(uint64_t)];
+} ParallelQueue;
+
+struct ThreadPool {
+    pthread_t *threads;
+    int n_threads;           // including the calling thread
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    pthread_mutex_t run_lock;  // held by the caller of the job in flight
+    thread_task_fn fn;
+    void *ctx;
+    unsigned long generation;  // bumped once per thread_pool_run
+    int pending;               // workers still running the current task
+    bool shutdown;
+    ParallelQueue *queues;     // one per thread, reused by every parallel_for
+};
+
+typedef struct {
+    ThreadPool *pool;
+    int thread_id;
+} WorkerArgs;
+
+// Nonzero while this thread runs a pool task; pool calls made then run inline
+static _Thread_local int thread_pool_depth;
+
+static void* worker_main(void *arg) {
+    WorkerArgs args = *(WorkerArgs*)arg;
+    free(arg);
+    ThreadPool *pool = args.pool;
+    unsigned long seen = 0;
+    thread_pool_depth = 1;  // anything a worker runs is nested
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        thread_task_fn fn = pool->fn;
+        void *ctx = pool->ctx;
+        pthread_mutex_unlock(&pool->lock);
+
+        fn(ctx, args.thread_id, pool->n_threads);
+        ML_PROFILE_FLUSH();  // publish counts before the caller can read them
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int thread_num_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+// Affinity is a hint: CPUs outside the process's allowed set are ignored
+static void thread_pool_pin(pthread_t thread, int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+ThreadPool* thread_pool_create(int n_threads) {
+    ThreadPoolOptions options = { .n_threads = n_threads };
+    return thread_pool_create_with(&options);
+}
+
+ThreadPool* thread_pool_create_with(const ThreadPoolOptions *options) {
+    if (!options || (options->cpus && options->n_cpus <= 0)) return NULL;
+    int n_threads = options->n_threads > 0 ? options->n_threads : thread_num_cpus();
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->n_threads = n_threads;
+    pool->threads = calloc(n_threads, sizeof(pthread_t));
+    void *queues = NULL;
+    if (!pool->threads || posix_memalign(&queues, ML_ALIGNMENT, n_threads * sizeof(ParallelQueue)) != 0) {
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    pool->queues = queues;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    // Thread 0 is the caller, so only n_threads - 1 workers are spawned
+    int n_cpus = thread_num_cpus();
+    for (int i = 1; i < n_threads; i++) {
+        WorkerArgs *args = malloc(sizeof(WorkerArgs));
+        if (args) {
+            args->pool = pool;
+            args->thread_id = i;
+        }
+        if (!args || pthread_create(&pool->threads[i], NULL, worker_main, args) != 0) {
+            free(args);
+            pool->n_threads = i;  // only join what was started
+            thread_pool_free(pool);
+            return NULL;
+        }
+        if (options->pin_threads) {
+            thread_pool_pin(pool->threads[i], options->cpus ? options->cpus[i % options->n_cpus] : i % n_cpus);
+        }
+    }
+    return pool;
+}
+
+void thread_pool_free(ThreadPool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->n_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->queues);
+    free(pool->threads);
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool ? pool->n_threads : 1;
+}
+
+// Claim the pool for one job. Fails for nested calls and while another
+// thread's job is in flight; the caller then runs the work itself.
+static bool thread_pool_acquire(ThreadPool *pool) {
+    if (!pool || pool->n_threads == 1 || thread_pool_depth > 0) return false;
+    return pthread_mutex_trylock(&pool->run_lock) == 0;
+}
+
+// Run fn on every thread of a pool claimed by thread_pool_acquire, then
+// release it
+static void thread_pool_dispatch(ThreadPool *pool, thread_task_fn fn, void *ctx) {
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->pending = pool->n_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    thread_pool_depth++;
+    fn(ctx, 0, pool->n_threads);
+    thread_pool_depth--;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+void thread_pool_run(ThreadPool *pool, thread_task_fn fn, void *ctx) {
+    if (!thread_pool_acquire(pool)) {
+        // Same thread ids as a parallel run, one after another, so
+        // per-thread partitions and scratch slots still line up
+        int n_threads = thread_pool_size(pool);
+        thread_pool_depth++;
+        for (int t = 0; t < n_threads; t++) fn(ctx, t, n_threads);
+        thread_pool_depth--;
+        return;
+    }
+    thread_pool_dispatch(pool, fn, ctx);
+}
+
+static pthread_mutex_t thread_pool_global_lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadPool *thread_pool_global_pool;
+
+ThreadPool* thread_pool_global(void) {
+    pthread_mutex_lock(&thread_pool_global_lock);
+    if (!thread_pool_global_pool) {
+        const char *env = getenv("ML_NUM_THREADS");
+        long n = env ? strtol(env, NULL, 10) : 0;
+        thread_pool_global_pool = thread_pool_create(n > 0 && n < 4096 ? (int)n : 0);
+    }
+    ThreadPool *pool = thread_pool_global_pool;
+    pthread_mutex_unlock(&thread_pool_global_lock);
+    return pool;
+}
+
+ml_error_t thread_pool_configure(const ThreadPoolOptions *options) {
+    ThreadPool *pool = NULL;
+    if (options) {
+        if (options->cpus && options->n_cpus <= 0) return ML_ERROR_INVALID_PARAMETER;
+        pool = thread_pool_create_with(options);
+        if (!pool) return ML_ERROR_MEMORY_ALLOCATION;
+    }
+    pthread_mutex_lock(&thread_pool_global_lock);
+    ThreadPool *old = thread_pool_global_pool;
+    thread_pool_global_pool = pool;
+    pthread_mutex_unlock(&thread_pool_global_lock);
+    thread_pool_free(old);
+    return ML_SUCCESS;
+}
+
+ThreadPool* thread_pool_select(ThreadPool *pool, int n_threads, ThreadPool **owned) {
+    *owned = NULL;
+    if (pool) return pool;
+    if (n_threads == 1) return NULL;
+    if (n_threads <= 0) return thread_pool_global();
+    *owned = thread_pool_create(n_threads);
+    return *owned;
+}
+
+typedef struct {
+    ParallelQueue *queues;
+    int n;
+    int grain;
+    parallel_for_fn fn;
+    void *ctx;
+} ParallelForTask;
+
+static bool parallel_queue_pop(ParallelQueue *q, uint32_t *chunk) {
+    uint64_t range = __atomic_load_n(&q->range, __ATOMIC_RELAXED);
+    for (;;) {
+        uint32_t next = (uint32_t)range, end = (uint32_t)(range >> 32);
+        if (next >= end) return false;
+        if (__atomic_compare_exchange_n(&q->range, &range, range + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *chunk = next;
+            return true;
+        }
+    }
+}
+
+static bool parallel_queue_steal(ParallelQueue *q, uint32_t *chunk) {
+    uint64_t range = __atomic_load_n(&q->range, __ATOMIC_RELAXED);
+    for (;;) {
+        uint32_t next = (uint32_t)range, end = (uint32_t)(range >> 32);
+        if (next >= end) return false;
+        uint64_t stolen = (uint64_t)(end - 1) << 32 | next;
+        if (__atomic_compare_exchange_n(&q->range, &range, stolen, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *chunk = end - 1;
+            return true;
+        }
+    }
+}
+
+static void parallel_for_chunk(const ParallelForTask *task, uint32_t chunk, int thread_id) {
+    long long begin = (long long)chunk * task->grain;
+    long long end = begin + task->grain < task->n ? begin + task->grain : task->n;
+    task->fn(task->ctx, (int)begin, (int)end, thread_id);
+}
+
+// Chunks are only ever removed once the job starts, so a thread that finds
+// every queue empty is done
+static void parallel_for_worker(void *ctx, int thread_id, int n_threads) {
+    ParallelForTask *task = ctx;
+    uint32_t chunk;
+    for (;;) {
+        bool found = parallel_queue_pop(&task->queues[thread_id], &chunk);
+        for (int v = 1; !found && v < n_threads; v++) {
+            found = parallel_queue_steal(&task->queues[(thread_id + v) % n_threads], &chunk);
+        }
+        if (!found) return;
+        parallel_for_chunk(task, chunk, thread_id);
+    }
+}
+
+void parallel_for(ThreadPool *pool, int n, int grain, parallel_for_fn fn, void *ctx) {
+    if (n <= 0) return;
+    int n_threads = thread_pool_size(pool);
+    if (grain <= 0) {
+        // A few chunks per thread leaves room to rebalance
+        grain = n / (4 * n_threads);
+        if (grain < 1) grain = 1;
+    }
+    int n_chunks = (int)(((long long)n + grain - 1) / grain);
+    ParallelForTask task = { pool ? pool->queues : NULL, n, grain, fn, ctx };
+    if (n_chunks == 1 || !thread_pool_acquire(pool)) {
+        thread_pool_depth++;
+        for (int c = 0; c < n_chunks; c++) parallel_for_chunk(&task, (uint32_t)c, 0);
+        thread_pool_depth--;
+        return;
+    }
+
+    for (int t = 0; t < n_threads; t++) {
+        int begin, end;
+        thread_partition(n_chunks, t, n_threads, &begin, &end);
+        task.queues[t].range = (uint64_t)end << 32 | (uint32_t)begin;
+    }
+    // The dispatch mutex publishes the queues to the workers
+    thread_pool_dispatch(pool, parallel_for_worker, &task);
+}
+
+typedef struct {
+    parallel_map_fn map;
+    void *ctx;
+    char *partials;
+    size_t stride;
+    int n;
+    int grain;
+} ParallelReduceTask;
+
+static void parallel_reduce_chunks(void *ctx, int begin, int end, int thread_id) {
+    ParallelReduceTask *task = ctx;
+    (void)thread_id;
+    for (int c = begin; c < end; c++) {
+        long long row_begin = (long long)c * task->grain;
+        long long row_end = row_begin + task->grain < task->n ? row_begin + task->grain : task->n;
+        task->map(task->ctx, (int)row_begin, (int)row_end, task->partials + c * task->stride);
+    }
+}
+
+ml_error_t parallel_reduce(ThreadPool *pool, int n, int grain, size_t value_size,
+                           parallel_map_fn map, parallel_combine_fn combine, void *ctx, void *result) {
+    ML_CHECK_NULL(map);
+    ML_CHECK_NULL(combine);
+    ML_CHECK_NULL(result);
+    if (n < 0 || value_size == 0) return ML_ERROR_INVALID_PARAMETER;
+    memset(result, 0, value_size);
+    if (n == 0) return ML_SUCCESS;
+
+    if (grain <= 0) grain = 1;
+    long long min_grain = ((long long)n + PARALLEL_REDUCE_MAX_CHUNKS - 1) / PARALLEL_REDUCE_MAX_CHUNKS;
+    if (grain < min_grain) grain = (int)min_grain;
+    int n_chunks = (int)(((long long)n + grain - 1) / grain);
+    if (n_chunks == 1) {
+        thread_pool_depth++;
+        map(ctx, 0, n, result);
+        thread_pool_depth--;
+        return ML_SUCCESS;
+    }
+
+    // Partials on separate cache lines, zeroed as map expects
+    size_t stride = (value_size + ML_ALIGNMENT - 1) / ML_ALIGNMENT * ML_ALIGNMENT;
+    void *partials = NULL;
+    if (posix_memalign(&partials, ML_ALIGNMENT, n_chunks * stride) != 0) return ML_ERROR_MEMORY_ALLOCATION;
+    memset(partials, 0, n_chunks * stride);
+
+    ParallelReduceTask task = { map, ctx, partials, stride, n, grain };
+    parallel_for(pool, n_chunks, 1, parallel_reduce_chunks, &task);
+    memcpy(result, partials, value_size);
+    for (int c = 1; c < n_chunks; c++) combine(ctx, result, task.partials + c * stride);
+    free(partials);
+    return ML_SUCCESS;
+}
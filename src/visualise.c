@@ -1,4 +1,4 @@
-#include "visualize.h"
+#include "visualise.h"
 #include <stdio.h>
 
 void visualize_clusters(const Matrix *data, const Matrix *labels, const Matrix *centroids) {
@@ -8,8 +8,8 @@ void visualize_clusters(const Matrix *data, const Matrix *labels, const Matrix *
     }
     char grid[20][20] = {0};  // 20x20 grid
     for (int i = 0; i < data->rows; i++) {
-        int x = (int)(data->data[i * 2] * 19);  
-        int y = (int)(data->data[i * 2 + 1] * 19);
+        int x = (int)(matrix_row(data, i)[0] * 19);  
+        int y = (int)(matrix_row(data, i)[1] * 19);
         if (x >= 0 && x < 20 && y >= 0 && y < 20) {
             grid[y][x] = '0' + (int)labels->data[i];  // cluster label
         }
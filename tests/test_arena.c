@@ -0,0 +1,107 @@
+#include "arena.h"
+#include "matrix.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+static bool is_aligned(const void *p) {
+    return ((uintptr_t)p) % ML_ALIGNMENT == 0;
+}
+
+void test_arena_alloc_aligned() {
+    Arena *arena = arena_create(1024);
+    ASSERT(arena != NULL);
+    char *a = arena_alloc(arena, 1);
+    char *b = arena_alloc(arena, 100);
+    double *c = arena_calloc(arena, 7, sizeof(double));
+    ASSERT(is_aligned(a) && is_aligned(b) && is_aligned(c));
+    ASSERT(b - a == ML_ALIGNMENT);  // 1 byte still takes a full line
+    ASSERT(c[0] == 0.0 && c[6] == 0.0);
+    ASSERT(arena_used(arena) == 64 + 128 + 64);
+    arena_free(arena);
+}
+
+// Rolling back to a mark hands the same memory out again
+void test_arena_mark_release() {
+    Arena *arena = arena_create(0);
+    arena_alloc(arena, 256);
+    ArenaMark mark = arena_mark(arena);
+    void *first = arena_alloc(arena, 512);
+    arena_release(arena, mark);
+    ASSERT(arena_alloc(arena, 512) == first);
+    ASSERT(arena_used(arena) == 768);
+    arena_free(arena);
+}
+
+// Overflowing the first chunk chains more; reset merges them into one chunk
+// big enough for the whole round
+void test_arena_grow_and_reset() {
+    Arena *arena = arena_create(0);
+    size_t initial = arena_capacity(arena);
+    for (int i = 0; i < 10; i++) {
+        double *p = arena_alloc(arena, initial / 2);
+        ASSERT(p != NULL && is_aligned(p));
+        p[0] = i;
+    }
+    size_t grown = arena_capacity(arena);
+    ASSERT(grown > initial);
+
+    arena_reset(arena);
+    ASSERT(arena_used(arena) == 0);
+    ASSERT(arena_capacity(arena) == grown);
+    void *base = arena_alloc(arena, initial / 2);
+    for (int i = 1; i < 10; i++) arena_alloc(arena, initial / 2);
+    ASSERT(arena_capacity(arena) == grown);  // the second round fit without growing
+    arena_reset(arena);
+    ASSERT(arena_alloc(arena, 1) == base);
+    arena_free(arena);
+}
+
+void test_matrix_allocation() {
+    Matrix *m = matrix_create(3, 5);
+    ASSERT(is_aligned(m->data));
+    ASSERT(m->data[14] == 0.0 && !m->in_arena && !m->owns_data);
+    matrix_free(m);
+
+    double *buf = malloc(6 * sizeof(double));
+    Matrix *owned = matrix_create_from_buffer(buf, 2, 3);
+    ASSERT(owned->data == buf && owned->owns_data);
+    matrix_free(owned);  // frees buf as well
+
+    Arena *arena = arena_create(0);
+    Matrix *tmp = matrix_create_in(arena, 4, 4);
+    ASSERT(tmp != NULL && tmp->in_arena && is_aligned(tmp->data));
+    ASSERT(tmp->data[15] == 0.0);
+    Matrix *id = matrix_create_identity(4);
+    ASSERT(matrix_multiply(id, id, tmp) == ML_SUCCESS && tmp->data[5] == 1.0);
+    matrix_free(tmp);  // no-op, the arena owns it
+    matrix_free(id);
+    arena_reset(arena);
+    arena_free(arena);
+}
+
+void test_thread_scratch() {
+    Arena *scratch = arena_thread_scratch();
+    ASSERT(scratch != NULL && scratch == arena_thread_scratch());
+    ArenaMark mark = arena_mark(scratch);
+    ASSERT(is_aligned(arena_alloc(scratch, 1000)));
+    arena_release(scratch, mark);
+    ASSERT(arena_used(scratch) == mark.used);
+}
+
+int main() {
+    TEST(test_arena_alloc_aligned);
+    TEST(test_arena_mark_release);
+    TEST(test_arena_grow_and_reset);
+    TEST(test_matrix_allocation);
+    TEST(test_thread_scratch);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
@@ -0,0 +1,408 @@
+#include "dataset.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+// Write contents to a fresh temporary file; the caller unlinks path
+static void write_temp_file(char *path, const char *contents) {
+    strcpy(path, "/tmp/test_dataset_XXXXXX");
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE *f = fdopen(fd, "w");
+    fputs(contents, f);
+    fclose(f);
+}
+
+void test_load_csv_basic() {
+    char path[64];
+    write_temp_file(path, "1,2,3\n4.5,-6,7e2\r\n\n0.000123,+8,  9  \n1.5");
+    Matrix *m = load_csv(path);
+    unlink(path);
+
+    ASSERT(m != NULL);
+    ASSERT(m->rows == 4 && m->cols == 3);
+    double expected[] = {1, 2, 3, 4.5, -6, 700, 0.000123, 8, 9, 1.5, 0, 0};
+    for (int i = 0; i < 12; i++) {
+        ASSERT(m->data[i] == expected[i]);
+    }
+    matrix_free(m);
+}
+
+void test_load_csv_long_lines() {
+    // Rows far wider than the old 1024-byte line buffer
+    int cols = 500;
+    size_t cap = (size_t)cols * 3 * 32;
+    char *contents = malloc(cap);
+    size_t len = 0;
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < cols; c++) {
+            len += snprintf(contents + len, cap - len, "%s%.17g", c ? "," : "", r * 1000.0 + c / 7.0);
+        }
+        contents[len++] = '\n';
+    }
+    contents[len] = '\0';
+
+    char path[64];
+    write_temp_file(path, contents);
+    Matrix *m = load_csv(path);
+    unlink(path);
+
+    ASSERT(m != NULL && m->rows == 3 && m->cols == cols);
+    for (int r = 0; r < 3 && m; r++) {
+        for (int c = 0; c < cols; c++) {
+            if (m->data[r * cols + c] != r * 1000.0 + c / 7.0) {
+                ASSERT(m->data[r * cols + c] == r * 1000.0 + c / 7.0);
+                break;
+            }
+        }
+    }
+    matrix_free(m);
+    free(contents);
+}
+
+void test_load_csv_matches_strtod() {
+    // Exercise both the fast path and the strtod fallback
+    const char *fields[] = {
+        "3.141592653589793", "1e-300", "123456789012345678901234", "-0", "2.2250738585072014e-308",
+        "9007199254740993", "0.1", "1e22", "1e23", "inf", "abc", "", "17.",
+    };
+    int n = sizeof(fields) / sizeof(fields[0]);
+    char contents[512] = "";
+    for (int i = 0; i < n; i++) {
+        strcat(contents, fields[i]);
+        strcat(contents, i + 1 < n ? "," : "\n");
+    }
+
+    char path[64];
+    write_temp_file(path, contents);
+    Matrix *m = load_csv(path);
+    unlink(path);
+
+    ASSERT(m != NULL && m->rows == 1 && m->cols == n);
+    for (int i = 0; i < n && m; i++) {
+        double expected = strtod(fields[i], NULL);
+        ASSERT(memcmp(&m->data[i], &expected, sizeof(double)) == 0);
+    }
+    matrix_free(m);
+}
+
+void test_load_csv_missing_or_empty() {
+    ASSERT(load_csv("/nonexistent/file.csv") == NULL);
+
+    char path[64];
+    write_temp_file(path, "");
+    ASSERT(load_csv(path) == NULL);
+    unlink(path);
+
+    write_temp_file(path, "\n\n  \n");
+    ASSERT(load_csv(path) == NULL);
+    unlink(path);
+}
+
+void test_load_csv_parallel_matches_serial() {
+    // Mixed line lengths, blank lines and no trailing newline put the
+    // chunk boundaries in awkward places
+    size_t cap = 1 << 16;
+    char *contents = malloc(cap);
+    size_t len = 0;
+    srand(3);
+    for (int r = 0; r < 400; r++) {
+        int width = 1 + rand() % 6;
+        for (int c = 0; c < width; c++) {
+            len += snprintf(contents + len, cap - len, "%s%d.%d", c ? "," : "", rand() % 1000, rand() % 100);
+        }
+        if (r % 37 == 0) contents[len++] = '\n';
+        if (r + 1 < 400) contents[len++] = '\n';
+    }
+    contents[len] = '\0';
+
+    char path[64];
+    write_temp_file(path, contents);
+    Matrix *serial = load_csv(path);
+    ASSERT(serial != NULL && serial->rows == 400);
+    for (int threads = 1; threads <= 9 && serial; threads++) {
+        Matrix *m = load_csv_parallel(path, threads);
+        ASSERT(m != NULL && m->rows == serial->rows && m->cols == serial->cols);
+        if (m) ASSERT(memcmp(m->data, serial->data, serial->rows * serial->cols * sizeof(double)) == 0);
+        matrix_free(m);
+    }
+    Matrix *many = load_csv_parallel(path, 1000);  // more threads than lines
+    ASSERT(many != NULL && many->rows == 400);
+    matrix_free(many);
+    unlink(path);
+
+    matrix_free(serial);
+    free(contents);
+}
+
+void test_dataset_binary_roundtrip() {
+    Dataset *dataset = dataset_create(5, 3, 1);
+    ASSERT(dataset != NULL);
+    for (int i = 0; i < 15; i++) dataset->features->data[i] = i * 0.5 - 2.0;
+    for (int i = 0; i < 5; i++) dataset->targets->data[i] = i % 2;
+    const char *names[] = {"sepal_length", "sepal_width", "petal_length", "species"};
+    dataset->feature_names = malloc(3 * sizeof(char*));
+    dataset->target_names = malloc(sizeof(char*));
+    for (int i = 0; i < 3; i++) dataset->feature_names[i] = strdup(names[i]);
+    dataset->target_names[0] = strdup(names[3]);
+
+    char path[64];
+    write_temp_file(path, "");
+    ASSERT(dataset_save_binary(dataset, path) == ML_SUCCESS);
+
+    Dataset *loaded = dataset_load_binary(path, true);
+    ASSERT(loaded != NULL);
+    if (loaded) {
+        ASSERT(loaded->n_samples == 5 && loaded->n_features == 3 && loaded->n_targets == 1);
+        ASSERT(loaded->features->is_view && loaded->targets->is_view);
+        ASSERT(((uintptr_t)loaded->features->data) % 64 == 0);
+        ASSERT(memcmp(loaded->features->data, dataset->features->data, 15 * sizeof(double)) == 0);
+        ASSERT(memcmp(loaded->targets->data, dataset->targets->data, 5 * sizeof(double)) == 0);
+        ASSERT(strcmp(loaded->feature_names[2], "petal_length") == 0);
+        ASSERT(strcmp(loaded->target_names[0], "species") == 0);
+
+        // Writes go to private copies of the pages, never back to the file
+        loaded->features->data[0] = 42.0;
+        Dataset *again = dataset_load_binary(path, true);
+        ASSERT(again != NULL && again->features->data[0] == -2.0);
+
+        // Saving over the file swaps in a new inode; existing mappings keep the old data
+        ASSERT(dataset_save_binary(loaded, path) == ML_SUCCESS);
+        ASSERT(again != NULL && again->features->data[0] == -2.0 && again->features->data[14] == 5.0);
+        Dataset *replaced = dataset_load_binary(path, true);
+        ASSERT(replaced != NULL && replaced->features->data[0] == 42.0);
+        dataset_free(replaced);
+        dataset_free(again);
+    }
+    dataset_free(loaded);
+    dataset_free(dataset);
+    unlink(path);
+}
+
+void test_dataset_binary_rejects_corruption() {
+    Dataset *dataset = dataset_create(4, 2, 0);
+    for (int i = 0; i < 8; i++) dataset->features->data[i] = i;
+    char path[64];
+    write_temp_file(path, "");
+    ASSERT(dataset_save_binary(dataset, path) == ML_SUCCESS);
+
+    // Flip one payload byte: only the checksum pass notices
+    FILE *f = fopen(path, "r+b");
+    fseek(f, 128 + 8, SEEK_SET);
+    fputc(0x7F, f);
+    fclose(f);
+    Dataset *unchecked = dataset_load_binary(path, false);
+    ASSERT(unchecked != NULL);
+    dataset_free(unchecked);
+    ASSERT(dataset_load_binary(path, true) == NULL);
+
+    // A damaged header is always rejected
+    f = fopen(path, "r+b");
+    fseek(f, 24, SEEK_SET);
+    fputc(0x7F, f);
+    fclose(f);
+    ASSERT(dataset_load_binary(path, false) == NULL);
+
+    // CSV text is not mistaken for the binary format
+    write_temp_file(path, "1,2,3\n");
+    ASSERT(dataset_load_binary(path, false) == NULL);
+    unlink(path);
+    dataset_free(dataset);
+}
+
+// A contiguous run of columns is a zero-copy view; other selections gather.
+// Either way the result saves like a dense dataset.
+void test_dataset_select_features() {
+    Dataset *dataset = dataset_create(4, 5, 1);
+    for (int i = 0; i < 20; i++) dataset->features->data[i] = i;
+    for (int i = 0; i < 4; i++) dataset->targets->data[i] = i;
+
+    int run[] = {1, 2, 3};
+    Dataset *view = NULL;
+    ASSERT(dataset_select_features(dataset, run, 3, &view) == ML_SUCCESS);
+    ASSERT(view->n_features == 3 && view->features->is_view);
+    ASSERT(view->features->data == dataset->features->data + 1);
+    ASSERT(matrix_get(view->features, 2, 0) == 11.0);
+
+    int scattered[] = {4, 0};
+    Dataset *gathered = NULL;
+    ASSERT(dataset_select_features(dataset, scattered, 2, &gathered) == ML_SUCCESS);
+    ASSERT(!gathered->features->is_view);
+    ASSERT(matrix_get(gathered->features, 1, 0) == 9.0 && matrix_get(gathered->features, 1, 1) == 5.0);
+
+    int bad[] = {5};
+    Dataset *none = NULL;
+    ASSERT(dataset_select_features(dataset, bad, 1, &none) == ML_ERROR_INVALID_PARAMETER && none == NULL);
+
+    char path[64];
+    write_temp_file(path, "");
+    ASSERT(dataset_save_binary(view, path) == ML_SUCCESS);
+    Dataset *loaded = dataset_load_binary(path, true);
+    ASSERT(loaded != NULL && loaded->n_features == 3);
+    if (loaded) {
+        ASSERT(loaded->features->data[3] == 6.0 && loaded->features->data[11] == 18.0);
+    }
+    dataset_free(loaded);
+    unlink(path);
+
+    dataset_free(view);
+    dataset_free(gathered);
+    dataset_free(dataset);
+}
+
+// Reference statistics the slow way: column by column, two passes
+static void reference_column_stats(const Matrix *m, int j, double *mean, double *std, double *min, double *max) {
+    double sum = 0.0;
+    *min = *max = matrix_get(m, 0, j);
+    for (int i = 0; i < m->rows; i++) {
+        double v = matrix_get(m, i, j);
+        sum += v;
+        if (v < *min) *min = v;
+        if (v > *max) *max = v;
+    }
+    *mean = sum / m->rows;
+    double ss = 0.0;
+    for (int i = 0; i < m->rows; i++) {
+        double d = matrix_get(m, i, j) - *mean;
+        ss += d * d;
+    }
+    *std = sqrt(ss / m->rows);
+}
+
+// Enough rows to span several statistics blocks, with a large offset on
+// one column so a naive sum-of-squares variance would lose precision
+void test_dataset_normalization_stats() {
+    int rows = 20000, cols = 7;
+    Dataset *dataset = dataset_create(rows, cols, 0);
+    srand(11);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double v = (double)rand() / RAND_MAX * (j + 1) - j;
+            if (j == 2) v += 1e8;
+            if (j == 5) v = 4.0;  // constant
+            matrix_set(dataset->features, i, j, v);
+        }
+    }
+
+    NormalizationParams *params = NULL;
+    ASSERT(dataset_fit_normalization(dataset, NORMALIZE_ZSCORE, &params) == ML_SUCCESS);
+    ASSERT(params != NULL && params->n_features == cols);
+    for (int j = 0; j < cols && params; j++) {
+        double mean, std, min, max;
+        reference_column_stats(dataset->features, j, &mean, &std, &min, &max);
+        ASSERT(fabs(params->means[j] - mean) <= 1e-9 * fmax(1.0, fabs(mean)));
+        ASSERT(fabs(params->stds[j] - std) <= 1e-7 * fmax(1.0, std));
+        ASSERT(params->mins[j] == min && params->maxs[j] == max);
+    }
+
+    ASSERT(dataset_apply_normalization(dataset, params) == ML_SUCCESS);
+    for (int j = 0; j < cols; j++) {
+        double mean, std, min, max;
+        reference_column_stats(dataset->features, j, &mean, &std, &min, &max);
+        // Column 2's mean is only known to a few ulps of 1e8
+        ASSERT(fabs(mean) < (j == 2 ? 1e-6 : 1e-12));
+        ASSERT(j == 5 ? std == 0.0 : fabs(std - 1.0) < 1e-9);
+    }
+
+    Dataset *narrow = dataset_create(3, 2, 0);
+    ASSERT(dataset_apply_normalization(narrow, params) == ML_ERROR_DIMENSION_MISMATCH);
+    dataset_free(narrow);
+    normalization_params_free(params);
+    dataset_free(dataset);
+}
+
+// Min-max into a custom range through a strided column view; the columns
+// outside the view must not be touched
+void test_dataset_minmax_scale_view() {
+    Dataset *dataset = dataset_create(5, 4, 0);
+    for (int i = 0; i < 20; i++) dataset->features->data[i] = i;
+    for (int i = 0; i < 5; i++) matrix_set(dataset->features, i, 2, 3.0);
+
+    int run[] = {1, 2};
+    Dataset *view = NULL;
+    ASSERT(dataset_select_features(dataset, run, 2, &view) == ML_SUCCESS);
+    NormalizationParams *params = NULL;
+    ASSERT(dataset_minmax_scale(view, -1.0, 1.0, &params) == ML_SUCCESS);
+    ASSERT(params && params->type == NORMALIZE_MINMAX && params->range_min == -1.0);
+    for (int i = 0; i < 5; i++) {
+        ASSERT(fabs(matrix_get(dataset->features, i, 1) - (-1.0 + 0.5 * i)) < 1e-12);
+        ASSERT(matrix_get(dataset->features, i, 2) == -1.0);  // constant column
+        ASSERT(matrix_get(dataset->features, i, 0) == 4.0 * i);
+        ASSERT(matrix_get(dataset->features, i, 3) == 4.0 * i + 3);
+    }
+    ASSERT(dataset_minmax_scale(view, 1.0, 1.0, NULL) == ML_ERROR_INVALID_PARAMETER);
+
+    normalization_params_free(params);
+    dataset_free(view);
+    dataset_free(dataset);
+}
+
+// normalize_matrix keeps its old contract: [0, 1] per column, constant
+// columns unchanged, however small the range of the others
+void test_normalize_matrix() {
+    Matrix *m = matrix_create(3, 3);
+    double values[] = { 2.0, 7.0, 0.0, 4.0, 7.0, 1e-12, 6.0, 7.0, 2e-12 };
+    memcpy(m->data, values, sizeof(values));
+    normalize_matrix(m);
+    ASSERT(matrix_get(m, 0, 0) == 0.0 && matrix_get(m, 1, 0) == 0.5 && matrix_get(m, 2, 0) == 1.0);
+    ASSERT(matrix_get(m, 0, 1) == 7.0 && matrix_get(m, 2, 1) == 7.0);
+    ASSERT(matrix_get(m, 0, 2) == 0.0 && fabs(matrix_get(m, 1, 2) - 0.5) < 1e-12 && matrix_get(m, 2, 2) == 1.0);
+    matrix_free(m);
+
+    // Bit for bit (x - min) / range: 49 * (1 / 49) would round below 1
+    m = matrix_create(50, 1);
+    for (int i = 0; i < 50; i++) m->data[i] = i + 3.0;
+    normalize_matrix(m);
+    bool exact = true;
+    for (int i = 0; i < 50; i++) exact = exact && m->data[i] == i / 49.0;
+    ASSERT(exact && m->data[49] == 1.0);
+    matrix_free(m);
+}
+
+// The dataset API judges constant columns relative to their magnitude:
+// tiny-scale features are still standardized, while a 1e8 column with a
+// rounding-level spread is only centred
+void test_dataset_normalize_small_scale() {
+    Dataset *dataset = dataset_create(4, 2, 0);
+    double small[] = { 1e-12, 3e-12, 2e-12, 4e-12 };
+    for (int i = 0; i < 4; i++) {
+        matrix_set(dataset->features, i, 0, small[i]);
+        matrix_set(dataset->features, i, 1, i % 2 ? 1e8 : nextafter(1e8, 2e8));
+    }
+    ASSERT(dataset_standardize(dataset, NULL) == ML_SUCCESS);
+    double mean, std, min, max;
+    reference_column_stats(dataset->features, 0, &mean, &std, &min, &max);
+    ASSERT(fabs(mean) < 1e-12 && fabs(std - 1.0) < 1e-9);
+    reference_column_stats(dataset->features, 1, &mean, &std, &min, &max);
+    ASSERT(max - min < 1e-7);  // only centred, not blown up to unit variance
+
+    for (int i = 0; i < 4; i++) matrix_set(dataset->features, i, 0, small[i]);
+    ASSERT(dataset_minmax_scale(dataset, 0.0, 1.0, NULL) == ML_SUCCESS);
+    ASSERT(matrix_get(dataset->features, 0, 0) == 0.0 && matrix_get(dataset->features, 3, 0) == 1.0);
+    dataset_free(dataset);
+}
+
+int main() {
+    TEST(test_load_csv_basic);
+    TEST(test_load_csv_long_lines);
+    TEST(test_load_csv_matches_strtod);
+    TEST(test_load_csv_missing_or_empty);
+    TEST(test_load_csv_parallel_matches_serial);
+    TEST(test_dataset_binary_roundtrip);
+    TEST(test_dataset_binary_rejects_corruption);
+    TEST(test_dataset_select_features);
+    TEST(test_dataset_normalization_stats);
+    TEST(test_dataset_minmax_scale_view);
+    TEST(test_normalize_matrix);
+    TEST(test_dataset_normalize_small_scale);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
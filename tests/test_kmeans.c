@@ -0,0 +1,366 @@
+#include "kmeans.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <assert.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+// n points per blob around (0,0), (10,10) and (0,10), interleaved so the
+// first three rows seed one centroid per blob
+static Matrix* make_blobs(int n) {
+    Matrix *data = matrix_create(3 * n, 2);
+    double centers[3][2] = {{0.0, 0.0}, {10.0, 10.0}, {0.0, 10.0}};
+    srand(42);
+    for (int i = 0; i < 3 * n; i++) {
+        int c = i % 3;
+        data->data[i * 2] = centers[c][0] + (double)rand() / RAND_MAX - 0.5;
+        data->data[i * 2 + 1] = centers[c][1] + (double)rand() / RAND_MAX - 0.5;
+    }
+    return data;
+}
+
+static KMeans* fit_blobs(const Matrix *data, int n_threads) {
+    KMeans *km = kmeans_create(3, data->cols);
+    km->n_threads = n_threads;
+    kmeans_fit(km, data, 100);
+    return km;
+}
+
+void test_kmeans_create_free() {
+    KMeans *km = kmeans_create(4, 3);
+    ASSERT(km != NULL);
+    ASSERT(km->k == 4);
+    ASSERT(km->centroids->rows == 4 && km->centroids->cols == 3);
+    ASSERT(km->n_threads == 1);
+    kmeans_free(km);
+}
+
+void test_kmeans_fit_predict() {
+    Matrix *data = make_blobs(100);
+    KMeans *km = fit_blobs(data, 1);
+    Matrix *labels = kmeans_predict(km, data);
+
+    ASSERT(labels != NULL);
+    // Each blob maps to its own cluster, whatever the label numbering
+    int blob_label[3] = {km->assignments[0], km->assignments[1], km->assignments[2]};
+    ASSERT(blob_label[0] != blob_label[1] && blob_label[1] != blob_label[2] && blob_label[0] != blob_label[2]);
+    for (int i = 0; i < data->rows; i++) {
+        ASSERT(labels->data[i] == (double)blob_label[i % 3]);
+        ASSERT(km->assignments[i] == blob_label[i % 3]);
+    }
+    ASSERT(fabs(km->centroids->data[blob_label[1] * 2] - 10.0) < 0.2);
+    ASSERT(km->n_iter >= 1 && km->inertia > 0.0);
+
+    matrix_free(labels);
+    kmeans_free(km);
+    matrix_free(data);
+}
+
+void test_kmeans_fit_threaded_deterministic() {
+    Matrix *data = make_blobs(1000);
+    KMeans *serial = fit_blobs(data, 1);
+    KMeans *a = fit_blobs(data, 4);
+    KMeans *b = fit_blobs(data, 4);
+
+    int k_features = a->k * data->cols;
+    ASSERT(memcmp(a->centroids->data, b->centroids->data, k_features * sizeof(double)) == 0);
+    ASSERT(memcmp(a->assignments, b->assignments, data->rows * sizeof(int)) == 0);
+    ASSERT(memcmp(a->assignments, serial->assignments, data->rows * sizeof(int)) == 0);
+    for (int i = 0; i < k_features; i++) {
+        ASSERT(fabs(a->centroids->data[i] - serial->centroids->data[i]) < 1e-9);
+    }
+
+    // A shared pool of the same size gives the same fit as a dedicated one
+    ThreadPool *pool = thread_pool_create(4);
+    KMeans *shared = kmeans_create(3, data->cols);
+    shared->pool = pool;
+    kmeans_fit(shared, data, 100);
+    ASSERT(memcmp(shared->centroids->data, a->centroids->data, k_features * sizeof(double)) == 0);
+    kmeans_free(shared);
+    thread_pool_free(pool);
+
+    kmeans_free(serial);
+    kmeans_free(a);
+    kmeans_free(b);
+    matrix_free(data);
+}
+
+static void check_algorithm_matches_lloyd(kmeans_algorithm_t algorithm, int k, int n_threads) {
+    Matrix *data = test_random_matrix(2000, 4, 0.0, 1.0, 7);
+    KMeans *lloyd = kmeans_create(k, data->cols);
+    KMeans *fast = kmeans_create(k, data->cols);
+    fast->algorithm = algorithm;
+    fast->n_threads = n_threads;
+    kmeans_fit(lloyd, data, 50);
+    kmeans_fit(fast, data, 50);
+
+    ASSERT(memcmp(lloyd->assignments, fast->assignments, data->rows * sizeof(int)) == 0);
+    for (int i = 0; i < k * data->cols; i++) {
+        ASSERT(fabs(lloyd->centroids->data[i] - fast->centroids->data[i]) < 1e-9);
+    }
+
+    // Pruned predict agrees with the brute-force scan
+    Matrix *expected = kmeans_predict(lloyd, data);
+    Matrix *labels = kmeans_predict(fast, data);
+    ASSERT(memcmp(expected->data, labels->data, data->rows * sizeof(double)) == 0);
+
+    matrix_free(expected);
+    matrix_free(labels);
+    kmeans_free(lloyd);
+    kmeans_free(fast);
+    matrix_free(data);
+}
+
+void test_kmeans_hamerly_matches_lloyd() {
+    check_algorithm_matches_lloyd(KMEANS_HAMERLY, 5, 1);
+    check_algorithm_matches_lloyd(KMEANS_HAMERLY, 12, 3);
+}
+
+void test_kmeans_elkan_matches_lloyd() {
+    check_algorithm_matches_lloyd(KMEANS_ELKAN, 5, 1);
+    check_algorithm_matches_lloyd(KMEANS_ELKAN, 40, 3);
+    check_algorithm_matches_lloyd(KMEANS_AUTO, 40, 2);
+}
+
+// Blobs stored one after another, the layout first-k seeding handles worst
+static Matrix* make_sorted_blobs(int n) {
+    Matrix *interleaved = make_blobs(n);
+    Matrix *data = matrix_create(3 * n, 2);
+    for (int i = 0; i < 3 * n; i++) {
+        int dst = (i % 3) * n + i / 3;
+        data->data[dst * 2] = interleaved->data[i * 2];
+        data->data[dst * 2 + 1] = interleaved->data[i * 2 + 1];
+    }
+    matrix_free(interleaved);
+    return data;
+}
+
+static void check_seeding_finds_blobs(kmeans_init_t init) {
+    Matrix *data = make_sorted_blobs(500);
+    KMeans *a = kmeans_create(3, 2);
+    KMeans *b = kmeans_create(3, 2);
+    a->init = b->init = init;
+    a->seed = b->seed = 1234;
+    b->n_threads = 3;
+    kmeans_fit(a, data, 100);
+    kmeans_fit(b, data, 100);
+
+    // Points are within 0.5 of their blob centre, so a good seeding
+    // leaves at most 0.5 squared error per point
+    ASSERT(a->inertia < 0.5 * data->rows);
+    ASSERT(memcmp(a->assignments, b->assignments, data->rows * sizeof(int)) == 0);
+    ASSERT(fabs(a->inertia - b->inertia) < 1e-9);
+
+    kmeans_free(a);
+    kmeans_free(b);
+    matrix_free(data);
+}
+
+void test_kmeans_init_plusplus() {
+    check_seeding_finds_blobs(KMEANS_INIT_PLUSPLUS);
+}
+
+void test_kmeans_init_parallel() {
+    check_seeding_finds_blobs(KMEANS_INIT_PARALLEL);
+}
+
+void test_kmeans_init_first_k() {
+    Matrix *data = make_blobs(10);
+    KMeans *km = kmeans_create(3, 2);
+    km->init = KMEANS_INIT_FIRST_K;
+    kmeans_fit(km, data, 100);
+    for (int i = 0; i < data->rows; i++) {
+        ASSERT(km->assignments[i] == i % 3);
+    }
+    kmeans_free(km);
+    matrix_free(data);
+}
+
+void test_kmeans_partial_fit_stream() {
+    Matrix *data = make_blobs(2000);
+    KMeans *km = kmeans_create(3, data->cols);
+
+    // Feed the stream in batches of 50 rows through views into one buffer
+    for (int start = 0; start < data->rows; start += 50) {
+        Matrix *batch = matrix_view(data, start, 0, 50, data->cols);
+        kmeans_partial_fit(km, batch);
+        matrix_free(batch);
+    }
+
+    double expected[3][2] = {{0.0, 0.0}, {10.0, 10.0}, {0.0, 10.0}};
+    double total = 0.0;
+    for (int c = 0; c < 3; c++) {
+        ASSERT(fabs(km->centroids->data[c * 2] - expected[c][0]) < 0.1);
+        ASSERT(fabs(km->centroids->data[c * 2 + 1] - expected[c][1]) < 0.1);
+        total += km->centroid_counts[c];
+    }
+    ASSERT(total == data->rows);
+
+    // Labels of the last batch are kept in assignments
+    for (int i = 0; i < 50; i++) {
+        ASSERT(km->assignments[i] == (data->rows - 50 + i) % 3);
+    }
+
+    kmeans_free(km);
+    matrix_free(data);
+}
+
+void test_kmeans_partial_fit_small_batches() {
+    // Batches smaller than k still seed the centroids in stream order
+    Matrix *data = make_blobs(10);
+    KMeans *km = kmeans_create(3, data->cols);
+    Matrix *first = matrix_view(data, 0, 0, 2, data->cols);
+    Matrix *rest = matrix_view(data, 2, 0, data->rows - 2, data->cols);
+
+    kmeans_partial_fit(km, first);
+    ASSERT(km->centroid_counts[0] == 1.0 && km->centroid_counts[2] == 0.0);
+    kmeans_partial_fit(km, rest);
+    ASSERT(km->assignments[0] == 2);
+    ASSERT(km->centroid_counts[0] + km->centroid_counts[1] + km->centroid_counts[2] == data->rows);
+
+    matrix_free(first);
+    matrix_free(rest);
+    kmeans_free(km);
+    matrix_free(data);
+}
+
+// kmeans_fit can leave a cluster empty; partial_fit seeds only that slot
+// and leaves the trained centroids and their counts alone
+void test_kmeans_partial_fit_after_empty_cluster() {
+    // Three distinct points for four clusters, the first one repeated in the
+    // first two rows: centroids 0 and 1 coincide and 1 never wins a row
+    double points[] = {0, 0, 5, 0, 0, 5};
+    Matrix *data = matrix_create(30, 2);
+    for (int i = 0; i < 30; i++) memcpy(matrix_row(data, i), points + (i < 2 ? 0 : (i - 1) % 3) * 2, 2 * sizeof(double));
+    KMeans *km = kmeans_create(4, 2);
+    km->init = KMEANS_INIT_FIRST_K;
+    kmeans_fit(km, data, 10);
+    int empty = -1;
+    for (int c = 0; c < 4; c++) {
+        if (km->centroid_counts[c] == 0.0) empty = c;
+    }
+    ASSERT(empty == 1);
+    if (empty < 0) {
+        kmeans_free(km);
+        matrix_free(data);
+        return;
+    }
+    double centroids[8], counts[4];
+    memcpy(centroids, km->centroids->data, sizeof(centroids));
+    memcpy(counts, km->centroid_counts, sizeof(counts));
+
+    double rows[] = {9, 9, 0.1, 0};
+    Matrix *batch = matrix_create_from_array(rows, 2, 2);
+    kmeans_partial_fit(km, batch);
+    ASSERT(km->assignments[0] == empty && km->centroid_counts[empty] == 1.0);
+    ASSERT(km->centroids->data[empty * 2] == 9.0 && km->centroids->data[empty * 2 + 1] == 9.0);
+    int near = km->assignments[1];
+    ASSERT(near != empty && km->centroid_counts[near] == counts[near] + 1.0);
+    for (int c = 0; c < 4; c++) {
+        if (c == empty || c == near) continue;
+        ASSERT(km->centroid_counts[c] == counts[c]);
+        ASSERT(memcmp(km->centroids->data + c * 2, centroids + c * 2, 2 * sizeof(double)) == 0);
+    }
+
+    matrix_free(batch);
+    kmeans_free(km);
+    matrix_free(data);
+}
+
+// Fitting on a column window of a wider buffer matches fitting on a dense copy
+void test_kmeans_strided_view() {
+    Matrix *data = make_blobs(50);
+    Matrix *wide = matrix_create(data->rows, 5);
+    for (int i = 0; i < data->rows; i++) {
+        matrix_row(wide, i)[2] = data->data[i * 2];
+        matrix_row(wide, i)[3] = data->data[i * 2 + 1];
+    }
+    Matrix *view = matrix_view(wide, 0, 2, data->rows, 2);
+
+    KMeans *dense = fit_blobs(data, 1);
+    KMeans *strided = fit_blobs(view, 2);
+    ASSERT(memcmp(dense->assignments, strided->assignments, data->rows * sizeof(int)) == 0);
+    ASSERT(fabs(dense->inertia - strided->inertia) < 1e-9);
+
+    kmeans_free(dense);
+    kmeans_free(strided);
+    matrix_free(view);
+    matrix_free(wide);
+    matrix_free(data);
+}
+
+// Wide rows and enough centroids to span several tiles and row blocks;
+// both the tiled and the pruned paths agree with the single-row scan
+void test_kmeans_predict_into() {
+    Matrix *data = test_random_matrix(150, 300, 0.0, 1.0, 11);
+    KMeans *km = kmeans_create(20, data->cols);
+    kmeans_fit(km, data, 5);
+
+    int labels[150];
+    double distances[150];
+    for (int a = 0; a < 2; a++) {
+        km->algorithm = a == 0 ? KMEANS_LLOYD : KMEANS_ELKAN;
+        ASSERT(kmeans_predict_into(km, data, labels, distances) == ML_SUCCESS);
+        for (int i = 0; i < data->rows; i++) {
+            double sq_dist;
+            ASSERT(labels[i] == kmeans_predict_one(km, matrix_row(data, i), &sq_dist));
+            ASSERT(fabs(distances[i] - sq_dist) < 1e-9);
+        }
+    }
+    ASSERT(kmeans_predict_into(km, data, labels, NULL) == ML_SUCCESS);
+    ASSERT(kmeans_predict_into(km, data, NULL, NULL) == ML_ERROR_NULL_POINTER);
+
+    kmeans_free(km);
+    matrix_free(data);
+}
+
+// Large k and d take the GEMM path in Lloyd; the exact-distance Hamerly
+// scan must land on the same clustering
+void test_kmeans_gemm_matches_exact() {
+    Matrix *data = test_random_matrix(1000, 48, 0.0, 1.0, 13);
+    KMeans *gemm = kmeans_create(24, data->cols);
+    KMeans *exact = kmeans_create(24, data->cols);
+    exact->algorithm = KMEANS_HAMERLY;
+    gemm->n_threads = 2;
+    kmeans_fit(gemm, data, 30);
+    kmeans_fit(exact, data, 30);
+
+    ASSERT(memcmp(gemm->assignments, exact->assignments, data->rows * sizeof(int)) == 0);
+    ASSERT(fabs(gemm->inertia - exact->inertia) < 1e-9 * exact->inertia);
+
+    int labels[1000];
+    double distances[1000];
+    ASSERT(kmeans_predict_into(gemm, data, labels, distances) == ML_SUCCESS);
+    ASSERT(memcmp(labels, gemm->assignments, sizeof(labels)) == 0);
+    double inertia = 0.0;
+    for (int i = 0; i < data->rows; i++) inertia += distances[i];
+    ASSERT(fabs(inertia - gemm->inertia) < 1e-9 * gemm->inertia);
+
+    kmeans_free(gemm);
+    kmeans_free(exact);
+    matrix_free(data);
+}
+
+int main() {
+    TEST(test_kmeans_create_free);
+    TEST(test_kmeans_fit_predict);
+    TEST(test_kmeans_fit_threaded_deterministic);
+    TEST(test_kmeans_hamerly_matches_lloyd);
+    TEST(test_kmeans_elkan_matches_lloyd);
+    TEST(test_kmeans_init_plusplus);
+    TEST(test_kmeans_init_parallel);
+    TEST(test_kmeans_init_first_k);
+    TEST(test_kmeans_partial_fit_stream);
+    TEST(test_kmeans_partial_fit_small_batches);
+    TEST(test_kmeans_partial_fit_after_empty_cluster);
+    TEST(test_kmeans_strided_view);
+    TEST(test_kmeans_predict_into);
+    TEST(test_kmeans_gemm_matches_exact);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
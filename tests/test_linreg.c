@@ -1,12 +1,15 @@
-#include "linreg.h"
+#include "linearreg.h"
+#include "test_util.h"
 #include <stdio.h>
 #include <assert.h>
+#include <math.h>
 
 int tests_run = 0;
 int tests_passed = 0;
+int tests_failed_asserts = 0;
 
-#define TEST(name) do { printf("Running %s...\n", #name); tests_run++; name(); } while (0)
-#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); } else { tests_passed++; } } while (0)
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
 
 void test_linreg_create_free() {
     LinearRegression *lr = linreg_create(3);
@@ -43,9 +46,310 @@ void test_linreg_fit_predict() {
     matrix_free(y);
 }
 
+// y = 2 * x1 + 3 * x2 + 1 with every solver, including the direct ones that
+// ignore the learning rate
+void test_linreg_solvers() {
+    double xs[] = {1, 1, 2, 0, 0, 2, 1, 2, 3, 1, -1, 4};
+    Matrix *X = matrix_create_from_array(xs, 6, 2);
+    Matrix *y = matrix_create(6, 1);
+    for (int i = 0; i < 6; i++) y->data[i] = 2.0 * xs[2 * i] + 3.0 * xs[2 * i + 1] + 1.0;
+
+    linreg_solver_t solvers[] = {LINREG_SOLVER_CHOLESKY, LINREG_SOLVER_QR, LINREG_SOLVER_CG};
+    for (int s = 0; s < 3; s++) {
+        LinearRegression *lr = linreg_create(2);
+        lr->solver = solvers[s];
+        linreg_fit(lr, X, y, 0.0, 100);
+        ASSERT(fabs(lr->weights->data[0] - 2.0) < 1e-8);
+        ASSERT(fabs(lr->weights->data[1] - 3.0) < 1e-8);
+        ASSERT(fabs(lr->bias - 1.0) < 1e-8);
+        ASSERT(lr->n_iter >= 1 && lr->n_iter <= 3);  // CG finishes in at most d + 1 steps
+        linreg_free(lr);
+    }
+
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Duplicated feature makes X^T X singular: Cholesky falls back to QR, which
+// still reproduces y exactly
+void test_linreg_rank_deficient() {
+    Matrix *X = matrix_create(5, 2);
+    Matrix *y = matrix_create(5, 1);
+    for (int i = 0; i < 5; i++) {
+        X->data[i * 2] = i;
+        X->data[i * 2 + 1] = i;
+        y->data[i] = 4.0 * i - 2.0;
+    }
+
+    LinearRegression *lr = linreg_create(2);
+    lr->solver = LINREG_SOLVER_CHOLESKY;
+    linreg_fit(lr, X, y, 0.0, 0);
+    Matrix *pred = linreg_predict(lr, X);
+    for (int i = 0; i < 5; i++) {
+        ASSERT(fabs(pred->data[i] - y->data[i]) < 1e-8);
+    }
+
+    matrix_free(pred);
+    linreg_free(lr);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// A constant column ahead of a real feature, with noisy targets: the
+// vanishing column must not cost the later reflections a row of R. Both
+// direct solvers (Cholesky falls back to QR here) match the simple
+// regression of y on x1.
+void test_linreg_constant_column() {
+    double x1[] = {5, 1, 2, 3, 4, 0};
+    double noise[] = {0.3, -0.2, 0.1, -0.4, 0.25, -0.05};
+    Matrix *X = matrix_create(6, 2);
+    Matrix *y = matrix_create(6, 1);
+    double x_mean = 0.0, y_mean = 0.0;
+    for (int i = 0; i < 6; i++) {
+        X->data[i * 2] = 7.0;
+        X->data[i * 2 + 1] = x1[i];
+        y->data[i] = 3.0 * x1[i] + 1.0 + noise[i];
+        x_mean += x1[i] / 6;
+        y_mean += y->data[i] / 6;
+    }
+    double sxy = 0.0, sxx = 0.0;
+    for (int i = 0; i < 6; i++) {
+        sxy += (x1[i] - x_mean) * (y->data[i] - y_mean);
+        sxx += (x1[i] - x_mean) * (x1[i] - x_mean);
+    }
+    double slope = sxy / sxx, intercept = y_mean - slope * x_mean;
+
+    linreg_solver_t solvers[] = {LINREG_SOLVER_CHOLESKY, LINREG_SOLVER_QR};
+    for (int s = 0; s < 2; s++) {
+        LinearRegression *lr = linreg_create(2);
+        lr->solver = solvers[s];
+        linreg_fit(lr, X, y, 0.0, 0);
+        ASSERT(lr->weights->data[0] == 0.0);
+        ASSERT(fabs(lr->weights->data[1] - slope) < 1e-10);
+        ASSERT(fabs(lr->bias - intercept) < 1e-10);
+        linreg_free(lr);
+    }
+
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Features with a huge offset, like timestamps or IDs: CG centers rows as
+// it reads them, so it agrees with the direct solvers instead of losing
+// every significant digit to the offset
+void test_linreg_cg_large_offset() {
+    int n = 500;
+    Matrix *X = matrix_create(n, 2);
+    Matrix *y = matrix_create(n, 1);
+    srand(11);
+    for (int i = 0; i < n; i++) {
+        double u = (double)rand() / RAND_MAX;
+        X->data[i * 2] = 1e8 + u;
+        X->data[i * 2 + 1] = sin(0.37 * i);
+        y->data[i] = 2.0 * u - 3.0 * X->data[i * 2 + 1] + 0.01 * cos(1.3 * i);
+    }
+
+    linreg_solver_t solvers[] = {LINREG_SOLVER_CG, LINREG_SOLVER_CHOLESKY, LINREG_SOLVER_QR};
+    double w[3][2];
+    for (int s = 0; s < 3; s++) {
+        LinearRegression *lr = linreg_create(2);
+        lr->solver = solvers[s];
+        linreg_fit(lr, X, y, 0.0, 100);
+        ASSERT(isfinite(lr->weights->data[0]) && isfinite(lr->bias));
+        ASSERT(fabs(lr->weights->data[0] - 2.0) < 1e-2 && fabs(lr->weights->data[1] + 3.0) < 1e-2);
+        memcpy(w[s], lr->weights->data, sizeof(w[s]));
+        if (solvers[s] == LINREG_SOLVER_CG) ASSERT(lr->n_iter < 100);
+        linreg_free(lr);
+    }
+    ASSERT(fabs(w[0][0] - w[2][0]) < 1e-6 && fabs(w[0][1] - w[2][1]) < 1e-6);
+
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// CG's stopping test is on the mean gradient, so repeating every row
+// leaves the iteration count unchanged
+void test_linreg_cg_tol_scale_free() {
+    int n = 300, d = 20;
+    Matrix *base = test_random_matrix(n, d, -0.5, 0.5, 12);
+    int n_iter[2];
+    for (int c = 0; c < 2; c++) {
+        int copies = c ? 16 : 1;
+        Matrix *X = matrix_create(n * copies, d);
+        Matrix *y = matrix_create(n * copies, 1);
+        for (int i = 0; i < n * copies; i++) {
+            memcpy(matrix_row(X, i), matrix_row(base, i % n), d * sizeof(double));
+            y->data[i] = 0.1 * cos(2.1 * (i % n));
+            for (int j = 0; j < d; j++) y->data[i] += (j + 1) * X->data[i * d + j];
+        }
+        LinearRegression *lr = linreg_create(d);
+        lr->solver = LINREG_SOLVER_CG;
+        lr->tol = 1e-4;
+        linreg_fit(lr, X, y, 0.0, 100);
+        n_iter[c] = lr->n_iter;
+        linreg_free(lr);
+        matrix_free(X);
+        matrix_free(y);
+    }
+    ASSERT(n_iter[0] < d && n_iter[0] == n_iter[1]);
+    matrix_free(base);
+}
+
+// GD stops well before max_iters once the gradient vanishes
+void test_linreg_gd_early_stop() {
+    double xs[] = {0, 1, 2, 3};
+    Matrix *X = matrix_create_from_array(xs, 4, 1);
+    Matrix *y = matrix_create(4, 1);
+    for (int i = 0; i < 4; i++) y->data[i] = 0.5 * xs[i] + 1.0;
+
+    LinearRegression *lr = linreg_create(1);
+    lr->tol = 1e-6;
+    linreg_fit(lr, X, y, 0.1, 100000);
+    ASSERT(lr->n_iter < 100000);
+    ASSERT(fabs(lr->weights->data[0] - 0.5) < 1e-4);
+
+    linreg_free(lr);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Noise-free y = 1.5 * x1 - 2 * x2 + 0.5 on a grid of 400 rows
+static void make_plane(Matrix **X, Matrix **y) {
+    *X = matrix_create(400, 2);
+    *y = matrix_create(400, 1);
+    for (int i = 0; i < 400; i++) {
+        double x1 = (i % 20) / 10.0 - 1.0, x2 = (i / 20) / 10.0 - 1.0;
+        (*X)->data[i * 2] = x1;
+        (*X)->data[i * 2 + 1] = x2;
+        (*y)->data[i] = 1.5 * x1 - 2.0 * x2 + 0.5;
+    }
+}
+
+void test_linreg_minibatch() {
+    Matrix *X, *y;
+    make_plane(&X, &y);
+
+    linreg_solver_t solvers[] = {LINREG_SOLVER_SGD, LINREG_SOLVER_ADAM};
+    for (int s = 0; s < 2; s++) {
+        LinearRegression *lr = linreg_create(2);
+        lr->solver = solvers[s];
+        lr->batch_size = 32;
+        lr->seed = 7;
+        linreg_fit(lr, X, y, 0.05, 300);
+        ASSERT(fabs(lr->weights->data[0] - 1.5) < 1e-3);
+        ASSERT(fabs(lr->weights->data[1] + 2.0) < 1e-3);
+        ASSERT(fabs(lr->bias - 0.5) < 1e-3);
+        ASSERT(lr->n_steps == (long long)lr->n_iter * 13);  // ceil(400 / 32) updates per epoch
+        linreg_free(lr);
+    }
+
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Streaming the rows in chunks through linreg_partial_fit converges to the
+// same plane
+void test_linreg_partial_fit() {
+    Matrix *X, *y;
+    make_plane(&X, &y);
+
+    LinearRegression *lr = linreg_create(2);
+    lr->solver = LINREG_SOLVER_ADAM;
+    lr->batch_size = 20;
+    for (int pass = 0; pass < 100; pass++) {
+        for (int start = 0; start < 400; start += 100) {
+            Matrix *Xc = matrix_create_from_array(X->data + start * 2, 100, 2);
+            Matrix *yc = matrix_create_from_array(y->data + start, 100, 1);
+            linreg_partial_fit(lr, Xc, yc, 0.02);
+            matrix_free(Xc);
+            matrix_free(yc);
+        }
+    }
+    ASSERT(lr->n_steps == 100 * 4 * 5);
+    ASSERT(fabs(lr->weights->data[0] - 1.5) < 1e-2);
+    ASSERT(fabs(lr->weights->data[1] + 2.0) < 1e-2);
+    ASSERT(fabs(lr->bias - 0.5) < 1e-2);
+
+    linreg_free(lr);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+void test_linreg_predict_into() {
+    LinearRegression *lr = linreg_create(3);
+    double w[3] = {0.5, -1.0, 2.0};
+    memcpy(lr->weights->data, w, sizeof(w));
+    lr->bias = 0.25;
+    double x[6] = {1.0, 2.0, 3.0, -1.0, 0.0, 1.0};
+    Matrix *X = matrix_view_buffer(x, 2, 3);
+
+    double out[2];
+    ASSERT(linreg_predict_into(lr, X, out) == ML_SUCCESS);
+    ASSERT(fabs(out[0] - 4.75) < 1e-12 && fabs(out[1] - 1.75) < 1e-12);
+    ASSERT(linreg_predict_one(lr, x + 3) == out[1]);
+    Matrix *wrong = matrix_view_buffer(x, 3, 2);
+    ASSERT(linreg_predict_into(lr, wrong, out) == ML_ERROR_DIMENSION_MISMATCH);
+
+    matrix_free(wrong);
+    matrix_free(X);
+    linreg_free(lr);
+}
+
+// Full-batch solvers reduce over fixed row blocks, so the thread count
+// never changes the fitted weights
+void test_linreg_threads_deterministic() {
+    int n = 9000, d = 12;
+    Matrix *X = matrix_create(n, d);
+    Matrix *y = matrix_create(n, 1);
+    for (int i = 0; i < n; i++) {
+        double target = 0.5;
+        for (int j = 0; j < d; j++) {
+            X->data[i * d + j] = sin(i * (0.11 + 0.07 * j) + j) + 1e3 * (j == 0);
+            target += (j + 1) * X->data[i * d + j];
+        }
+        y->data[i] = target + 0.01 * cos(i);
+    }
+
+    ThreadPool *pool = thread_pool_create(3);
+    linreg_solver_t solvers[] = {LINREG_SOLVER_GD, LINREG_SOLVER_CHOLESKY, LINREG_SOLVER_CG};
+    for (int s = 0; s < 3; s++) {
+        LinearRegression *fits[3];
+        for (int f = 0; f < 3; f++) {
+            fits[f] = linreg_create(d);
+            fits[f]->solver = solvers[s];
+        }
+        fits[0]->n_threads = 1;
+        fits[1]->n_threads = 5;
+        fits[2]->pool = pool;
+        for (int f = 0; f < 3; f++) linreg_fit(fits[f], X, y, 1e-7, 30);
+        for (int f = 1; f < 3; f++) {
+            ASSERT(memcmp(fits[f]->weights->data, fits[0]->weights->data, d * sizeof(double)) == 0);
+            ASSERT(fits[f]->bias == fits[0]->bias && fits[f]->n_iter == fits[0]->n_iter);
+        }
+        if (solvers[s] == LINREG_SOLVER_CHOLESKY) {
+            ASSERT(fabs(fits[0]->weights->data[d - 1] - d) < 1e-3);
+        }
+        for (int f = 0; f < 3; f++) linreg_free(fits[f]);
+    }
+
+    thread_pool_free(pool);
+    matrix_free(X);
+    matrix_free(y);
+}
+
 int main() {
     TEST(test_linreg_create_free);
     TEST(test_linreg_fit_predict);
+    TEST(test_linreg_solvers);
+    TEST(test_linreg_rank_deficient);
+    TEST(test_linreg_constant_column);
+    TEST(test_linreg_cg_large_offset);
+    TEST(test_linreg_cg_tol_scale_free);
+    TEST(test_linreg_gd_early_stop);
+    TEST(test_linreg_minibatch);
+    TEST(test_linreg_partial_fit);
+    TEST(test_linreg_predict_into);
+    TEST(test_linreg_threads_deterministic);
     printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
     return tests_run != tests_passed;
 }
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include "matrix.h"
+#include "simd.h"
+#include <stdio.h>
+#include <assert.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+// Reference i-j-k product used to check the optimized kernels
+static void naive_multiply(const Matrix *a, const Matrix *b, Matrix *result) {
+    for (int i = 0; i < a->rows; i++) {
+        for (int j = 0; j < b->cols; j++) {
+            double sum = 0.0;
+            for (int k = 0; k < a->cols; k++) {
+                sum += a->data[i * a->cols + k] * b->data[k * b->cols + j];
+            }
+            result->data[i * result->cols + j] = sum;
+        }
+    }
+}
+
+static double max_abs_diff(const Matrix *a, const Matrix *b) {
+    double worst = 0.0;
+    for (int i = 0; i < a->rows * a->cols; i++) {
+        double d = fabs(a->data[i] - b->data[i]);
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
+
+static void check_multiply(int m, int k, int n) {
+    Matrix *a = matrix_create_random(m, k, -1.0, 1.0);
+    Matrix *b = matrix_create_random(k, n, -1.0, 1.0);
+    Matrix *c = matrix_create(m, n);
+    Matrix *ref = matrix_create(m, n);
+
+    ASSERT(matrix_multiply(a, b, c) == ML_SUCCESS);
+    naive_multiply(a, b, ref);
+    ASSERT(max_abs_diff(c, ref) < 1e-9 * k);
+
+    matrix_free(a);
+    matrix_free(b);
+    matrix_free(c);
+    matrix_free(ref);
+}
+
+void test_matrix_multiply_small() {
+    Matrix *a = matrix_create(2, 3);
+    Matrix *b = matrix_create(3, 2);
+    Matrix *c = matrix_create(2, 2);
+    for (int i = 0; i < 6; i++) {
+        a->data[i] = i + 1;   // [1 2 3; 4 5 6]
+        b->data[i] = 6 - i;   // [6 5; 4 3; 2 1]
+    }
+    ASSERT(matrix_multiply(a, b, c) == ML_SUCCESS);
+    ASSERT(c->data[0] == 20.0 && c->data[1] == 14.0);
+    ASSERT(c->data[2] == 56.0 && c->data[3] == 41.0);
+    matrix_free(a);
+    matrix_free(b);
+    matrix_free(c);
+}
+
+void test_matrix_multiply_blocked() {
+    // Sizes straddle the register tile and cache block edges
+    check_multiply(64, 64, 64);
+    check_multiply(131, 257, 67);
+    check_multiply(300, 19, 2100);
+    check_multiply(97, 513, 1);
+}
+
+void test_matrix_multiply_dimension_mismatch() {
+    Matrix *a = matrix_create(2, 3);
+    Matrix *b = matrix_create(2, 3);
+    Matrix *c = matrix_create(2, 3);
+    ASSERT(matrix_multiply(a, b, c) == ML_ERROR_DIMENSION_MISMATCH);
+    ASSERT(matrix_multiply(NULL, b, c) == ML_ERROR_NULL_POINTER);
+    matrix_free(a);
+    matrix_free(b);
+    matrix_free(c);
+}
+
+void test_simd_paths_match_scalar() {
+    const simd_kernels_t *ref = simd_kernels_for(SIMD_SCALAR);
+    ASSERT(ref != NULL);
+    ASSERT(simd_level() <= simd_detect_level());
+
+    // Odd length exercises the vector body and the scalar/masked tail
+    int n = 1037;
+    Matrix *a = matrix_create_random(1, n, -1.0, 1.0);
+    Matrix *b = matrix_create_random(1, n, -1.0, 1.0);
+    double *expected = malloc(n * sizeof(double));
+    double *actual = malloc(n * sizeof(double));
+
+    for (int level = SIMD_SCALAR; level <= SIMD_AVX512; level++) {
+        const simd_kernels_t *k = simd_kernels_for((simd_level_t)level);
+        if (!k) continue;  // not supported by this CPU
+        printf("  checking %s\n", simd_level_name((simd_level_t)level));
+
+        ref->add(a->data, b->data, expected, n);
+        k->add(a->data, b->data, actual, n);
+        ASSERT(memcmp(expected, actual, n * sizeof(double)) == 0);
+        ref->sub(a->data, b->data, expected, n);
+        k->sub(a->data, b->data, actual, n);
+        ASSERT(memcmp(expected, actual, n * sizeof(double)) == 0);
+        ref->mul(a->data, b->data, expected, n);
+        k->mul(a->data, b->data, actual, n);
+        ASSERT(memcmp(expected, actual, n * sizeof(double)) == 0);
+        ref->scale(a->data, 2.5, expected, n);
+        k->scale(a->data, 2.5, actual, n);
+        ASSERT(memcmp(expected, actual, n * sizeof(double)) == 0);
+        k->fill(actual, 3.0, n);
+        ASSERT(actual[0] == 3.0 && actual[n - 1] == 3.0);
+
+        ASSERT(fabs(k->dot(a->data, b->data, n) - ref->dot(a->data, b->data, n)) < 1e-9);
+        ASSERT(fabs(k->sum_sq(a->data, n) - ref->sum_sq(a->data, n)) < 1e-9);
+        ASSERT(fabs(k->sq_dist(a->data, b->data, n) - ref->sq_dist(a->data, b->data, n)) < 1e-9);
+        ASSERT(k->min(a->data, n) == ref->min(a->data, n));
+        ASSERT(k->max(a->data, n) == ref->max(a->data, n));
+        for (int len = 1; len < 20; len++) {
+            ASSERT(k->min(b->data, len) == ref->min(b->data, len));
+            ASSERT(fabs(k->dot(a->data, b->data, len) - ref->dot(a->data, b->data, len)) < 1e-12);
+        }
+    }
+
+    free(expected);
+    free(actual);
+    matrix_free(a);
+    matrix_free(b);
+}
+
+void test_matrix_elementwise() {
+    Matrix *a = matrix_create(3, 3);
+    Matrix *b = matrix_create_ones(3, 3);
+    Matrix *c = matrix_create(3, 3);
+    for (int i = 0; i < 9; i++) a->data[i] = i - 4;
+
+    ASSERT(matrix_add(a, b, c) == ML_SUCCESS && c->data[0] == -3.0 && c->data[8] == 5.0);
+    ASSERT(matrix_subtract(a, b, c) == ML_SUCCESS && c->data[4] == -1.0);
+    ASSERT(matrix_hadamard(a, a, c) == ML_SUCCESS && c->data[0] == 16.0);
+    ASSERT(matrix_multiply_scalar(a, -2.0, c) == ML_SUCCESS && c->data[8] == -8.0);
+    ASSERT(matrix_dot_product(a, b) == 0.0);
+    ASSERT(matrix_norm_squared(a) == 60.0);
+    ASSERT(matrix_min(a) == -4.0 && matrix_max(a) == 4.0);
+
+    matrix_free(a);
+    matrix_free(b);
+    matrix_free(c);
+}
+
+// Element-wise ops, reductions and copies on a narrow view read and write
+// only the view's elements
+void test_matrix_strided_view() {
+    Matrix *parent = matrix_create(4, 5);
+    for (int i = 0; i < 20; i++) parent->data[i] = i;
+
+    // Rows 1-2, columns 1-3: {6, 7, 8}, {11, 12, 13}
+    Matrix *view = matrix_view(parent, 1, 1, 2, 3);
+    ASSERT(view != NULL && view->stride == 5 && !matrix_is_contiguous(view));
+    ASSERT(matrix_get(view, 1, 0) == 11.0);
+    ASSERT(matrix_mean(view) == 57.0 / 6);
+    ASSERT(matrix_min(view) == 6.0 && matrix_max(view) == 13.0);
+    ASSERT(matrix_norm_squared(view) == 36 + 49 + 64 + 121 + 144 + 169);
+
+    Matrix *copy = matrix_copy(view);
+    ASSERT(copy->stride == 3 && copy->data[3] == 11.0);
+
+    Matrix *sum = matrix_create(2, 3);
+    ASSERT(matrix_add(view, copy, sum) == ML_SUCCESS && sum->data[5] == 26.0);
+    ASSERT(matrix_dot_product(view, copy) == matrix_norm_squared(view));
+
+    Matrix *t = matrix_create(3, 2);
+    ASSERT(matrix_transpose(view, t) == ML_SUCCESS && t->data[1] == 11.0 && t->data[4] == 8.0);
+
+    // Writes through the view leave the parent's other elements alone
+    ASSERT(matrix_fill(view, -1.0) == ML_SUCCESS);
+    ASSERT(parent->data[5] == 5.0 && parent->data[6] == -1.0 && parent->data[8] == -1.0);
+    ASSERT(parent->data[9] == 9.0 && parent->data[10] == 10.0 && parent->data[13] == -1.0);
+    ASSERT(parent->data[14] == 14.0);
+
+    matrix_free(view);
+    matrix_free(copy);
+    matrix_free(sum);
+    matrix_free(t);
+    matrix_free(parent);
+}
+
+// GEMM with strided operands and output on both the small and packed paths
+void test_matrix_multiply_strided() {
+    int sizes[][3] = {{5, 7, 3}, {96, 80, 72}};
+    for (int s = 0; s < 2; s++) {
+        int m = sizes[s][0], k = sizes[s][1], n = sizes[s][2];
+        Matrix *big_a = matrix_create_random(m + 3, k + 5, -1.0, 1.0);
+        Matrix *big_b = matrix_create_random(k + 2, n + 4, -1.0, 1.0);
+        Matrix *big_c = matrix_create(m + 1, n + 6);
+        Matrix *a = matrix_view(big_a, 2, 3, m, k);
+        Matrix *b = matrix_view(big_b, 1, 2, k, n);
+        Matrix *c = matrix_view(big_c, 1, 4, m, n);
+
+        ASSERT(matrix_multiply(a, b, c) == ML_SUCCESS);
+        Matrix *ca = matrix_copy(a), *cb = matrix_copy(b), *ref = matrix_create(m, n);
+        naive_multiply(ca, cb, ref);
+        Matrix *cc = matrix_copy(c);
+        ASSERT(max_abs_diff(cc, ref) < 1e-9 * k);
+        ASSERT(big_c->data[0] == 0.0 && big_c->data[(n + 6) + 3] == 0.0);  // outside the view
+
+        matrix_free(a);
+        matrix_free(b);
+        matrix_free(c);
+        matrix_free(ca);
+        matrix_free(cb);
+        matrix_free(cc);
+        matrix_free(ref);
+        matrix_free(big_a);
+        matrix_free(big_b);
+        matrix_free(big_c);
+    }
+}
+
+// Tiled out-of-place transposes on shapes that straddle the tile size,
+// strided operands, and in-place square transposes of odd sizes
+void test_matrix_transpose() {
+    int sizes[][2] = {{1, 1}, {3, 70}, {97, 33}, {130, 129}};
+    for (int s = 0; s < 4; s++) {
+        int m = sizes[s][0], n = sizes[s][1];
+        Matrix *big = matrix_create_random(m + 2, n + 3, -1.0, 1.0);
+        Matrix *a = matrix_view(big, 1, 2, m, n);
+        Matrix *big_t = matrix_create(n + 1, m + 4);
+        Matrix *t = matrix_view(big_t, 1, 3, n, m);
+        ASSERT(matrix_transpose(a, t) == ML_SUCCESS);
+        int wrong = 0;
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) wrong += matrix_get(t, j, i) != matrix_get(a, i, j);
+        }
+        ASSERT(wrong == 0);
+        ASSERT(big_t->data[0] == 0.0 && big_t->data[(m + 4) + 2] == 0.0);  // outside the view
+        matrix_free(a);
+        matrix_free(t);
+        matrix_free(big);
+        matrix_free(big_t);
+    }
+
+    int square[] = {1, 2, 31, 97, 200};
+    for (int s = 0; s < 5; s++) {
+        int n = square[s];
+        Matrix *a = matrix_create_random(n, n, -1.0, 1.0);
+        Matrix *orig = matrix_copy(a);
+        ASSERT(matrix_transpose_inplace(a) == ML_SUCCESS);
+        int wrong = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) wrong += a->data[j * n + i] != orig->data[i * n + j];
+        }
+        ASSERT(wrong == 0);
+        ASSERT(matrix_transpose(a, a) == ML_SUCCESS);  // aliased: back to the original
+        ASSERT(memcmp(a->data, orig->data, (size_t)n * n * sizeof(double)) == 0);
+        matrix_free(a);
+        matrix_free(orig);
+    }
+
+    Matrix *rect = matrix_create(3, 4);
+    Matrix *wrong_shape = matrix_create(3, 4);
+    ASSERT(matrix_transpose(rect, wrong_shape) == ML_ERROR_DIMENSION_MISMATCH);
+    ASSERT(matrix_transpose_inplace(rect) == ML_ERROR_DIMENSION_MISMATCH);
+    matrix_free(rect);
+    matrix_free(wrong_shape);
+}
+
+// X^T v, (X - mean)^T v and (X - mean)^T (X - mean) against explicit products with X^T,
+// bitwise identical for any pool size
+void test_matrix_gemv_t_syrk() {
+    int n = 5000, d = 13;
+    Matrix *big = matrix_create_random(n, d + 2, -1.0, 1.0);
+    Matrix *x = matrix_view(big, 0, 1, n, d);
+    for (int i = 0; i < n; i++) matrix_row(x, i)[0] += 100.0;  // large offset to center away
+    double *v = malloc(n * sizeof(double));
+    double center[13];
+    for (int i = 0; i < n; i++) v[i] = sin(0.1 * i);
+    for (int j = 0; j < d; j++) {
+        center[j] = 0.0;
+        for (int i = 0; i < n; i++) center[j] += matrix_get(x, i, j) / n;
+    }
+
+    double y[13], y_pool[13];
+    ASSERT(matrix_gemv_t(x, NULL, v, y, NULL) == ML_SUCCESS);
+    Matrix *xc = matrix_copy(x);
+    double worst = 0.0;
+    for (int j = 0; j < d; j++) {
+        double ref = 0.0;
+        for (int i = 0; i < n; i++) ref += xc->data[i * d + j] * v[i];
+        worst = fmax(worst, fabs(ref - y[j]) / (1.0 + fabs(ref)));
+    }
+    ASSERT(worst < 1e-10);
+
+    Matrix *gram = matrix_create(d, d);
+    ASSERT(matrix_syrk(x, center, gram, NULL) == ML_SUCCESS);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < d; j++) xc->data[i * d + j] -= center[j];
+    }
+    ASSERT(matrix_gemv_t(x, center, v, y, NULL) == ML_SUCCESS);
+    worst = 0.0;
+    for (int j = 0; j < d; j++) {
+        double ref = 0.0;
+        for (int i = 0; i < n; i++) ref += xc->data[i * d + j] * v[i];
+        worst = fmax(worst, fabs(ref - y[j]) / (1.0 + fabs(ref)));
+    }
+    ASSERT(worst < 1e-10);
+    Matrix *xt = matrix_create(d, n);
+    Matrix *ref = matrix_create(d, d);
+    matrix_transpose(xc, xt);
+    naive_multiply(xt, xc, ref);
+    worst = 0.0;
+    for (int i = 0; i < d * d; i++) worst = fmax(worst, fabs(ref->data[i] - gram->data[i]) / (1.0 + fabs(ref->data[i])));
+    ASSERT(worst < 1e-10);
+    ASSERT(gram->data[1 * d + 5] == gram->data[5 * d + 1]);
+
+    ThreadPool *pool = thread_pool_create(4);
+    Matrix *gram_pool = matrix_create(d, d);
+    ASSERT(matrix_gemv_t(x, center, v, y_pool, pool) == ML_SUCCESS);
+    ASSERT(memcmp(y, y_pool, sizeof(y)) == 0);
+    ASSERT(matrix_syrk(x, center, gram_pool, pool) == ML_SUCCESS);
+    ASSERT(memcmp(gram->data, gram_pool->data, d * d * sizeof(double)) == 0);
+
+    // Uncentered into a strided result
+    Matrix *big_g = matrix_create(d + 1, d + 2);
+    Matrix *g = matrix_view(big_g, 1, 1, d, d);
+    ASSERT(matrix_syrk(x, NULL, g, pool) == ML_SUCCESS);
+    double expected = 0.0;
+    for (int i = 0; i < n; i++) expected += matrix_get(x, i, 0) * matrix_get(x, i, 2);
+    ASSERT(fabs(matrix_get(g, 2, 0) - expected) < 1e-9 * fabs(expected));
+    ASSERT(big_g->data[0] == 0.0 && big_g->data[d + 1] == 0.0);
+
+    ASSERT(matrix_syrk(x, NULL, xt, NULL) == ML_ERROR_DIMENSION_MISMATCH);
+    ASSERT(matrix_gemv_t(x, NULL, NULL, y, NULL) == ML_ERROR_NULL_POINTER);
+
+    thread_pool_free(pool);
+    free(v);
+    matrix_free(x);
+    matrix_free(g);
+    matrix_free(big);
+    matrix_free(big_g);
+    matrix_free(xc);
+    matrix_free(xt);
+    matrix_free(ref);
+    matrix_free(gram);
+    matrix_free(gram_pool);
+}
+
+int main() {
+    TEST(test_matrix_multiply_small);
+    TEST(test_matrix_multiply_blocked);
+    TEST(test_matrix_multiply_dimension_mismatch);
+    TEST(test_simd_paths_match_scalar);
+    TEST(test_matrix_elementwise);
+    TEST(test_matrix_strided_view);
+    TEST(test_matrix_multiply_strided);
+    TEST(test_matrix_transpose);
+    TEST(test_matrix_gemv_t_syrk);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
@@ -0,0 +1,193 @@
+#include "matrix_f32.h"
+#include "simd.h"
+#include "kmeans.h"
+#include "linearreg.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <assert.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+void test_f32_roundtrip_and_view() {
+    Matrix *m = test_random_matrix(5, 7, -1.0, 1.0, 1);
+    MatrixF32 *f = matrix_f32_from_matrix(m);
+    ASSERT(f != NULL && f->stride == 7);
+    Matrix *back = matrix_f32_to_matrix(f);
+    for (int i = 0; i < 35; i++) {
+        ASSERT(fabs(back->data[i] - m->data[i]) < 1e-6);
+    }
+
+    MatrixF32 *view = matrix_f32_view(f, 1, 2, 3, 4);
+    ASSERT(view != NULL && view->is_view && view->stride == 7);
+    ASSERT(matrix_f32_row(view, 2)[3] == matrix_f32_row(f, 3)[5]);
+    Matrix *compact = matrix_f32_to_matrix(view);
+    ASSERT(compact->rows == 3 && compact->cols == 4 && compact->stride == 4);
+    ASSERT(fabs(compact->data[0] - m->data[1 * 7 + 2]) < 1e-6);
+
+    matrix_free(compact);
+    matrix_f32_free(view);
+    matrix_free(back);
+    matrix_f32_free(f);
+    matrix_free(m);
+}
+
+// Sizes straddle the KC block so the accumulation across panels is covered
+void test_f32_multiply_matches_double() {
+    Matrix *a = test_random_matrix(37, 300, -1.0, 1.0, 2);
+    Matrix *b = test_random_matrix(300, 19, -1.0, 1.0, 3);
+    Matrix *c = matrix_create(37, 19);
+    matrix_multiply(a, b, c);
+
+    MatrixF32 *fa = matrix_f32_from_matrix(a);
+    MatrixF32 *fb = matrix_f32_from_matrix(b);
+    MatrixF32 *fc = matrix_f32_create(37, 19);
+    ASSERT(matrix_f32_multiply(fa, fb, fc) == ML_SUCCESS);
+    double max_err = 0.0;
+    for (int i = 0; i < 37; i++) {
+        for (int j = 0; j < 19; j++) {
+            double err = fabs(matrix_f32_row(fc, i)[j] - c->data[i * 19 + j]);
+            if (err > max_err) max_err = err;
+        }
+    }
+    ASSERT(max_err < 1e-4);
+    ASSERT(matrix_f32_multiply(fb, fb, fc) == ML_ERROR_DIMENSION_MISMATCH);
+
+    matrix_f32_free(fa);
+    matrix_f32_free(fb);
+    matrix_f32_free(fc);
+    matrix_free(a);
+    matrix_free(b);
+    matrix_free(c);
+}
+
+void test_q8_quantize_error() {
+    Matrix *m = test_random_matrix(4, 50, -1.0, 1.0, 4);
+    m->data[10] = 3.0;  // row 0 gets a larger scale than the others
+    MatrixQ8 *q = matrix_q8_quantize(m);
+    ASSERT(q != NULL && q->rows == 4 && q->cols == 50);
+    ASSERT(fabs(q->scales[0] - 3.0f / 127.0f) < 1e-7);
+    ASSERT(q->data[10] == 127);
+
+    Matrix *back = matrix_q8_dequantize(q);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 50; j++) {
+            double err = fabs(back->data[i * 50 + j] - m->data[i * 50 + j]);
+            ASSERT(err <= q->scales[i] * 0.5 + 1e-6);
+        }
+    }
+    matrix_free(back);
+    matrix_q8_free(q);
+    matrix_free(m);
+}
+
+// Every compiled path agrees with scalar, including the ragged tails
+void test_f32_kernels_match_scalar() {
+    const simd_kernels_t *ref = simd_kernels_for(SIMD_SCALAR);
+    float a[67], b[67], y_ref[67], y[67];
+    int8_t q[67];
+    for (int i = 0; i < 67; i++) {
+        a[i] = (float)((i * 37) % 23) / 7.0f - 1.5f;
+        b[i] = (float)((i * 11) % 17) / 5.0f - 1.0f;
+        q[i] = (int8_t)((i * 29) % 255 - 127);
+    }
+    for (int level = SIMD_SSE2; level <= (int)simd_detect_level(); level++) {
+        const simd_kernels_t *k = simd_kernels_for((simd_level_t)level);
+        for (int n = 0; n <= 67; n += 13) {
+            ASSERT(fabsf(k->dot_f32(a, b, n) - ref->dot_f32(a, b, n)) < 1e-4f);
+            ASSERT(fabsf(k->sq_dist_f32(a, b, n) - ref->sq_dist_f32(a, b, n)) < 1e-4f);
+            ASSERT(fabsf(k->dot_s8_f32(q, a, n) - ref->dot_s8_f32(q, a, n)) < 1e-2f);
+            for (int i = 0; i < n; i++) y[i] = y_ref[i] = b[i];
+            ref->axpy_f32(0.5f, a, y_ref, n);
+            k->axpy_f32(0.5f, a, y, n);
+            for (int i = 0; i < n; i++) ASSERT(fabsf(y[i] - y_ref[i]) < 1e-6f);
+        }
+    }
+}
+
+void test_kmeans_predict_f32_q8() {
+    Matrix *data = matrix_create(300, 2);
+    double centers[3][2] = {{0.0, 0.0}, {10.0, 10.0}, {0.0, 10.0}};
+    srand(42);
+    for (int i = 0; i < 300; i++) {
+        data->data[i * 2] = centers[i % 3][0] + (double)rand() / RAND_MAX - 0.5;
+        data->data[i * 2 + 1] = centers[i % 3][1] + (double)rand() / RAND_MAX - 0.5;
+    }
+    KMeans *km = kmeans_create(3, 2);
+    kmeans_fit(km, data, 100);
+
+    MatrixF32 *fdata = matrix_f32_from_matrix(data);
+    KMeansCompact *f32 = kmeans_compact(km, ML_PRECISION_F32);
+    KMeansCompact *q8 = kmeans_compact(km, ML_PRECISION_Q8);
+    ASSERT(f32 != NULL && f32->centroids != NULL && f32->centroids_q8 == NULL);
+    ASSERT(q8 != NULL && q8->centroids_q8 != NULL && q8->centroids == NULL);
+    int expected[300], f32_labels[300], q8_labels[300];
+    ASSERT(kmeans_predict_into(km, data, expected, NULL) == ML_SUCCESS);
+    ASSERT(kmeans_compact_predict_into(f32, fdata, f32_labels) == ML_SUCCESS);
+    ASSERT(kmeans_compact_predict_into(q8, fdata, q8_labels) == ML_SUCCESS);
+    ASSERT(memcmp(f32_labels, expected, sizeof(expected)) == 0);
+    ASSERT(memcmp(q8_labels, expected, sizeof(expected)) == 0);
+
+    // The compact copies no longer depend on the source model
+    kmeans_free(km);
+    ASSERT(kmeans_compact_predict_into(q8, fdata, q8_labels) == ML_SUCCESS);
+    ASSERT(memcmp(q8_labels, expected, sizeof(expected)) == 0);
+    MatrixF32 *narrow = matrix_f32_view(fdata, 0, 0, 300, 1);
+    ASSERT(kmeans_compact_predict_into(f32, narrow, f32_labels) == ML_ERROR_DIMENSION_MISMATCH);
+
+    matrix_f32_free(narrow);
+    kmeans_compact_free(f32);
+    kmeans_compact_free(q8);
+    matrix_f32_free(fdata);
+    matrix_free(data);
+}
+
+void test_linreg_predict_f32_q8() {
+    Matrix *X = test_random_matrix(200, 6, -1.0, 1.0, 5);
+    Matrix *y = matrix_create(200, 1);
+    double w[6] = {1.5, -2.0, 0.5, 3.0, -0.25, 1.0};
+    for (int i = 0; i < 200; i++) {
+        y->data[i] = 4.0;
+        for (int j = 0; j < 6; j++) y->data[i] += w[j] * X->data[i * 6 + j];
+    }
+    LinearRegression *lr = linreg_create(6);
+    lr->solver = LINREG_SOLVER_CHOLESKY;
+    linreg_fit(lr, X, y, 0.0, 0);
+
+    MatrixF32 *fX = matrix_f32_from_matrix(X);
+    LinregCompact *f32 = linreg_compact(lr, ML_PRECISION_F32);
+    LinregCompact *q8 = linreg_compact(lr, ML_PRECISION_Q8);
+    ASSERT(f32 != NULL && q8 != NULL);
+    double expected[200], f32_pred[200], q8_pred[200];
+    ASSERT(linreg_predict_into(lr, X, expected) == ML_SUCCESS);
+    ASSERT(linreg_compact_predict_into(f32, fX, f32_pred) == ML_SUCCESS);
+    ASSERT(linreg_compact_predict_into(q8, fX, q8_pred) == ML_SUCCESS);
+    // int8 error is bounded by scale/2 per weight times sum |x| <= 6
+    double q8_bound = 3.0 / 127.0 * 0.5 * 6.0;
+    for (int i = 0; i < 200; i++) {
+        ASSERT(fabs(f32_pred[i] - expected[i]) < 1e-4);
+        ASSERT(fabs(q8_pred[i] - expected[i]) < q8_bound);
+    }
+
+    linreg_compact_free(f32);
+    linreg_compact_free(q8);
+    matrix_f32_free(fX);
+    linreg_free(lr);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+int main() {
+    TEST(test_f32_roundtrip_and_view);
+    TEST(test_f32_multiply_matches_double);
+    TEST(test_q8_quantize_error);
+    TEST(test_f32_kernels_match_scalar);
+    TEST(test_kmeans_predict_f32_q8);
+    TEST(test_linreg_predict_f32_q8);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
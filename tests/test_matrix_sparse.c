@@ -0,0 +1,236 @@
+#include "matrix_sparse.h"
+#include "dataset.h"
+#include "kmeans.h"
+#include "linearreg.h"
+#include "svm.h"
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+// Dense matrix with roughly density of its entries nonzero
+static Matrix* make_sparse_dense(int rows, int cols, double density, unsigned int seed) {
+    Matrix *m = matrix_create(rows, cols);
+    srand(seed);
+    for (int i = 0; i < rows * cols; i++) {
+        if ((double)rand() / RAND_MAX < density) m->data[i] = (double)rand() / RAND_MAX * 2.0 - 1.0;
+    }
+    return m;
+}
+
+static void write_temp_file(char *path, const char *contents) {
+    strcpy(path, "/tmp/test_sparse_XXXXXX");
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    FILE *f = fdopen(fd, "w");
+    fputs(contents, f);
+    fclose(f);
+}
+
+void test_sparse_dense_roundtrip() {
+    Matrix *m = make_sparse_dense(20, 30, 0.1, 1);
+    SparseMatrix *s = sparse_from_dense(m);
+    ASSERT(s != NULL && sparse_is_valid(s));
+    size_t nnz = 0;
+    for (int i = 0; i < 600; i++) nnz += m->data[i] != 0.0;
+    ASSERT(s->nnz == nnz);
+    ASSERT(fabs(sparse_density(s) - nnz / 600.0) < 1e-12);
+
+    Matrix *back = sparse_to_dense(s);
+    ASSERT(memcmp(back->data, m->data, 600 * sizeof(double)) == 0);
+
+    double norms[20];
+    ASSERT(sparse_row_sq_norms(s, norms) == ML_SUCCESS);
+    for (int i = 0; i < 20; i++) {
+        Matrix row = { .data = matrix_row(m, i), .rows = 1, .cols = 30, .stride = 30, .is_view = true };
+        ASSERT(fabs(norms[i] - matrix_norm_squared(&row)) < 1e-12);
+    }
+
+    s->col_idx[s->row_ptr[1]] = 30;  // out of range
+    ASSERT(!sparse_is_valid(s));
+    sparse_free(s);
+    matrix_free(back);
+    matrix_free(m);
+}
+
+void test_sparse_multiply_dense() {
+    Matrix *a = make_sparse_dense(17, 40, 0.15, 2);
+    Matrix *b = make_sparse_dense(40, 9, 1.0, 3);
+    SparseMatrix *s = sparse_from_dense(a);
+    Matrix *expected = matrix_create(17, 9);
+    Matrix *result = matrix_create(17, 9);
+    matrix_fill(result, 42.0);  // must be overwritten, not accumulated into
+    matrix_multiply(a, b, expected);
+    ASSERT(sparse_multiply_dense(s, b, result) == ML_SUCCESS);
+    for (int i = 0; i < 17 * 9; i++) {
+        ASSERT(fabs(result->data[i] - expected->data[i]) < 1e-12);
+    }
+    ASSERT(sparse_multiply_dense(s, a, result) == ML_ERROR_DIMENSION_MISMATCH);
+
+    sparse_free(s);
+    matrix_free(a);
+    matrix_free(b);
+    matrix_free(expected);
+    matrix_free(result);
+}
+
+// Comments, qid fields, unsorted indices and a row with no features
+void test_load_libsvm() {
+    char path[64];
+    write_temp_file(path,
+        "# header comment\n"
+        "1 3:0.5 1:2 # trailing comment\n"
+        "\n"
+        "-1 qid:4 2:-1.5e2\n"
+        "0.25\n"
+        "+1 7:1\n");
+    Matrix *labels = NULL;
+    SparseMatrix *X = load_libsvm(path, &labels);
+    ASSERT(X != NULL && labels != NULL);
+    if (X && labels) {
+        ASSERT(sparse_is_valid(X));
+        ASSERT(X->rows == 4 && X->cols == 7 && X->nnz == 4);
+        ASSERT(labels->data[0] == 1.0 && labels->data[1] == -1.0 && labels->data[2] == 0.25);
+        ASSERT(X->col_idx[0] == 0 && X->values[0] == 2.0 && X->col_idx[1] == 2 && X->values[1] == 0.5);
+        ASSERT(X->values[2] == -150.0 && X->row_ptr[3] == X->row_ptr[2]);
+    }
+
+    // Round trip through save_libsvm
+    char out[64];
+    write_temp_file(out, "");
+    ASSERT(save_libsvm(X, labels, out) == ML_SUCCESS);
+    Matrix *labels2 = NULL;
+    SparseMatrix *X2 = load_libsvm(out, &labels2);
+    ASSERT(X2 != NULL && X2->nnz == X->nnz && X2->cols == X->cols);
+    if (X2) {
+        ASSERT(memcmp(X2->values, X->values, X->nnz * sizeof(double)) == 0);
+        ASSERT(memcmp(X2->row_ptr, X->row_ptr, (X->rows + 1) * sizeof(size_t)) == 0);
+        ASSERT(memcmp(labels2->data, labels->data, X->rows * sizeof(double)) == 0);
+    }
+
+    // The Dataset API densifies
+    Dataset *dataset = dataset_load_libsvm(path);
+    ASSERT(dataset != NULL && dataset->n_features == 7 && dataset->n_targets == 1);
+    if (dataset) {
+        ASSERT(matrix_get(dataset->features, 0, 2) == 0.5 && matrix_get(dataset->features, 3, 6) == 1.0);
+        ASSERT(dataset_save_libsvm(dataset, out) == ML_SUCCESS);
+        SparseMatrix *X3 = load_libsvm(out, NULL);
+        ASSERT(X3 != NULL && X3->nnz == 4);
+        sparse_free(X3);
+    }
+
+    unlink(out);
+    write_temp_file(out, "1 0:1\n");  // indices are 1-based
+    ASSERT(load_libsvm(out, NULL) == NULL);
+    unlink(out);
+    write_temp_file(out, "1 2=1\n");
+    ASSERT(load_libsvm(out, NULL) == NULL);
+    Matrix *no_labels = labels;
+    ASSERT(load_libsvm("/nonexistent/file.svm", &no_labels) == NULL && no_labels == NULL);
+
+    dataset_free(dataset);
+    sparse_free(X);
+    sparse_free(X2);
+    matrix_free(labels);
+    matrix_free(labels2);
+    unlink(path);
+    unlink(out);
+}
+
+// Sparse prediction must agree with the dense paths on the densified data,
+// also when the data has fewer columns than the model
+void test_sparse_model_scoring() {
+    Matrix *dense = make_sparse_dense(300, 60, 0.05, 4);
+    SparseMatrix *X = sparse_from_dense(dense);
+
+    KMeans *km = kmeans_create(20, 64);
+    Matrix *centroids = make_sparse_dense(20, 64, 0.5, 5);
+    memcpy(km->centroids->data, centroids->data, 20 * 64 * sizeof(double));
+    Matrix *padded = matrix_create(300, 64);
+    for (int i = 0; i < 300; i++) memcpy(matrix_row(padded, i), matrix_row(dense, i), 60 * sizeof(double));
+
+    int labels[300], expected_labels[300];
+    double dist[300], expected_dist[300];
+    ASSERT(kmeans_predict_sparse_into(km, X, labels, dist) == ML_SUCCESS);
+    ASSERT(kmeans_predict_into(km, padded, expected_labels, expected_dist) == ML_SUCCESS);
+    for (int i = 0; i < 300; i++) {
+        ASSERT(labels[i] == expected_labels[i]);
+        ASSERT(fabs(dist[i] - expected_dist[i]) < 1e-9);
+    }
+
+    LinearRegression *lr = linreg_create(64);
+    SVM *svm = svm_create(64);
+    for (int f = 0; f < 64; f++) {
+        lr->weights->data[f] = svm->weights->data[f] = sin(f);
+    }
+    lr->bias = svm->bias = 0.1;
+    double pred[300], scores[300], signs[300], expected[300];
+    ASSERT(linreg_predict_sparse_into(lr, X, pred) == ML_SUCCESS);
+    ASSERT(linreg_predict_into(lr, padded, expected) == ML_SUCCESS);
+    ASSERT(svm_decision_function_sparse(svm, X, scores) == ML_SUCCESS);
+    ASSERT(svm_predict_sparse(svm, X, signs) == ML_SUCCESS);
+    for (int i = 0; i < 300; i++) {
+        ASSERT(fabs(pred[i] - expected[i]) < 1e-12);
+        ASSERT(fabs(scores[i] - expected[i]) < 1e-12);
+        ASSERT(signs[i] == (expected[i] >= 0 ? 1.0 : -1.0));
+    }
+
+    LinearRegression *narrow = linreg_create(10);
+    ASSERT(linreg_predict_sparse_into(narrow, X, pred) == ML_ERROR_DIMENSION_MISMATCH);
+    svm->kernel = SVM_KERNEL_RBF;
+    ASSERT(svm_decision_function_sparse(svm, X, scores) == ML_ERROR_NOT_IMPLEMENTED);
+
+    linreg_free(narrow);
+    linreg_free(lr);
+    svm_free(svm);
+    kmeans_free(km);
+    matrix_free(centroids);
+    matrix_free(padded);
+    matrix_free(dense);
+    sparse_free(X);
+}
+
+// Same seeding draws and Lloyd iterations as the dense fit, so the
+// clusterings match
+void test_kmeans_fit_sparse_matches_dense() {
+    Matrix *dense = make_sparse_dense(400, 50, 0.1, 6);
+    for (int i = 0; i < 400; i++) matrix_row(dense, i)[i % 5] += 3.0;  // five loose groups
+    SparseMatrix *X = sparse_from_dense(dense);
+
+    KMeans *sparse_km = kmeans_create(5, 50);
+    KMeans *dense_km = kmeans_create(5, 50);
+    sparse_km->seed = dense_km->seed = 7;
+    sparse_km->n_threads = 2;
+    kmeans_fit_sparse(sparse_km, X, 50);
+    kmeans_fit(dense_km, dense, 50);
+
+    ASSERT(sparse_km->n_iter == dense_km->n_iter);
+    ASSERT(fabs(sparse_km->inertia - dense_km->inertia) < 1e-6 * dense_km->inertia);
+    for (int i = 0; i < 400; i++) {
+        ASSERT(sparse_km->assignments[i] == dense_km->assignments[i]);
+    }
+    for (int i = 0; i < 5 * 50; i++) {
+        ASSERT(fabs(sparse_km->centroids->data[i] - dense_km->centroids->data[i]) < 1e-9);
+    }
+
+    kmeans_free(sparse_km);
+    kmeans_free(dense_km);
+    matrix_free(dense);
+    sparse_free(X);
+}
+
+int main() {
+    TEST(test_sparse_dense_roundtrip);
+    TEST(test_sparse_multiply_dense);
+    TEST(test_load_libsvm);
+    TEST(test_sparse_model_scoring);
+    TEST(test_kmeans_fit_sparse_matches_dense);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
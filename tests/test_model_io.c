@@ -0,0 +1,217 @@
+#include "model_io.h"
+#include "kmeans.h"
+#include "linearreg.h"
+#include "svm.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+static void temp_path(char *path) {
+    strcpy(path, "/tmp/test_model_XXXXXX");
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    close(fd);
+}
+
+// Flip one byte of the file at offset
+static void corrupt_byte(const char *path, long offset) {
+    FILE *f = fopen(path, "r+b");
+    ASSERT(f != NULL);
+    fseek(f, offset, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0xFF, f);
+    fclose(f);
+}
+
+void test_kmeans_save_load() {
+    Matrix *data = test_random_matrix(300, 5, -1.0, 1.0, 1);
+    KMeans *km = kmeans_create(4, 5);
+    km->seed = 9;
+    km->algorithm = KMEANS_HAMERLY;
+    km->n_threads = 3;
+    kmeans_fit(km, data, 20);
+    char path[64];
+    temp_path(path);
+    ASSERT(kmeans_save(km, path) == ML_SUCCESS);
+
+    KMeans *loaded = kmeans_load(path, true);
+    ASSERT(loaded != NULL);
+    if (loaded) {
+        ASSERT(loaded->mapping != NULL && loaded->centroids->is_view);
+        ASSERT(loaded->k == 4 && loaded->seed == 9 && loaded->algorithm == KMEANS_HAMERLY);
+        ASSERT(loaded->n_threads == 1);  // the kmeans_create default, not the saver's
+        ASSERT(loaded->n_iter == km->n_iter && loaded->inertia == km->inertia);
+        ASSERT(memcmp(loaded->centroids->data, km->centroids->data, 20 * sizeof(double)) == 0);
+        ASSERT(memcmp(loaded->centroid_counts, km->centroid_counts, 4 * sizeof(double)) == 0);
+
+        int expected[300], labels[300];
+        kmeans_predict_into(km, data, expected, NULL);
+        kmeans_predict_into(loaded, data, labels, NULL);
+        ASSERT(memcmp(expected, labels, sizeof(labels)) == 0);
+
+        // Updating a loaded model writes to private copies of the pages
+        kmeans_partial_fit(loaded, data);
+        kmeans_partial_fit(km, data);
+        ASSERT(memcmp(loaded->centroids->data, km->centroids->data, 20 * sizeof(double)) == 0);
+        KMeans *again = kmeans_load(path, true);
+        ASSERT(again != NULL && again->centroid_counts[0] != loaded->centroid_counts[0]);
+        kmeans_free(again);
+    }
+
+    kmeans_free(loaded);
+    kmeans_free(km);
+    matrix_free(data);
+    unlink(path);
+}
+
+void test_linreg_save_load() {
+    Matrix *X = test_random_matrix(200, 6, -1.0, 1.0, 2);
+    Matrix *y = test_random_matrix(200, 1, -1.0, 1.0, 3);
+    LinearRegression *lr = linreg_create(6);
+    lr->solver = LINREG_SOLVER_CHOLESKY;
+    lr->seed = 4;
+    linreg_fit(lr, X, y, 0.0, 0);
+    char path[64];
+    temp_path(path);
+    ASSERT(linreg_save(lr, path) == ML_SUCCESS);
+
+    LinearRegression *loaded = linreg_load(path, false);
+    ASSERT(loaded != NULL);
+    if (loaded) {
+        ASSERT(loaded->weights->is_view && loaded->solver == LINREG_SOLVER_CHOLESKY && loaded->seed == 4);
+        ASSERT(loaded->bias == lr->bias);
+        double expected[200], pred[200];
+        linreg_predict_into(lr, X, expected);
+        linreg_predict_into(loaded, X, pred);
+        ASSERT(memcmp(expected, pred, sizeof(pred)) == 0);
+
+        // Refitting writes the new weights into the private mapping only
+        Matrix *y2 = test_random_matrix(200, 1, -1.0, 1.0, 5);
+        linreg_fit(loaded, X, y2, 0.0, 0);
+        ASSERT(loaded->weights->data[0] != lr->weights->data[0]);
+        LinearRegression *again = linreg_load(path, false);
+        ASSERT(again != NULL && again->weights->data[0] == lr->weights->data[0]);
+        linreg_free(again);
+
+        // Saving over the file swaps in a new inode; existing mappings keep the old weights
+        LinearRegression *mapped = linreg_load(path, false);
+        ASSERT(linreg_save(loaded, path) == ML_SUCCESS);
+        ASSERT(mapped != NULL && memcmp(mapped->weights->data, lr->weights->data, 6 * sizeof(double)) == 0);
+        LinearRegression *replaced = linreg_load(path, false);
+        ASSERT(replaced != NULL && replaced->weights->data[0] == loaded->weights->data[0]);
+        linreg_free(replaced);
+        linreg_free(mapped);
+        matrix_free(y2);
+    }
+    ASSERT(kmeans_load(path, false) == NULL);  // wrong model type
+
+    linreg_free(loaded);
+    linreg_free(lr);
+    matrix_free(X);
+    matrix_free(y);
+    unlink(path);
+}
+
+void test_svm_save_load() {
+    Matrix *X = test_random_matrix(120, 3, -1.0, 1.0, 5);
+    Matrix *y = matrix_create(120, 1);
+    for (int i = 0; i < 120; i++) {
+        double r2 = 0.0;
+        for (int j = 0; j < 3; j++) r2 += X->data[i * 3 + j] * X->data[i * 3 + j];
+        y->data[i] = r2 < 0.8 ? 1.0 : -1.0;
+    }
+    char path[64];
+    temp_path(path);
+
+    for (int kernel = SVM_KERNEL_LINEAR; kernel <= SVM_KERNEL_RBF; kernel++) {
+        SVM *svm = svm_create(3);
+        svm->kernel = (svm_kernel_t)kernel;
+        svm->gamma = 2.0;
+        svm_fit(svm, X, y, 1.0, 100);
+        ASSERT(svm_save(svm, path) == ML_SUCCESS);
+        SVM *loaded = svm_load(path, true);
+        ASSERT(loaded != NULL);
+        if (loaded) {
+            ASSERT(loaded->kernel == svm->kernel && loaded->gamma == 2.0);
+            ASSERT(!loaded->support_vectors == !svm->support_vectors && !loaded->dual_coef == !svm->dual_coef);
+            Matrix *expected = svm_decision_function(svm, X);
+            Matrix *scores = svm_decision_function(loaded, X);
+            ASSERT(memcmp(expected->data, scores->data, 120 * sizeof(double)) == 0);
+            matrix_free(expected);
+            matrix_free(scores);
+        }
+        svm_free(loaded);
+        svm_free(svm);
+    }
+
+    matrix_free(X);
+    matrix_free(y);
+    unlink(path);
+}
+
+// The header is always checked; the payload only when asked to
+void test_model_file_rejects_corruption() {
+    LinearRegression *lr = linreg_create(100);
+    for (int i = 0; i < 100; i++) lr->weights->data[i] = i;
+    char path[64];
+    temp_path(path);
+    ASSERT(linreg_save(lr, path) == ML_SUCCESS);
+
+    corrupt_byte(path, 384 + 8 * 50);  // one weight
+    ASSERT(linreg_load(path, true) == NULL);
+    LinearRegression *unchecked = linreg_load(path, false);
+    ASSERT(unchecked != NULL);
+    linreg_free(unchecked);
+
+    ASSERT(linreg_save(lr, path) == ML_SUCCESS);
+    corrupt_byte(path, 200);  // scalar parameters
+    ASSERT(linreg_load(path, false) == NULL);
+
+    ASSERT(linreg_save(lr, path) == ML_SUCCESS);
+    ASSERT(truncate(path, 384 + 400) == 0);
+    ASSERT(linreg_load(path, false) == NULL);
+
+    // Section shape whose byte size wraps to 64: rows * cols * 8 == 2^64 + 64
+    ASSERT(linreg_save(lr, path) == ML_SUCCESS);
+    uint64_t shape[2] = { 1073807362ULL, 2147352580ULL };
+    unsigned char header[384];
+    FILE *f = fopen(path, "r+b");
+    ASSERT(f != NULL && fread(header, 1, sizeof(header), f) == sizeof(header));
+    memcpy(header + 48, shape, sizeof(shape));  // first section's rows and cols
+    uint64_t checksum = 0xCBF29CE484222325ULL;  // FNV-1a over the words before header_checksum
+    for (int i = 0; i < 376; i += 8) {
+        uint64_t word;
+        memcpy(&word, header + i, 8);
+        checksum = (checksum ^ word) * 0x100000001B3ULL;
+    }
+    memcpy(header + 376, &checksum, 8);
+    rewind(f);
+    ASSERT(fwrite(header, 1, sizeof(header), f) == sizeof(header));
+    fclose(f);
+    ModelFile file;
+    ASSERT(model_file_open(path, MODEL_FILE_LINREG, false, &file) == ML_ERROR_INVALID_DATA);
+
+    ASSERT(model_file_open("/nonexistent/model.bin", MODEL_FILE_LINREG, false, &file) == ML_ERROR_FILE_IO);
+    ASSERT(linreg_load(NULL, false) == NULL);
+
+    linreg_free(lr);
+    unlink(path);
+}
+
+int main() {
+    TEST(test_kmeans_save_load);
+    TEST(test_linreg_save_load);
+    TEST(test_svm_save_load);
+    TEST(test_model_file_rejects_corruption);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
@@ -0,0 +1,138 @@
+#include "profile.h"
+#include "kmeans.h"
+#include "linearreg.h"
+#include "dataset.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+// These run against either build: with ML_PROFILE the numbers must add up,
+// without it everything reads as zero
+
+void test_profile_kmeans_phases() {
+    Matrix *data = test_random_matrix(500, 3, 0.0, 1.0, 1);
+    KMeans *km = kmeans_create(4, 3);
+    km->n_threads = 2;
+    profile_reset();
+    kmeans_fit(km, data, 5);
+
+    ProfilePhaseStats assign = profile_phase(ML_PHASE_KMEANS_ASSIGN);
+    uint64_t distances = profile_counter(ML_COUNTER_DISTANCES);
+    if (!profile_enabled()) {
+        ASSERT(assign.calls == 0 && distances == 0);
+    } else {
+        ASSERT(profile_phase(ML_PHASE_KMEANS_INIT).calls == 1);
+        ASSERT(assign.calls == (uint64_t)km->n_iter && assign.total_ns > 0);
+        ASSERT(assign.max_ns <= assign.total_ns);
+        ASSERT(profile_phase(ML_PHASE_KMEANS_UPDATE).calls == (uint64_t)km->n_iter);
+        // Lloyd evaluates every point against every centroid, on both threads
+        ASSERT(distances == (uint64_t)km->n_iter * 500 * 4);
+        ASSERT(profile_counter(ML_COUNTER_ALLOCATIONS) > 0);
+    }
+
+    profile_reset();
+    ASSERT(profile_phase(ML_PHASE_KMEANS_ASSIGN).calls == 0);
+    ASSERT(profile_counter(ML_COUNTER_DISTANCES) == 0);
+    kmeans_free(km);
+    matrix_free(data);
+}
+
+// Enough rows for several parallel_reduce chunks: the gradient phase is
+// still one call per iteration
+void test_profile_linreg_phases() {
+    Matrix *X = test_random_matrix(5000, 4, 0.0, 1.0, 2);
+    Matrix *y = test_random_matrix(5000, 1, 0.0, 1.0, 3);
+    LinearRegression *lr = linreg_create(4);
+    lr->tol = 0.0;
+    profile_reset();
+    linreg_fit(lr, X, y, 0.01, 10);
+    lr->solver = LINREG_SOLVER_CHOLESKY;
+    linreg_fit(lr, X, y, 0.0, 0);
+    Matrix *pred = linreg_predict(lr, X);
+
+    uint64_t expected_gd = profile_enabled() ? 10 : 0;
+    uint64_t expected_once = profile_enabled() ? 1 : 0;
+    ASSERT(profile_phase(ML_PHASE_LINREG_GRADIENT).calls == expected_gd);
+    ASSERT(profile_phase(ML_PHASE_LINREG_UPDATE).calls == expected_gd);
+    ASSERT(profile_phase(ML_PHASE_LINREG_SOLVE).calls == expected_once);
+    ASSERT(profile_phase(ML_PHASE_LINREG_PREDICT).calls == expected_once);
+
+    matrix_free(pred);
+    linreg_free(lr);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+void test_profile_csv_bytes() {
+    char path[] = "/tmp/test_profile_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    FILE *f = fdopen(fd, "w");
+    for (int i = 0; i < 1000; i++) fprintf(f, "%d,%d.5,%d\n", i, i, -i);
+    long size = ftell(f);
+    fclose(f);
+
+    profile_reset();
+    Matrix *m = load_csv_parallel(path, 3);
+    ASSERT(m != NULL && m->rows == 1000);
+    if (profile_enabled()) {
+        ASSERT(profile_counter(ML_COUNTER_BYTES_PARSED) == (uint64_t)size);
+        ASSERT(profile_phase(ML_PHASE_CSV_SCAN).calls == 1);
+        ASSERT(profile_phase(ML_PHASE_CSV_PARSE).calls == 1);
+        ASSERT(profile_phase(ML_PHASE_CSV_STITCH).calls == 1);
+    } else {
+        ASSERT(profile_counter(ML_COUNTER_BYTES_PARSED) == 0);
+    }
+
+    matrix_free(m);
+    unlink(path);
+}
+
+void test_profile_trace() {
+    char path[] = "/tmp/test_trace_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    close(fd);
+
+    if (!profile_enabled()) {
+        ASSERT(profile_trace_start(path) == ML_ERROR_NOT_IMPLEMENTED);
+        unlink(path);
+        return;
+    }
+    ASSERT(profile_trace_stop() == ML_ERROR_INVALID_PARAMETER);  // not started
+    ASSERT(profile_trace_start(path) == ML_SUCCESS);
+    Matrix *data = test_random_matrix(200, 2, 0.0, 1.0, 4);
+    KMeans *km = kmeans_create(3, 2);
+    kmeans_fit(km, data, 3);
+    ASSERT(profile_trace_stop() == ML_SUCCESS);
+
+    FILE *f = fopen(path, "r");
+    char buf[8192];
+    size_t len = f ? fread(buf, 1, sizeof(buf) - 1, f) : 0;
+    buf[len] = '\0';
+    if (f) fclose(f);
+    ASSERT(strncmp(buf, "{\"traceEvents\": [", 17) == 0);
+    ASSERT(strstr(buf, "\"name\": \"kmeans.assign\", \"cat\": \"kmeans\", \"ph\": \"X\"") != NULL);
+    ASSERT(strstr(buf, "\"distances\": ") != NULL);
+
+    kmeans_free(km);
+    matrix_free(data);
+    unlink(path);
+}
+
+int main() {
+    TEST(test_profile_kmeans_phases);
+    TEST(test_profile_linreg_phases);
+    TEST(test_profile_csv_bytes);
+    TEST(test_profile_trace);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
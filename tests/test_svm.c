@@ -0,0 +1,239 @@
+#include "svm.h"
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+// Two separable blobs: label +1 around (2, 2), -1 around (-2, -2)
+static void make_blobs(int n, Matrix **X, Matrix **y) {
+    *X = matrix_create(n, 2);
+    *y = matrix_create(n, 1);
+    srand(7);
+    for (int i = 0; i < n; i++) {
+        double c = i % 2 ? 2.0 : -2.0;
+        (*X)->data[i * 2] = c + 2.0 * rand() / RAND_MAX - 1.0;
+        (*X)->data[i * 2 + 1] = c + 2.0 * rand() / RAND_MAX - 1.0;
+        (*y)->data[i] = i % 2 ? 1.0 : -1.0;
+    }
+}
+
+static int count_correct(const Matrix *pred, const Matrix *y) {
+    int correct = 0;
+    for (int i = 0; i < y->rows; i++) {
+        if (pred->data[i] == y->data[i]) correct++;
+    }
+    return correct;
+}
+
+void test_svm_create_free() {
+    SVM *svm = svm_create(3);
+    ASSERT(svm != NULL);
+    ASSERT(svm->weights->rows == 3);
+    ASSERT(svm->support_vectors == NULL);
+    ASSERT(svm->bias == 0.0);
+    svm_free(svm);
+    ASSERT(svm_create(0) == NULL);
+}
+
+void test_svm_dual_cd() {
+    Matrix *X, *y;
+    make_blobs(400, &X, &y);
+
+    SVM *svm = svm_create(2);
+    svm_fit(svm, X, y, 1.0, 1000);
+    ASSERT(svm->n_iter < 1000);  // converged before the cap
+    Matrix *pred = svm_predict(svm, X);
+    ASSERT(pred != NULL);
+    ASSERT(count_correct(pred, y) == 400);
+
+    // Only points near the margin carry dual weight
+    ASSERT(svm->support_vectors != NULL);
+    ASSERT(svm->support_vectors->rows > 0 && svm->support_vectors->rows < 40);
+
+    // Symmetric data: the separator is roughly x1 + x2 = 0
+    ASSERT(svm->weights->data[0] > 0 && svm->weights->data[1] > 0);
+    ASSERT(fabs(svm->bias) < 0.5);
+
+    matrix_free(pred);
+    svm_free(svm);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Decision values agree with predicted labels
+void test_svm_decision_function() {
+    Matrix *X, *y;
+    make_blobs(100, &X, &y);
+    SVM *svm = svm_create(2);
+    svm_fit(svm, X, y, 1.0, 1000);
+
+    Matrix *scores = svm_decision_function(svm, X);
+    Matrix *pred = svm_predict(svm, X);
+    for (int i = 0; i < X->rows; i++) {
+        ASSERT((scores->data[i] >= 0) == (pred->data[i] > 0));
+    }
+
+    matrix_free(scores);
+    matrix_free(pred);
+    svm_free(svm);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+void test_svm_pegasos() {
+    Matrix *X, *y;
+    make_blobs(400, &X, &y);
+
+    SVM *svm = svm_create(2);
+    svm->solver = SVM_SOLVER_PEGASOS;
+    svm->batch_size = 8;
+    svm_fit(svm, X, y, 1.0, 20);
+    ASSERT(svm->n_iter == 20);
+    ASSERT(svm->n_steps == 20 * 50);
+    Matrix *pred = svm_predict(svm, X);
+    ASSERT(count_correct(pred, y) >= 396);
+
+    matrix_free(pred);
+    svm_free(svm);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Feeding the data as a stream of chunks
+void test_svm_partial_fit() {
+    Matrix *X, *y;
+    make_blobs(400, &X, &y);
+
+    SVM *svm = svm_create(2);
+    for (int pass = 0; pass < 5; pass++) {
+        for (int start = 0; start < 400; start += 50) {
+            Matrix *Xc = matrix_create_from_array(X->data + start * 2, 50, 2);
+            Matrix *yc = matrix_create_from_array(y->data + start, 50, 1);
+            svm_partial_fit(svm, Xc, yc, 1e-3);
+            matrix_free(Xc);
+            matrix_free(yc);
+        }
+    }
+    ASSERT(svm->n_steps == 5 * 400);
+    Matrix *pred = svm_predict(svm, X);
+    ASSERT(count_correct(pred, y) >= 396);
+
+    matrix_free(pred);
+    svm_free(svm);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Concentric rings: +1 inside radius 1, -1 between radii 2 and 3. Not
+// linearly separable.
+static void make_rings(int n, Matrix **X, Matrix **y) {
+    *X = matrix_create(n, 2);
+    *y = matrix_create(n, 1);
+    srand(11);
+    for (int i = 0; i < n; i++) {
+        double angle = 6.283185307179586 * rand() / RAND_MAX;
+        double r = (double)rand() / RAND_MAX;
+        r = i % 2 ? r : 2.0 + r;
+        (*X)->data[i * 2] = r * cos(angle);
+        (*X)->data[i * 2 + 1] = r * sin(angle);
+        (*y)->data[i] = i % 2 ? 1.0 : -1.0;
+    }
+}
+
+void test_svm_rbf() {
+    Matrix *X, *y;
+    make_rings(300, &X, &y);
+
+    SVM *svm = svm_create(2);
+    svm->kernel = SVM_KERNEL_RBF;
+    svm->gamma = 1.0;
+    svm->tol = 1e-3;
+    svm_fit(svm, X, y, 10.0, 100000);
+    ASSERT(svm->n_iter > 0 && svm->n_iter < 100000);
+    ASSERT(svm->support_vectors != NULL && svm->dual_coef != NULL);
+    ASSERT(svm->support_vectors->rows == svm->dual_coef->rows);
+    ASSERT(svm->support_vectors->rows < 100);
+
+    Matrix *pred = svm_predict(svm, X);
+    ASSERT(count_correct(pred, y) == 300);
+
+    // Dual feasibility: sum of alpha_i y_i is zero
+    double sum = 0.0;
+    for (int s = 0; s < svm->dual_coef->rows; s++) sum += svm->dual_coef->data[s];
+    ASSERT(fabs(sum) < 1e-8);
+
+    matrix_free(pred);
+    svm_free(svm);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// Degree-2 polynomial features contain r^2, which separates the rings
+void test_svm_poly() {
+    Matrix *X, *y;
+    make_rings(200, &X, &y);
+
+    SVM *svm = svm_create(2);
+    svm->kernel = SVM_KERNEL_POLY;
+    svm->degree = 2;
+    svm->gamma = 1.0;
+    svm->coef0 = 1.0;
+    svm->tol = 1e-3;
+    svm_fit(svm, X, y, 10.0, 100000);
+    Matrix *pred = svm_predict(svm, X);
+    ASSERT(count_correct(pred, y) == 200);
+
+    matrix_free(pred);
+    svm_free(svm);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+// A cache too small for the problem still converges to the same model, it
+// just recomputes more rows
+void test_svm_kernel_cache() {
+    Matrix *X, *y;
+    make_rings(400, &X, &y);
+
+    SVM *full = svm_create(2);
+    full->kernel = SVM_KERNEL_RBF;
+    svm_fit(full, X, y, 1.0, 100000);
+    ASSERT(full->cache_misses <= 400);  // every row computed at most once
+    ASSERT(svm_cache_hit_rate(full) > 0.5);
+    // Rows i and j once per iteration, plus row i of the final selection
+    long long lookups = full->cache_hits + full->cache_misses;
+    ASSERT(lookups >= 2LL * full->n_iter && lookups <= 2LL * full->n_iter + 1);
+
+    SVM *small = svm_create(2);
+    small->kernel = SVM_KERNEL_RBF;
+    small->cache_mb = 10 * 400 * sizeof(double) / (1024.0 * 1024.0);  // 10 rows
+    svm_fit(small, X, y, 1.0, 100000);
+    ASSERT(small->cache_misses > full->cache_misses);
+    ASSERT(small->cache_hits + small->cache_misses == full->cache_hits + full->cache_misses);
+    ASSERT(small->n_iter == full->n_iter);
+    ASSERT(fabs(small->bias - full->bias) < 1e-12);
+
+    svm_free(full);
+    svm_free(small);
+    matrix_free(X);
+    matrix_free(y);
+}
+
+int main() {
+    TEST(test_svm_create_free);
+    TEST(test_svm_dual_cd);
+    TEST(test_svm_decision_function);
+    TEST(test_svm_pegasos);
+    TEST(test_svm_partial_fit);
+    TEST(test_svm_rbf);
+    TEST(test_svm_poly);
+    TEST(test_svm_kernel_cache);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
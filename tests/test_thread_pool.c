@@ -0,0 +1,254 @@
+#include "thread_pool.h"
+#include "matrix.h"
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+
+int tests_run = 0;
+int tests_passed = 0;
+int tests_failed_asserts = 0;
+
+#define TEST(name) do { printf("Running %s...\n", #name); int before = tests_failed_asserts; tests_run++; name(); if (tests_failed_asserts == before) tests_passed++; } while (0)
+#define ASSERT(cond) do { if (!(cond)) { printf("FAILED: %s at %s:%d\n", #cond, __FILE__, __LINE__); tests_failed_asserts++; } } while (0)
+
+typedef struct {
+    int *hits;
+    int max_range;   // largest [begin, end) handed to the body
+    int grain;
+    ThreadPool *nested;  // pool to call back into from the body, or NULL
+} CoverTask;
+
+static void cover_leaf(void *ctx, int begin, int end, int thread_id) {
+    int *hits = ctx;
+    (void)thread_id;
+    for (int i = begin; i < end; i++) __atomic_fetch_add(&hits[i], 1, __ATOMIC_RELAXED);
+}
+
+static void cover_body(void *ctx, int begin, int end, int thread_id) {
+    CoverTask *task = ctx;
+    (void)thread_id;
+    int len = end - begin;
+    int seen = __atomic_load_n(&task->max_range, __ATOMIC_RELAXED);
+    while (len > seen && !__atomic_compare_exchange_n(&task->max_range, &seen, len, true,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    for (int i = begin; i < end; i++) {
+        // Uneven work, so the fast threads have something to steal
+        volatile double spin = 0.0;
+        for (int s = 0; s < (i % 7) * 200; s++) spin += s;
+        if (task->nested) {
+            parallel_for(task->nested, 4, 1, cover_leaf, task->hits + 4 * i);
+        } else {
+            __atomic_fetch_add(&task->hits[i], 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void check_cover(ThreadPool *pool, int n, int grain) {
+    int *hits = calloc(n, sizeof(int));
+    CoverTask task = { hits, 0, grain, NULL };
+    parallel_for(pool, n, grain, cover_body, &task);
+    for (int i = 0; i < n; i++) ASSERT(hits[i] == 1);
+    if (grain > 0) ASSERT(task.max_range <= grain);
+    free(hits);
+}
+
+void test_parallel_for_covers_range() {
+    int sizes[] = { 1, 3, 8 };
+    for (int s = 0; s < 3; s++) {
+        ThreadPool *pool = thread_pool_create(sizes[s]);
+        ASSERT(pool != NULL && thread_pool_size(pool) == sizes[s]);
+        check_cover(pool, 1000, 1);
+        check_cover(pool, 1000, 37);
+        check_cover(pool, 5, 0);
+        check_cover(pool, 100000, 0);
+        thread_pool_free(pool);
+    }
+    check_cover(NULL, 777, 10);
+    check_cover(NULL, 0, 10);
+}
+
+// Sum of terms of wildly different magnitude: any change in association
+// order shows up in the low bits
+static void sum_terms(void *ctx, int begin, int end, void *partial) {
+    (void)ctx;
+    double *acc = partial;
+    for (int i = begin; i < end; i++) {
+        double term = (i % 3 ? 1e-7 : 1e9) * sin((double)i);
+        acc[0] += term;
+        acc[1] += 1.0;
+    }
+}
+
+static void add_pair(void *ctx, void *acc, const void *partial) {
+    (void)ctx;
+    double *a = acc;
+    const double *p = partial;
+    a[0] += p[0];
+    a[1] += p[1];
+}
+
+void test_parallel_reduce_deterministic() {
+    double expected[2];
+    ASSERT(parallel_reduce(NULL, 100003, 1000, sizeof(expected), sum_terms, add_pair, NULL, expected) == ML_SUCCESS);
+    ASSERT(expected[1] == 100003.0);
+
+    for (int t = 2; t <= 7; t += 5) {
+        ThreadPool *pool = thread_pool_create(t);
+        for (int rep = 0; rep < 3; rep++) {
+            double result[2] = { 42.0, 42.0 };
+            ASSERT(parallel_reduce(pool, 100003, 1000, sizeof(result), sum_terms, add_pair, NULL, result) == ML_SUCCESS);
+            ASSERT(memcmp(result, expected, sizeof(result)) == 0);
+        }
+        thread_pool_free(pool);
+    }
+
+    // Tiny grains are widened to the chunk cap; an empty range gives zeros
+    double capped[2], empty[2] = { 1.0, 1.0 };
+    ASSERT(parallel_reduce(NULL, 100003, 1, sizeof(capped), sum_terms, add_pair, NULL, capped) == ML_SUCCESS);
+    ASSERT(capped[1] == 100003.0);
+    ASSERT(parallel_reduce(NULL, 0, 1, sizeof(empty), sum_terms, add_pair, NULL, empty) == ML_SUCCESS);
+    ASSERT(empty[0] == 0.0 && empty[1] == 0.0);
+    ASSERT(parallel_reduce(NULL, 10, 1, 0, sum_terms, add_pair, NULL, empty) == ML_ERROR_INVALID_PARAMETER);
+}
+
+// A body that calls back into the pool it runs on must not deadlock
+void test_nested_parallel_for() {
+    ThreadPool *pool = thread_pool_create(4);
+    int n = 500;
+    int *hits = calloc(4 * n, sizeof(int));
+    CoverTask task = { hits, 0, 3, pool };
+    parallel_for(pool, n, 3, cover_body, &task);
+    for (int i = 0; i < 4 * n; i++) ASSERT(hits[i] == 1);
+    free(hits);
+    thread_pool_free(pool);
+}
+
+typedef struct {
+    pthread_t caller;
+    int off_caller;  // task calls that ran on another thread
+} SerialTask;
+
+static void count_off_caller(void *ctx, int thread_id, int n_threads) {
+    SerialTask *task = ctx;
+    (void)thread_id;
+    (void)n_threads;
+    if (!pthread_equal(pthread_self(), task->caller)) __atomic_fetch_add(&task->off_caller, 1, __ATOMIC_RELAXED);
+}
+
+static void serial_body(void *ctx, int thread_id, int n_threads) {
+    (void)thread_id;
+    (void)n_threads;
+    thread_pool_run(thread_pool_global(), count_off_caller, ctx);
+}
+
+static void serial_chunk(void *ctx, int begin, int end, int thread_id) {
+    (void)begin;
+    (void)end;
+    serial_body(ctx, thread_id, 1);
+}
+
+// Work run serially (NULL pool) keeps what it calls on the calling thread,
+// even when that asks for the global pool
+void test_serial_run_stays_serial() {
+    ThreadPoolOptions options = { .n_threads = 3 };
+    ASSERT(thread_pool_configure(&options) == ML_SUCCESS);
+    SerialTask task = { pthread_self(), 0 };
+    serial_body(&task, 0, 1);
+    ASSERT(task.off_caller == 2);
+
+    task.off_caller = 0;
+    thread_pool_run(NULL, serial_body, &task);
+    parallel_for(NULL, 4, 1, serial_chunk, &task);
+    ASSERT(task.off_caller == 0);
+    thread_pool_configure(NULL);
+}
+
+typedef struct {
+    ThreadPool *pool;
+    int *hits;
+} CallerArgs;
+
+static void* concurrent_caller(void *arg) {
+    CallerArgs *args = arg;
+    for (int rep = 0; rep < 20; rep++) {
+        CoverTask task = { args->hits + rep * 2000, 0, 16, NULL };
+        parallel_for(args->pool, 2000, 16, cover_body, &task);
+    }
+    return NULL;
+}
+
+// Callers that find the pool busy run their loop themselves
+void test_concurrent_callers() {
+    ThreadPool *pool = thread_pool_create(3);
+    pthread_t threads[4];
+    CallerArgs args[4];
+    for (int t = 0; t < 4; t++) {
+        args[t] = (CallerArgs){ pool, calloc(20 * 2000, sizeof(int)) };
+        pthread_create(&threads[t], NULL, concurrent_caller, &args[t]);
+    }
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+        for (int i = 0; i < 20 * 2000; i++) ASSERT(args[t].hits[i] == 1);
+        free(args[t].hits);
+    }
+    thread_pool_free(pool);
+}
+
+void test_global_pool_and_select() {
+    int cpus[] = { 0 };
+    ThreadPoolOptions options = { .n_threads = 3, .pin_threads = true, .cpus = cpus, .n_cpus = 1 };
+    ASSERT(thread_pool_configure(&options) == ML_SUCCESS);
+    ThreadPool *global = thread_pool_global();
+    ASSERT(global != NULL && thread_pool_size(global) == 3);
+    check_cover(global, 10000, 0);
+
+    ThreadPool *owned;
+    ASSERT(thread_pool_select(NULL, 0, &owned) == global && owned == NULL);
+    ASSERT(thread_pool_select(NULL, 1, &owned) == NULL && owned == NULL);
+    ThreadPool *mine = thread_pool_select(NULL, 2, &owned);
+    ASSERT(mine != NULL && mine == owned && thread_pool_size(mine) == 2);
+    ASSERT(thread_pool_select(mine, 0, &owned) == mine && owned == NULL);
+    thread_pool_free(mine);
+
+    options.n_cpus = 0;
+    ASSERT(thread_pool_configure(&options) == ML_ERROR_INVALID_PARAMETER);
+    ASSERT(thread_pool_global() == global);
+    ASSERT(thread_pool_configure(NULL) == ML_SUCCESS);
+    ASSERT(thread_pool_global() != NULL);  // recreated with the defaults
+    ASSERT(thread_pool_configure(NULL) == ML_SUCCESS);
+}
+
+// Large products split their rows across the global pool without changing
+// a single bit of the result
+void test_matrix_multiply_pool_size_independent() {
+    Matrix *a = matrix_create_random(300, 250, -1.0, 1.0);
+    Matrix *b = matrix_create_random(250, 200, -1.0, 1.0);
+    Matrix *serial = matrix_create(300, 200);
+    Matrix *threaded = matrix_create(300, 200);
+    ThreadPoolOptions options = { .n_threads = 1 };
+    ASSERT(thread_pool_configure(&options) == ML_SUCCESS);
+    ASSERT(matrix_multiply(a, b, serial) == ML_SUCCESS);
+    options.n_threads = 5;
+    ASSERT(thread_pool_configure(&options) == ML_SUCCESS);
+    ASSERT(matrix_multiply(a, b, threaded) == ML_SUCCESS);
+    ASSERT(memcmp(serial->data, threaded->data, 300 * 200 * sizeof(double)) == 0);
+    thread_pool_configure(NULL);
+
+    matrix_free(a);
+    matrix_free(b);
+    matrix_free(serial);
+    matrix_free(threaded);
+}
+
+int main() {
+    TEST(test_parallel_for_covers_range);
+    TEST(test_parallel_reduce_deterministic);
+    TEST(test_nested_parallel_for);
+    TEST(test_serial_run_stays_serial);
+    TEST(test_concurrent_callers);
+    TEST(test_global_pool_and_select);
+    TEST(test_matrix_multiply_pool_size_independent);
+    printf("Ran %d tests, %d passed\n", tests_run, tests_passed);
+    return tests_run != tests_passed;
+}
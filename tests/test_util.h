@@ -0,0 +1,17 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include "matrix.h"
+
+// Fixtures shared by the test suites
+
+// rows x cols of uniform values in [min_val, max_val], reproducible from seed
+static inline Matrix* test_random_matrix(int rows, int cols, double min_val, double max_val, unsigned int seed) {
+    Matrix *m = matrix_create(rows, cols);
+    if (!m) return NULL;
+    srand(seed);
+    matrix_fill_random(m, min_val, max_val);
+    return m;
+}
+
+#endif